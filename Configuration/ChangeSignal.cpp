@@ -0,0 +1,170 @@
+// Copyright (c) 2014 by Bertolt Mildner
+// All rights reserved.
+
+#include "ChangeSignal.h"
+
+#include <atomic>
+#include <algorithm>
+
+#include "Utils.h"
+
+CONFIGURATION_BOOST_INCL_GUARD_BEGIN
+#include <boost/format.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/interprocess/managed_shared_memory.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <boost/interprocess/sync/interprocess_condition.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+CONFIGURATION_BOOST_INCL_GUARD_END
+
+using namespace std;
+
+namespace
+{
+  using Lock = boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>;
+
+  const string SharedMemoryNamePrefix = "ConfigurationStore_";
+  const string SharedMemoryKind       = "ChangeSignal";
+  const char   SharedObjectName[]     = "ChangeSignal";
+
+  // room for the sequence and the bookkeeping of the managed segment
+  const size_t SharedMemorySize = 4096;
+
+  // longest a watcher waits without looking at the sequence, bounds the delay of a missed wake-up
+  const boost::posix_time::milliseconds WaitSlice(100);
+
+  // FNV-1a, unlike std::hash it is the same for all processes whatever they have been built with
+  uint64_t HashFileName(const string& fileName)
+  {
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (auto c : fileName)
+    {
+      hash ^= static_cast<uint8_t>(c);
+      hash *= 1099511628211ULL;
+    }
+
+    return hash;
+  }
+}
+
+namespace Configuration
+{
+  namespace Detail
+  {
+    string GetSharedMemoryName(const string& kind, const wstring& fileName)
+    {
+      if (fileName == Store::InMemoryFileName)
+      {
+        throw ExceptionImpl<InvalidConfiguration>(L"Private in-memory stores can not be shared between processes");
+      }
+
+      // all spellings of the same file have to end up at the same shared memory, names of in-memory stores are no paths and are taken as they are
+      boost::system::error_code error;
+      auto path = boost::filesystem::canonical(fileName, error);
+
+      return (boost::format("%1%%2%_%3$016x") % SharedMemoryNamePrefix % kind % HashFileName(WcharToUTF8(error ? fileName : path.wstring()))).str();
+    }
+
+    // shared between processes, so it must not need a lock of its own
+    static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "The change sequence requires lock-free 64 bit atomics");
+
+    // lives in the shared memory, constructed by the first process opening the signal
+    struct SharedChangeSequence
+    {
+      SharedChangeSequence()
+      : Mutex(), Condition(), Sequence(0)
+      {
+      }
+
+      // only guards waking up waiting watchers, the sequence itself is never locked
+      // not robust: a process dying while holding it would leave it locked, so nobody waits for it longer than WaitSlice
+      boost::interprocess::interprocess_mutex     Mutex;
+      boost::interprocess::interprocess_condition Condition;
+      std::atomic<ChangeSignal::Sequence>         Sequence;
+    };
+
+    struct ChangeSignalMemory
+    {
+      explicit ChangeSignalMemory(const string& name)
+      : Memory(boost::interprocess::open_or_create, name.c_str(), SharedMemorySize),
+        Shared(Memory.find_or_construct<SharedChangeSequence>(SharedObjectName)())
+      {
+      }
+
+      boost::interprocess::managed_shared_memory Memory;
+      SharedChangeSequence*                      Shared;
+    };
+  }
+
+  ChangeSignal::ChangeSignal(const wstring& fileName)
+  : m_Memory(make_unique<Detail::ChangeSignalMemory>(Detail::GetSharedMemoryName(SharedMemoryKind, fileName)))
+  {
+  }
+
+  ChangeSignal::~ChangeSignal() noexcept
+  {
+  }
+
+  ChangeSignal::Sequence ChangeSignal::GetSequence() const noexcept
+  {
+    return m_Memory->Shared->Sequence.load(memory_order_acquire);
+  }
+
+  void ChangeSignal::Notify()
+  {
+    auto& shared = *m_Memory->Shared;
+
+    shared.Sequence.fetch_add(1, memory_order_release);
+
+    // a commit never waits for the mutex, watchers missing the wake-up see the new sequence after WaitSlice at the latest
+    Lock lock(shared.Mutex, boost::interprocess::try_to_lock);
+
+    if (lock)
+    {
+      shared.Condition.notify_all();
+    }
+  }
+
+  bool ChangeSignal::Wait(Sequence& sequence, chrono::milliseconds timeout) const
+  {
+    auto& shared = *m_Memory->Shared;
+    auto deadline = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(timeout.count());
+
+    // timed_wait() may wake up spuriously, the mutex may be held by a process that died meanwhile
+    for (;;)
+    {
+      auto current = shared.Sequence.load(memory_order_acquire);
+
+      if (current != sequence)
+      {
+        sequence = current;
+        return true;
+      }
+
+      auto now = boost::posix_time::microsec_clock::universal_time();
+
+      if (now >= deadline)
+      {
+        return false;
+      }
+
+      auto until = min(deadline, now + WaitSlice);
+
+      Lock lock(shared.Mutex, until);
+
+      // Notify() bumps the sequence before it locks the mutex
+      if (lock && (shared.Sequence.load(memory_order_acquire) == sequence))
+      {
+        shared.Condition.timed_wait(lock, until);
+      }
+    }
+  }
+
+  void ChangeSignal::Remove(const wstring& fileName)
+  {
+    boost::interprocess::shared_memory_object::remove(Detail::GetSharedMemoryName(SharedMemoryKind, fileName).c_str());
+  }
+}
@@ -0,0 +1,64 @@
+// Copyright (c) 2014 by Bertolt Mildner
+// All rights reserved.
+
+#ifndef CONFIGURATION_CHANGESIGNAL_H
+#define CONFIGURATION_CHANGESIGNAL_H
+
+#pragma once
+
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <chrono>
+
+#include <boost\noncopyable.hpp>
+
+#include "Configuration.h"
+
+namespace Configuration
+{
+  namespace Detail
+  {
+    struct ChangeSignalMemory;
+
+    // name of the shared memory of kind belonging to the store in fileName, the same for all spellings of the path
+    std::string GetSharedMemoryName(const std::string& kind, const std::wstring& fileName);
+  }
+
+  // cross-process change signal of a store: a sequence number in named shared memory belonging to the store file,
+  // bumped by every commit of Store objects opened with Options::SignalChanges
+  // watchers block in Wait() until a change has been committed instead of polling revisions, all processes on the host
+  // opening the same file share the same signal (the shared memory outlives them, see Remove())
+  // commits of Store objects opened without Options::SignalChanges are not signalled, wait with a timeout if there may be any
+  class ChangeSignal : private boost::noncopyable
+  {
+    public:
+      using Sequence = std::uint64_t;
+
+      // opens or creates the signal of the store in fileName, works for shared in-memory stores within the process
+      // private in-memory stores can not be opened a second time and so can not be watched
+      explicit ChangeSignal(const std::wstring& fileName);
+
+      ~ChangeSignal() noexcept;
+
+      // lock-free
+      Sequence GetSequence() const noexcept;
+
+      // bumps the sequence and wakes all waiting watchers, lock-free and never waits for other processes
+      // watchers that can not be woken up right away see the change within 100 ms
+      void Notify();
+
+      // blocks until the sequence differs from sequence or timeout has elapsed
+      // returns true and updates sequence if there has been a change, several commits meanwhile are reported by a single wake-up
+      bool Wait(Sequence& sequence, std::chrono::milliseconds timeout) const;
+
+      // removes the shared memory of the signal of fileName, signals that are open keep working but are no longer shared
+      // with signals opened afterwards
+      static void Remove(const std::wstring& fileName);
+
+    private:
+      std::unique_ptr<Detail::ChangeSignalMemory> m_Memory;
+  };
+}
+
+#endif
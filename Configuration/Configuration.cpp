@@ -10,18 +10,30 @@
 #include <tuple>
 #include <type_traits>
 #include <exception>
+#include <cctype>
+#include <limits>
 
 #include "Utils.h"
 
 CONFIGURATION_BOOST_INCL_GUARD_BEGIN
 #include <boost/format.hpp>
-#include <boost/tokenizer.hpp>
+#include <boost/variant.hpp>
 CONFIGURATION_BOOST_INCL_GUARD_END
 
 #include "RandomNumberGenerator.h"
+#include "LruCache.h"
+#include "NameScanner.h"
+#include "Parallel.h"
+#include "WriteBatch.h"
+#include "ChangeSignal.h"
 
 #include "SQLiteCpp\SQLiteCpp.h"
 
+// RETURNING (atomic value operations, ...) needs SQLite 3.35.0 or newer, UPDATE FROM 3.33.0
+#if SQLITE_VERSION_NUMBER < 3035000
+#  error SQLite 3.35.0 or newer is required
+#endif
+
 using namespace std;
 
 
@@ -29,6 +41,8 @@ namespace
 {
   const string Table_Settings = "Settings";
   const string Table_Entries  = "Entries";
+  const string Table_History  = "History";  // since 1.2
+  const string Table_Closure  = "Closure";  // only with subtree index, see Store::SetSubtreeIndex()
 
   const std::string Table_Settings_Column_Name  = "Name";
   const std::string Table_Settings_Column_Value = "Value";
@@ -39,10 +53,51 @@ namespace
   const std::string Table_Entries_Column_Revision = "Revision";
   const std::string Table_Entries_Column_Type     = "Type";
   const std::string Table_Entries_Column_Value    = "Value";
+  const std::string Table_Entries_Column_Expires  = "Expires";  // since 1.1, ms since epoch of std::chrono::system_clock, NULL == never
+  const std::string Table_Entries_Column_Hash     = "Hash";          // since 1.3, content hash of the entry and its descendants
+  const std::string Table_Entries_Column_HashRevision = "HashRevision";  // since 1.3, revision the hash has been computed for, NULL == never
+  const std::string Table_Entries_Column_NameHash = "NameHash";  // since 1.4, hash of Parent and Name, see Store::GetNameHash()
+  const std::string Table_Entries_Column_FullPath = "FullPath";  // since 1.5, UTF-8 full name of the entry, NULL unless in full path mode
+  const std::string Table_Entries_Column_Descendants = "Descendants";  // since 1.6, number of descendants, see Store::GetStats()
+  const std::string Table_Entries_Column_SubtreeSize = "SubtreeSize";  // since 1.6, bytes of the values of the entry and its descendants
 
   const std::string Table_Entries_Name_Index        = "TableEntries_Name";
   const std::string Table_Entries_Parent_Index      = "TableEntries_Parent";
   const std::string Table_Entries_Name_Parent_Index = "TableEntries_Name_Parent";
+  const std::string Table_Entries_Expires_Index     = "TableEntries_Expires";
+  const std::string Table_Entries_NameHash_Index    = "TableEntries_NameHash";
+  const std::string Table_Entries_FullPath_Index    = "TableEntries_FullPath";
+
+  // previous values of entries, see Store::SetHistoryRetention()
+  const std::string Table_History_Column_EntryId   = "EntryId";
+  const std::string Table_History_Column_Revision  = "Revision";   // revision of the entry while the value was current
+  const std::string Table_History_Column_Type      = "Type";
+  const std::string Table_History_Column_Value     = "Value";
+  const std::string Table_History_Column_ValidFrom = "ValidFrom";  // time the history has been enabled for the first recorded change of the entry
+  const std::string Table_History_Column_ValidTo   = "ValidTo";    // time the value has been replaced
+
+  const std::string Table_History_EntryId_Index = "TableHistory_EntryId";
+
+  const std::string Table_Closure_Column_Ancestor   = "Ancestor";
+  const std::string Table_Closure_Column_Descendant = "Descendant";
+  const std::string Table_Closure_Column_Depth      = "Depth";  // 0 == entry itself
+
+  const std::string Table_Closure_Descendant_Index = "TableClosure_Descendant";
+
+  // per connection, changes of the statistics of EntryId and all its ancestors not applied yet
+  const std::string Table_StatsDelta = "StatsDelta";
+
+  const std::string Table_StatsDelta_Column_EntryId     = "EntryId";
+  const std::string Table_StatsDelta_Column_Descendants = "Descendants";
+  const std::string Table_StatsDelta_Column_Size        = "Size";
+
+  const std::string Trigger_History_Update = "TriggerHistory_Update";
+  const std::string Trigger_History_Delete = "TriggerHistory_Delete";
+  const std::string Trigger_Closure_Insert = "TriggerClosure_Insert";
+  const std::string Trigger_Closure_Delete = "TriggerClosure_Delete";
+  const std::string Trigger_Stats_Insert   = "TriggerStats_Insert";
+  const std::string Trigger_Stats_Update   = "TriggerStats_Update";
+  const std::string Trigger_Stats_Delete   = "TriggerStats_Delete";
 
   // turns out that the name of our root entry _must not_ be a valid name for our store!
   // violating this causes constraint violations on the database!!
@@ -52,7 +107,290 @@ namespace
   const std::string Setting_MinorVersion = "MinorVersion";
 
   const std::string Setting_NameDelimiter = "NameDelimiter";
+  const std::string Setting_FullPaths     = "FullPaths";  // delimiter the full names have been computed with, see Store::SetFullPathMode()
+
+  // retention of the history, see Store::SetHistoryRetention(), part of the settings so it is copied along with the content
+  const std::string Setting_HistoryMaxValues = "HistoryMaxValues";
+  const std::string Setting_HistoryMaxAge    = "HistoryMaxAge";
+  const std::string Setting_HistorySince     = "HistorySince";  // time the history has been enabled, values before are unknown
+
+  const std::string Table_Settings_Columns = Table_Settings_Column_Name + "," + Table_Settings_Column_Value;
+  const std::string Table_Entries_Columns  = Table_Entries_Column_Id + "," +
+                                             Table_Entries_Column_Parent + "," +
+                                             Table_Entries_Column_Revision + "," +
+                                             Table_Entries_Column_Name + "," +
+                                             Table_Entries_Column_Type + "," +
+                                             Table_Entries_Column_Value + "," +
+                                             Table_Entries_Column_Expires + "," +
+                                             Table_Entries_Column_Hash + "," +
+                                             Table_Entries_Column_HashRevision + "," +
+                                             Table_Entries_Column_NameHash + "," +
+                                             Table_Entries_Column_FullPath + "," +
+                                             Table_Entries_Column_Descendants + "," +
+                                             Table_Entries_Column_SubtreeSize;
+  const std::string Table_History_Columns  = Table_History_Column_EntryId + "," +
+                                             Table_History_Column_Revision + "," +
+                                             Table_History_Column_Type + "," +
+                                             Table_History_Column_Value + "," +
+                                             Table_History_Column_ValidFrom + "," +
+                                             Table_History_Column_ValidTo;
+
+  // current time in ms since epoch within SQL (e.g. in triggers that can not take parameters), see ToStoreTime()
+  const std::string Expression_Now = "CAST(ROUND((julianday('now') - 2440587.5) * 86400000) AS INTEGER)";
+
+  // max. time we wait for locks held by other connections, in ms
+  const int BusyTimeout = 15000;
+
+  // FNV-1a, content hashes have to be comparable across stores and platforms
+  class ContentHasher
+  {
+    public:
+      ContentHasher()
+      : m_Hash(14695981039346656037ULL)
+      {
+      }
+
+      void Add(const void* data, size_t size)
+      {
+        Add(static_cast<uint64_t>(size));
+        AddBytes(data, size);
+      }
+
+      // little endian, independent of the platform
+      void Add(uint64_t value)
+      {
+        for (int i = 0; i < 8; i++)
+        {
+          uint8_t byte = static_cast<uint8_t>(value >> (i * 8));
+
+          AddBytes(&byte, 1);
+        }
+      }
+
+      uint64_t Get() const
+      {
+        return m_Hash;
+      }
+
+    private:
+      void AddBytes(const void* data, size_t size)
+      {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+        for (size_t i = 0; i < size; i++)
+        {
+          m_Hash = (m_Hash ^ bytes[i]) * 1099511628211ULL;
+        }
+      }
+
+      uint64_t m_Hash;
+  };
+
+  // expired entries are treated as not existing until ExpireDue() deletes them, ?n is the current time
+  std::string NotExpired(const std::string& now)
+  {
+    return "(" + Table_Entries_Column_Expires + " IS NULL OR " + Table_Entries_Column_Expires + " > " + now + ")";
+  }
+
+  // fills the closure table of schema ("" or "<name>.") from scratch, O(n * depth)
+  std::string BuildClosure(const std::string& schema)
+  {
+    return "DELETE FROM " + schema + Table_Closure + "; " +
+           "WITH RECURSIVE Pairs(Ancestor, Descendant, Depth) AS (SELECT " + Table_Entries_Column_Id + "," + Table_Entries_Column_Id + ", 0 FROM " + schema + Table_Entries +
+                                                                " UNION ALL SELECT Parents." + Table_Entries_Column_Parent + ", Pairs.Descendant, Pairs.Depth + 1 FROM " + schema + Table_Entries + " AS Parents" +
+                                                                  " JOIN Pairs ON Parents." + Table_Entries_Column_Id + " = Pairs.Ancestor WHERE Pairs.Ancestor != 0) " +
+           "INSERT INTO " + schema + Table_Closure + " (" + Table_Closure_Column_Ancestor + "," + Table_Closure_Column_Descendant + "," + Table_Closure_Column_Depth + ") " +
+             "SELECT Ancestor, Descendant, Depth FROM Pairs";
+  }
+
+  // value as read by Store::GetInteger(), GetString() and GetBinary(): NULL is 0, an empty string or an empty binary, type is the one of the entry
+  std::string ValueOrEmpty(const std::string& value, const std::string& type)
+  {
+    return "(CASE " + type + " WHEN " + std::to_string(static_cast<int>(Configuration::Store::ValueType::Integer)) + " THEN COALESCE(" + value + ", 0)" +
+                           " WHEN " + std::to_string(static_cast<int>(Configuration::Store::ValueType::String)) + " THEN COALESCE(" + value + ", '')" +
+                           " ELSE COALESCE(" + value + ", X'') END)";
+  }
+
+  // bytes of value as counted by Store::GetStats()
+  std::string ValueSize(const std::string& value)
+  {
+    return "(CASE WHEN typeof(" + value + ") = 'integer' THEN 8 ELSE IFNULL(LENGTH(CAST(" + value + " AS BLOB)), 0) END)";
+  }
+
+  // schema name of the database attached by LoadFrom() and SaveTo()
+  const std::string AttachedDatabaseName = "Other";
+
+  const std::string SharedInMemoryFileNamePrefix = "file:";
+  const std::string SharedInMemoryFileNameSuffix = "?mode=memory&cache=shared";
+
+  // statements used by regular operations on entries, see Store::PrepareStatements()
+  // statements only used when opening a store or by maintenance operations are defined locally where they are used
+  const std::string Statement_GetEntryId = "SELECT " + Table_Entries_Column_Id + " FROM " + Table_Entries +
+                                             " WHERE " + Table_Entries_Column_Name + " = ?1 AND " +
+                                                         Table_Entries_Column_Parent + " = ?2 AND " + NotExpired("?3");
+  // same, but probes the index of the name hashes, ?4 is the name hash, see Options::HashNameLookup
+  const std::string Statement_GetEntryIdByHash = "SELECT " + Table_Entries_Column_Id + " FROM " + Table_Entries + " INDEXED BY " + Table_Entries_NameHash_Index +
+                                                   " WHERE " + Table_Entries_Column_NameHash + " = ?4 AND " +
+                                                               Table_Entries_Column_Name + " = ?1 AND " +
+                                                               Table_Entries_Column_Parent + " = ?2 AND " + NotExpired("?3");
+  const std::string Statement_GetEntryParent = "SELECT " + Table_Entries_Column_Parent + " FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Id + " = ?1";
+  const std::string Statement_GetEntryRevision = "SELECT " + Table_Entries_Column_Revision + " FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Id + " = ?1";
+  const std::string Statement_GetEntryRevisionAndNameHash = "SELECT " + Table_Entries_Column_Revision + "," + Table_Entries_Column_NameHash + " FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Id + " = ?1";
+  const std::string Statement_SetEntryRevision = "UPDATE " + Table_Entries + " SET " + Table_Entries_Column_Revision + " = ?2" +
+                                                   " WHERE " + Table_Entries_Column_Id + " = ?1";
+  const std::string Statement_SetEntry = "UPDATE " + Table_Entries + " SET " + Table_Entries_Column_Type + " = ?1 , " +
+                                                                             Table_Entries_Column_Value + " = ?2 " +
+                                                                               "WHERE " + Table_Entries_Column_Id + " = ?3";
+  // next revision of an entry within an update, wraps around like in UpdateRevision()
+  const std::string Expression_NextRevision = "CASE " + Table_Entries_Column_Revision + " WHEN 9223372036854775807 THEN -9223372036854775808" +
+                                                                                      " ELSE " + Table_Entries_Column_Revision + " + 1 END";
+
+  // sets value and bumps revision of an entry only if the revision is still the expected one
+  const std::string Statement_SetEntryIf = "UPDATE " + Table_Entries + " SET " + Table_Entries_Column_Type + " = ?1 , " +
+                                                                               Table_Entries_Column_Value + " = ?2 , " +
+                                                                               Table_Entries_Column_Revision + " = " + Expression_NextRevision +
+                                                                                 " WHERE " + Table_Entries_Column_Id + " = ?3 AND " +
+                                                                                             Table_Entries_Column_Revision + " = ?4";
+
+  const std::string Statement_BumpEntryRevision = "UPDATE " + Table_Entries + " SET " + Table_Entries_Column_Revision + " = " + Expression_NextRevision +
+                                                    " WHERE " + Table_Entries_Column_Id + " = ?1";
+
+  // atomic value operations, see Store::UpdateEntryValue()
+  // Note: RETURNING requires SQLite 3.35.0 or newer
+  // a NULL value is read as 0 by GetInteger() and so incremented as 0
+  const std::string Statement_IncrementEntry = "UPDATE " + Table_Entries + " SET " + Table_Entries_Column_Value + " = COALESCE(" + Table_Entries_Column_Value + ", 0) + ?3 , " +
+                                                                                   Table_Entries_Column_Revision + " = " + Expression_NextRevision +
+                                                 " WHERE " + Table_Entries_Column_Id + " = ?1 AND " + Table_Entries_Column_Type + " = ?2 AND " +
+                                                   "CASE WHEN ?3 >= 0 THEN COALESCE(" + Table_Entries_Column_Value + ", 0) <= 9223372036854775807 - ?3" +
+                                                       " ELSE COALESCE(" + Table_Entries_Column_Value + ", 0) >= -9223372036854775808 - ?3 END" +
+                                                 " RETURNING " + Table_Entries_Column_Value;
+  // concatenation yields text, cast it back to blob, bytes are not changed as long as the database encoding is UTF-8
+  const std::string Statement_AppendEntry = "UPDATE " + Table_Entries + " SET " + Table_Entries_Column_Value + " = CAST(COALESCE(" + Table_Entries_Column_Value + ", X'') || COALESCE(?3, X'') AS BLOB) , " +
+                                                                                Table_Entries_Column_Revision + " = " + Expression_NextRevision +
+                                              " WHERE " + Table_Entries_Column_Id + " = ?1 AND " + Table_Entries_Column_Type + " = ?2" +
+                                              " RETURNING LENGTH(" + Table_Entries_Column_Value + ")";
+  const std::string Statement_CompareAndSwapEntry = "UPDATE " + Table_Entries + " SET " + Table_Entries_Column_Value + " = ?4 , " +
+                                                                                        Table_Entries_Column_Revision + " = " + Expression_NextRevision +
+                                                      " WHERE " + Table_Entries_Column_Id + " = ?1 AND " + Table_Entries_Column_Type + " = ?2 AND " +
+                                                                  ValueOrEmpty(Table_Entries_Column_Value, "?2") + " IS " + ValueOrEmpty("?3", "?2") +
+                                                      " RETURNING " + Table_Entries_Column_Id;
+  const std::string Statement_CreateEntry = "INSERT INTO " + Table_Entries + " (" + Table_Entries_Column_Name + "," +
+                                                                                    Table_Entries_Column_Parent + "," +
+                                                                                    Table_Entries_Column_Type + "," +
+                                                                                    Table_Entries_Column_Revision + "," +
+                                                                                    Table_Entries_Column_Value + "," +
+                                                                                    Table_Entries_Column_NameHash + "," +
+                                                                                    Table_Entries_Column_Descendants + "," +
+                                                                                    Table_Entries_Column_SubtreeSize + ") " +
+                                                                                      "VALUES (?1, ?2, ?3, ?4, ?5, ?6, 0, " + ValueSize("?5") + ")";
+  // same in full path mode, ?7 is the delimiter, children of entries without full name do not get one either
+  const std::string Statement_CreateEntryWithPath = "INSERT INTO " + Table_Entries + " (" + Table_Entries_Column_Name + "," +
+                                                                                            Table_Entries_Column_Parent + "," +
+                                                                                            Table_Entries_Column_Type + "," +
+                                                                                            Table_Entries_Column_Revision + "," +
+                                                                                            Table_Entries_Column_Value + "," +
+                                                                                            Table_Entries_Column_NameHash + "," +
+                                                                                            Table_Entries_Column_FullPath + "," +
+                                                                                            Table_Entries_Column_Descendants + "," +
+                                                                                            Table_Entries_Column_SubtreeSize + ") " +
+                                                      "VALUES (?1, ?2, ?3, ?4, ?5, ?6, CASE WHEN ?2 = 0 THEN ?1 ELSE (SELECT " + Table_Entries_Column_FullPath + " FROM " + Table_Entries +
+                                                                                                                       " WHERE " + Table_Entries_Column_Id + " = ?2) || ?7 || ?1 END, " +
+                                                              "0, " + ValueSize("?5") + ")";
+  // an entry and all its ancestors by the full name of the entry, root entry excluded, entry first
+  const std::string Statement_GetEntryIdByFullPath = "WITH RECURSIVE Ancestors(Id, Parent, Valid) AS (SELECT " + Table_Entries_Column_Id + "," + Table_Entries_Column_Parent + "," + NotExpired("?2") +
+                                                                                                              " FROM " + Table_Entries + " WHERE " + Table_Entries_Column_FullPath + " = ?1" +
+                                                                                                            " UNION ALL SELECT " + Table_Entries + "." + Table_Entries_Column_Id + "," + Table_Entries + "." + Table_Entries_Column_Parent + "," +
+                                                                                                                                   NotExpired("?2") + " FROM " + Table_Entries +
+                                                                                                              " JOIN Ancestors ON " + Table_Entries + "." + Table_Entries_Column_Id + " = Ancestors.Parent" +
+                                                                                                              " WHERE Ancestors.Parent != 0) " +
+                                                       "SELECT Id, Valid FROM Ancestors";
+  // only the entry itself by its full name, second column is 0 if the entry or any of its ancestors (full names being a prefix of ?1 followed by the delimiter ?3)
+  // is expired, only expired entries are looked at, expired entries without full name are taken as ancestors
+  const std::string Statement_GetTargetEntryIdByFullPath = "SELECT " + Table_Entries_Column_Id + ", NOT EXISTS (SELECT 1 FROM " + Table_Entries + " AS Expired" +
+                                                                                                  " WHERE Expired." + Table_Entries_Column_Expires + " <= ?2 AND" +
+                                                                                                        " (Expired." + Table_Entries_Column_FullPath + " IS NULL OR" +
+                                                                                                        " substr(?1 || ?3, 1, length(Expired." + Table_Entries_Column_FullPath + ") + 1) = Expired." + Table_Entries_Column_FullPath + " || ?3))" +
+                                                             " FROM " + Table_Entries + " WHERE " + Table_Entries_Column_FullPath + " = ?1";
+  const std::string Statement_GetEntryValue = "SELECT " + Table_Entries_Column_Value + " FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Id + " = ?1";
+  const std::string Statement_CountChildEntries = "SELECT COUNT(" + Table_Entries_Column_Id + ") FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Parent + " = ?1 AND " + NotExpired("?2");
+  const std::string Statement_GetChildEntries = "SELECT " + Table_Entries_Column_Id + " FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Parent + " = ?1 AND " + Table_Entries_Column_Id + " != 0";
+  const std::string Statement_GetChildEntryNames = "SELECT " + Table_Entries_Column_Name + " FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Parent + " = ?1 AND " + Table_Entries_Column_Id + " != 0 AND " + NotExpired("?2");
+  // next expiry time of the children of an entry, NULL if none of them expires
+  const std::string Statement_GetChildEntriesExpiry = "SELECT MIN(" + Table_Entries_Column_Expires + ") FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Parent + " = ?1 AND " + Table_Entries_Column_Id + " != 0";
+  const std::string Statement_GetExpiredEntry = "SELECT " + Table_Entries_Column_Id + " FROM " + Table_Entries +
+                                                  " WHERE " + Table_Entries_Column_Name + " = ?1 AND " +
+                                                              Table_Entries_Column_Parent + " = ?2 AND NOT " + NotExpired("?3");
+  const std::string Statement_GetEntryType = "SELECT " + Table_Entries_Column_Type + " FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Id + " = ?1";
+  const std::string Statement_DeleteEntry = "DELETE FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Id + " = ?1";
+
+  const std::vector<std::string> PreparedStatements = { Statement_GetEntryId,
+                                                        Statement_GetEntryIdByHash,
+                                                        Statement_GetEntryRevision,
+                                                        Statement_GetEntryRevisionAndNameHash,
+                                                        Statement_SetEntryRevision,
+                                                        Statement_SetEntry,
+                                                        Statement_SetEntryIf,
+                                                        Statement_BumpEntryRevision,
+                                                        Statement_IncrementEntry,
+                                                        Statement_AppendEntry,
+                                                        Statement_CompareAndSwapEntry,
+                                                        Statement_CreateEntry,
+                                                        Statement_CreateEntryWithPath,
+                                                        Statement_GetEntryIdByFullPath,
+                                                        Statement_GetTargetEntryIdByFullPath,
+                                                        Statement_GetEntryValue,
+                                                        Statement_CountChildEntries,
+                                                        Statement_GetChildEntries,
+                                                        Statement_GetChildEntryNames,
+                                                        Statement_GetChildEntriesExpiry,
+                                                        Statement_GetExpiredEntry,
+                                                        Statement_GetEntryType,
+                                                        Statement_DeleteEntry };
+
+
+  // time as stored in the Expires column
+  Configuration::Store::Integer ToStoreTime(const Configuration::Store::TimePoint& time)
+  {
+    return chrono::duration_cast<chrono::milliseconds>(time.time_since_epoch()).count();
+  }
+
+  Configuration::Store::TimePoint FromStoreTime(Configuration::Store::Integer time)
+  {
+    return Configuration::Store::TimePoint(chrono::duration_cast<Configuration::Store::TimePoint::duration>(chrono::milliseconds(time)));
+  }
 
+  Configuration::Store::Integer GetStoreTime()
+  {
+    return ToStoreTime(chrono::system_clock::now());
+  }
+
+  // type and value of difference from the type (column 0) and value (column 1) of an entry
+  void SetDifferenceValue(Configuration::Store::Difference& difference, SQLite::Statement& stm)
+  {
+    difference.EntryType = static_cast<Configuration::Store::ValueType>(stm.getColumn(0).getInt64());
+    difference.StringValue.clear();
+    difference.BinaryValue.clear();
+
+    switch (difference.EntryType)
+    {
+      case Configuration::Store::ValueType::Integer:
+        difference.IntegerValue = stm.getColumn(1).getInt64();
+        break;
+
+      case Configuration::Store::ValueType::String:
+        difference.StringValue = Configuration::UTF8ToWchar(stm.getColumn(1).getText());
+        break;
+
+      case Configuration::Store::ValueType::Binary:
+        difference.BinaryValue.resize(stm.getColumn(1).size());
+
+        if (!difference.BinaryValue.empty())
+        {
+          memcpy(difference.BinaryValue.data(), stm.getColumn(1).getBlob(), difference.BinaryValue.size());
+        }
+        break;
+    }
+  }
 
   wstring SQLiteDataTypeToStr(int type)
   {
@@ -98,27 +436,143 @@ namespace SQLite
 
 namespace Configuration
 {
+  namespace Detail
+  {
+    // pending writes of write-back mode, see Store::EnableWriteBack()
+    struct WriteBackBuffer
+    {
+      using Path  = std::vector<Store::String>;
+      using Value = boost::variant<Store::Integer, Store::String, Store::Binary>;
+
+      WriteBackBuffer(const Path& subtree, const Store::WriteBackPolicy& policy)
+      : m_Subtree(subtree), m_Policy(policy), m_Pending(), m_FirstPending()
+      {}
+
+      bool Contains(const Path& path) const
+      {
+        return (path.size() >= m_Subtree.size()) && equal(begin(m_Subtree), end(m_Subtree), begin(path));
+      }
+
+      static Store::ValueType GetType(const Value& value)
+      {
+        switch (value.which())
+        {
+          case 0:
+            return Store::ValueType::Integer;
+          case 1:
+            return Store::ValueType::String;
+          default:
+            return Store::ValueType::Binary;
+        }
+      }
+
+      Path                                  m_Subtree;
+      Store::WriteBackPolicy                m_Policy;
+      std::map<Path, Value>                 m_Pending;
+      std::chrono::steady_clock::time_point m_FirstPending;
+    };
+
+    class AddToBatch : public boost::static_visitor<>
+    {
+      public:
+        AddToBatch(WriteBatch& batch, const Store::String& name)
+        : m_Batch(batch), m_Name(name)
+        {}
+
+        template <typename T>
+        void operator()(const T& value) const
+        {
+          m_Batch.Set(m_Name, value);
+        }
+
+      private:
+        WriteBatch&          m_Batch;
+        const Store::String& m_Name;
+    };
+  }
+
   const Store::Integer Store::CurrentMajorVersion = 1;
-  const Store::Integer Store::CurrentMinorVersion = 0;
+  const Store::Integer Store::CurrentMinorVersion = 6;
 
   const Store::String::value_type Store::DefaultNameDelimiter = L'.';
 
+  const wstring Store::InMemoryFileName = L":memory:";
+
+  Store::Options::Options()
+  : SecureDelete(false), PrepareStatements(false), ChildrenCacheSize(0), HashNameLookup(false), SignalChanges(false)
+  {
+  }
+
+  Store::WriteBackPolicy::WriteBackPolicy()
+  : MaxPendingEntries(1000), MaxPendingTime(chrono::seconds(1))
+  {
+  }
+
+  Store::Stats::Stats()
+  : Descendants(0), Size(0)
+  {
+  }
+
+  Store::Difference::Difference()
+  : Type(DiffType::Changed), Name(), EntryType(DefaultEntryValueType), IntegerValue(DefaultEntryValue), StringValue(), BinaryValue()
+  {
+  }
+
   const Store::ValueType        Store::DefaultEntryValueType = ValueType::Integer;
   const Store::DefaultEntryType Store::DefaultEntryValue     = 0;
 
 
+  wstring Store::GetSharedInMemoryFileName(const wstring& name)
+  {
+    // URI filename, see https://www.sqlite.org/uri.html, percent-encode everything that might have a meaning in an URI
+    string encoded;
+
+    for (auto chr : WcharToUTF8(name))
+    {
+      if (isalnum(static_cast<unsigned char>(chr)) || (chr == '-') || (chr == '_') || (chr == '.'))
+      {
+        encoded += chr;
+      }
+      else
+      {
+        encoded += (boost::format("%%%02X") % static_cast<unsigned int>(static_cast<unsigned char>(chr))).str();
+      }
+    }
+
+    return UTF8ToWchar(SharedInMemoryFileNamePrefix + encoded + SharedInMemoryFileNameSuffix);
+  }
+
   // TODO: check if we should use SQLITE_OPEN_NOMUTEX instead of SQLITE_OPEN_FULLMUTEX and/or if we can be really multi-thread save with SQLITE_OPEN_FULLMUTEX!?
-  Store::Store(const wstring& fileName, bool create, wchar_t nameDelimiter)
-  : m_Database(make_unique<Database::element_type>(WcharToUTF8(fileName), SQLITE_OPEN_FULLMUTEX | SQLITE_OPEN_READWRITE | (create ? SQLITE_OPEN_CREATE : 0))),
-    m_DatabaseVersionMajor(0), m_DatabaseVersionMinor(0), m_Delimiter()
+  Store::Store(const wstring& fileName, bool create, wchar_t nameDelimiter, const Options& options)
+  : m_Database(), m_FileName(), m_InMemory(false), m_DatabaseVersionMajor(0), m_DatabaseVersionMinor(0), m_Delimiter(), m_HashNameLookup(options.HashNameLookup), m_FullPaths(false), m_SubtreeIndex(false), m_DataVersion(-1),
+    m_ChildrenCache(make_unique<ChildrenCache::element_type>(options.ChildrenCacheSize)), m_PendingHashes(),
+    m_WriteBack(), m_ChangeSignal()
   {
+    string utf8FileName = WcharToUTF8(fileName);
+
+    m_FileName = utf8FileName;
+
+    m_InMemory = (fileName == InMemoryFileName) ||
+                 ((utf8FileName.compare(0, SharedInMemoryFileNamePrefix.size(), SharedInMemoryFileNamePrefix) == 0) &&
+                  (utf8FileName.find("mode=memory") != string::npos));
+
+    // the header we have been built with may be newer than the library we run with
+    if (sqlite3_libversion_number() < 3035000)
+    {
+      throw ExceptionImpl<VersionNotSupported>((boost::wformat(L"SQLite version %1%, 3.35.0 or newer is required") % sqlite3_libversion()).str());
+    }
+
+    // in-memory databases always have to be created
+    m_Database = make_unique<Database::element_type>(utf8FileName, SQLITE_OPEN_FULLMUTEX | SQLITE_OPEN_READWRITE | SQLITE_OPEN_URI |
+                                                                   ((create || m_InMemory) ? SQLITE_OPEN_CREATE : 0));
 
     // set busy timeout
-    m_Database->setBusyTimeout(15000);  // max. wait is 15sec
+    m_Database->setBusyTimeout(BusyTimeout);
 
     // setup database basic database settings we can not change within a transaction
-    m_Database->exec("PRAGMA auto_vacuum = FULL");
-    m_Database->exec("PRAGMA synchronous = FULL");
+    // free pages are only returned to the file system by Compact(), saves moving pages around on every commit that frees pages
+    m_Database->exec("PRAGMA auto_vacuum = INCREMENTAL");
+    m_Database->exec(m_InMemory ? "PRAGMA synchronous = OFF" : "PRAGMA synchronous = FULL");  // nothing to sync for in-memory databases
     m_Database->exec("PRAGMA foreign_keys = TRUE");
 
     // open writeable transaction
@@ -127,10 +581,10 @@ namespace Configuration
     // setup database basic database settings
     m_Database->exec("PRAGMA encoding           = \"UTF-8\"");
     m_Database->exec("PRAGMA foreign_keys       = TRUE");
-    m_Database->exec("PRAGMA journal_mode       = DELETE");
+    m_Database->exec(m_InMemory ? "PRAGMA journal_mode       = MEMORY" : "PRAGMA journal_mode       = DELETE");
     m_Database->exec("PRAGMA locking_mode       = NORMAL");
     m_Database->exec("PRAGMA recursive_triggers = TRUE");
-    m_Database->exec("PRAGMA secure_delete      = TRUE");
+    m_Database->exec(options.SecureDelete ? "PRAGMA secure_delete      = TRUE" : "PRAGMA secure_delete      = FALSE");
 
     // TODO: add code to check or create our database layout! (define structure only once!)
 
@@ -145,10 +599,29 @@ namespace Configuration
                                                      Table_Entries_Column_Revision + " INTEGER  NOT NULL," +
                                                      Table_Entries_Column_Name +     " TEXT     NOT NULL, " +
                                                      Table_Entries_Column_Type +     " INTEGER  NOT NULL, " +
-                                                     Table_Entries_Column_Value +    " BLOB"  // we need NULL to store an empty BLOB ....
+                                                     Table_Entries_Column_Value +    " BLOB, " +  // we need NULL to store an empty BLOB ....
+                                                     Table_Entries_Column_Expires +  " INTEGER, " +
+                                                     Table_Entries_Column_Hash +     " INTEGER, " +
+                                                     Table_Entries_Column_HashRevision + " INTEGER, " +
+                                                     Table_Entries_Column_NameHash + " INTEGER, " +
+                                                     Table_Entries_Column_FullPath + " TEXT, " +
+                                                     Table_Entries_Column_Descendants + " INTEGER, " +
+                                                     Table_Entries_Column_SubtreeSize + " INTEGER"
+                                                     ")");
+
+    m_Database->exec("CREATE TABLE IF NOT EXISTS " + Table_History + "(" +
+                                                     Table_History_Column_EntryId +   " INTEGER  NOT NULL, " +
+                                                     Table_History_Column_Revision +  " INTEGER  NOT NULL, " +
+                                                     Table_History_Column_Type +      " INTEGER  NOT NULL, " +
+                                                     Table_History_Column_Value +     " BLOB, " +
+                                                     Table_History_Column_ValidFrom + " INTEGER, " +
+                                                     Table_History_Column_ValidTo +   " INTEGER  NOT NULL"
                                                      ")");
 
     // create index
+    m_Database->exec("CREATE INDEX IF NOT EXISTS " + Table_History_EntryId_Index + " ON " + Table_History + "(" + Table_History_Column_EntryId + "," +
+                                                                                                                  Table_History_Column_ValidTo + ")");
+
     m_Database->exec("CREATE INDEX IF NOT EXISTS " + Table_Entries_Name_Index + " ON " + Table_Entries + "(" + Table_Entries_Column_Name + ")");
 
     m_Database->exec("CREATE INDEX IF NOT EXISTS " + Table_Entries_Parent_Index + " ON " + Table_Entries + "(" + Table_Entries_Column_Parent + ")");
@@ -167,1045 +640,3457 @@ namespace Configuration
     GetAndCheckConfiguration(nameDelimiter);
     CheckOrSetRootEntry();
 
+    // needs columns added by UpgradeDatabase()
+    // only entries that expire are indexed, the index grows with the number of expiring entries and not with the size of the store
+    m_Database->exec("CREATE INDEX IF NOT EXISTS " + Table_Entries_Expires_Index + " ON " + Table_Entries + "(" + Table_Entries_Column_Expires + ")" +
+                       " WHERE " + Table_Entries_Column_Expires + " IS NOT NULL");
+
+    // fixed-width keys, also finds entries without a name hash quickly
+    m_Database->exec("CREATE INDEX IF NOT EXISTS " + Table_Entries_NameHash_Index + " ON " + Table_Entries + "(" + Table_Entries_Column_NameHash + ")");
+
+    UpdateNameHashes();
+
+    // also finds entries without full name quickly
+    m_Database->exec("CREATE INDEX IF NOT EXISTS " + Table_Entries_FullPath_Index + " ON " + Table_Entries + "(" + Table_Entries_Column_FullPath + ")");
+
+    CheckFullPaths();
+    ReadModes();
+
+    UpdateStats(false);
+    CreateStatsTriggers();
+
     transaction.Commit();
+
+    if (options.PrepareStatements)
+    {
+      PrepareStatements();
+    }
+
+    // after the commit above, opening a store is no change
+    if (options.SignalChanges)
+    {
+      m_ChangeSignal = make_unique<ChangeSignal>(fileName);
+    }
   }
 
   Store::~Store() noexcept
   {
+    try
+    {
+      Flush();
+    }
+    catch (...)
+    {
+      // nothing we can do about it, pending writes are lost
+    }
   }
 
-  void Store::GetAndCheckConfiguration(wchar_t nameDelimiter)
+  bool Store::IsInMemory() const noexcept
   {
-    // open writeable transaction
-    WriteableTransaction transaction(*this);
+    return m_InMemory;
+  }
 
-    // get and check version information
-    bool majorVersionExists = SettingExists(Setting_MajorVersion);
-    bool minorVersionExists = SettingExists(Setting_MinorVersion);
+  wstring Store::GetFileName() const
+  {
+    return UTF8ToWchar(m_FileName);
+  }
 
-    if (!majorVersionExists || !minorVersionExists)
-    {
-      if (majorVersionExists || minorVersionExists)  // check for partial version information
-      {
-        throw ExceptionImpl<InvalidConfiguration>(L"Partial version information found");
-      }
+  bool Store::IsInTransaction() const noexcept
+  {
+    return !m_Transaction.expired();
+  }
 
-      SetSetting(Setting_MajorVersion, CurrentMajorVersion);
-      SetSetting(Setting_MinorVersion, CurrentMinorVersion);
+  unique_ptr<ReadOnlyTransaction> Store::TryReadOnlyTransaction() const
+  {
+    if (!m_Transaction.expired())
+    {
+      return make_unique<ReadOnlyTransaction>(*this);
     }
 
-    m_DatabaseVersionMajor = GetSettingInt(Setting_MajorVersion);
-    m_DatabaseVersionMinor = GetSettingInt(Setting_MinorVersion);
+    // a deferred transaction takes the read lock with its first read
+    static const string Statement = "SELECT 1 FROM " + Table_Settings + " LIMIT 1";
 
-    if (m_DatabaseVersionMajor > CurrentMajorVersion)
-    {
-      throw ExceptionImpl<VersionNotSupported>(
-        (boost::wformat(L"Database version %1%.%2%") % m_DatabaseVersionMajor % m_DatabaseVersionMinor).str());
-    }
+    unique_ptr<ReadOnlyTransaction> transaction;
 
-    // get and check name delimiter
-    if (!SettingExists(Setting_NameDelimiter))
-    {
-      SetSetting(Setting_NameDelimiter, String(1, nameDelimiter));
-      m_Delimiter = nameDelimiter;
-    }
-    else
+    m_Database->setBusyTimeout(0);
+
+    try
     {
-      String delimiter = GetSettingStr(Setting_NameDelimiter);
+      auto locked = GetTransaction(false);
 
-      if (delimiter.size() != 1)
-      {
-        throw ExceptionImpl<InvalidConfiguration>(
-          (boost::wformat(L"Invalid value for %1% setting (%2%)") % UTF8ToWchar(Setting_NameDelimiter) % delimiter).str());
-      }
+      GetStatement(Statement)->executeStep();
 
-      if (delimiter.size() != 1)
+      transaction.reset(new ReadOnlyTransaction(locked));
+    }
+    catch (const SQLite::Exception& e)
+    {
+      if (e.getErrorCode() != SQLITE_BUSY)
       {
-        throw ExceptionImpl<InvalidDelimiterSetting>((boost::wformat(L"Expected delimiter string with length 1 in configuration but found %1%.") % delimiter).str());
+        m_Database->setBusyTimeout(BusyTimeout);
+        throw;
       }
-
-      m_Delimiter = delimiter.at(0);
     }
 
-    transaction.Commit();
+    m_Database->setBusyTimeout(BusyTimeout);
+
+    return transaction;
   }
 
-  void Store::CheckOrSetRootEntry()
+  void Store::LoadFrom(const wstring& fileName)
   {
+    // pending writes would be replayed over the loaded content
+    if (m_WriteBack)
+    {
+      m_WriteBack->m_Pending.clear();
+    }
+
+    // make sure fileName exists, contains a valid store and uses a database version we support
+    CheckSourceDatabase(fileName);
+
+    CopyDatabase(fileName, true);
+
+    // ids and revisions of the loaded entries have nothing to do with the ones we have cached
+    ClearCaches();
+
+    // delimiter and version information have been copied from the source
     WriteableTransaction transaction(*this);
 
-    static const string Statement1 = "SELECT " + Table_Entries_Column_Id + "," +
-                                                 Table_Entries_Column_Parent + "," +
-                                                 Table_Entries_Column_Type + "," +
-                                                 Table_Entries_Column_Name + "," +
-                                                 Table_Entries_Column_Value +
-                                                   " FROM " + Table_Entries + " WHERE (" + Table_Entries_Column_Id + " = 0)";
-    auto root = GetStatement(Statement1);
+    // the content of an older source has been copied into our layout, columns it did not have are filled in like by an upgrade
+    SetSetting(Setting_MajorVersion, CurrentMajorVersion);
+    SetSetting(Setting_MinorVersion, CurrentMinorVersion);
 
-    if (!root->executeStep())
-    {  // root entry not found
-      // make sure the table is empty if there is no root entry!
-      static const string Statement2 = "SELECT COUNT(" + Table_Entries_Column_Id + ") FROM " + Table_Entries;
-      auto count = GetStatement(Statement2);
+    GetAndCheckConfiguration(m_Delimiter);
+    CheckOrSetRootEntry();
+    UpdateNameHashes();
+    CheckFullPaths();
 
-      if (!count->executeStep())
-      {
-        throw ExceptionImpl<InvalidQuery>(L"Failed to query count of entries in table " + UTF8ToWchar(Table_Entries));
-      }
-      
-      if (count->getColumn(0).getInt64() != 0)
-      {
-        throw ExceptionImpl<RootEntryMissing>(L"Missing root entry in non-empty table " + UTF8ToWchar(Table_Entries));
-      }
+    // statistics have been copied along with the entries
+    m_Database->exec("DELETE FROM " + Table_StatsDelta);
 
-      // create new root entry
-      static const string Statement3 = "INSERT INTO " + Table_Entries + " (" + Table_Entries_Column_Id + "," +
-                                                                               Table_Entries_Column_Parent + "," +
-                                                                               Table_Entries_Column_Revision + "," +
-                                                                               Table_Entries_Column_Type + "," +
-                                                                               Table_Entries_Column_Name + "," +
-                                                                               Table_Entries_Column_Value + ") "
-                                                                                 "VALUES (0, 0, 0, ?1, ?2, ?3)";
-      auto newRoot = GetStatement(Statement3);
-      
-      newRoot->bind(1, static_cast<Integer>(DefaultEntryValueType));
-      newRoot->bind(2, Table_Entries_RootEntryName);
-      newRoot->bind(3, DefaultEntryValue);
+    UpdateStats(false);
 
-      if (newRoot->exec() != 1)
-      {
-        throw ExceptionImpl<InvalidInsert>(L"Failed to insert new root entry into table " + UTF8ToWchar(Table_Entries));
-      }
-    }
-    else
+    transaction.Commit();
+  }
+
+  void Store::SaveTo(const wstring& fileName) const
+  {
+    // make sure fileName exists and contains a valid database layout and uses a database version we support
     {
-      if ((root->getColumn(0).getInt64() != 0) ||
-          (root->getColumn(1).getInt64() != 0) ||
-          (root->getColumn(2).getInt64() != static_cast<Integer>(DefaultEntryValueType)) ||
-          (root->getColumn(3).getText()  != Table_Entries_RootEntryName) ||
-          (root->getColumn(4).getInt64() != 0))
-      {
-        throw ExceptionImpl<InvalidRootEntry>(L"Root entry contains invalid data");
-      }
+      Store target(fileName, true, m_Delimiter);
     }
 
-    transaction.Commit();
+    CopyDatabase(fileName, false);
   }
 
-  void Store::TraverseChildren(Integer id, std::function<void(Integer)> func) const
+  void Store::CheckSourceDatabase(const wstring& fileName)
   {
-    IdList children = GetChildEntries(id);
+    // opening the source as a Store object would upgrade it, it is only read
+    Database::element_type source(WcharToUTF8(fileName), SQLITE_OPEN_READONLY | SQLITE_OPEN_URI);
+
+    static const string Statement1 = "SELECT COUNT(*) FROM sqlite_master WHERE type = 'table' AND name IN ('" + Table_Settings + "','" + Table_Entries + "')";
+    static const string Statement2 = "SELECT " + Table_Settings_Column_Value + " FROM " + Table_Settings + " WHERE " + Table_Settings_Column_Name + " = ?1";
+    static const string Statement3 = "SELECT (SELECT COUNT(*) FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Id + " = 0), COUNT(*) FROM " + Table_Entries;
 
-    for (auto child : children)
     {
-      func(child);
+      Statement tables = make_unique<Statement::element_type>(source, Statement1);
 
-      TraverseChildren(child, func);
+      if (!tables->executeStep() || (tables->getColumn(0).getInt64() != 2))
+      {
+        throw ExceptionImpl<InvalidConfiguration>(L"No configuration store found in " + fileName);
+      }
     }
-  }
 
-  void Store::CheckDataConsistency() const
-  {
-    ReadOnlyTransaction transaction(*this);
+    Integer version[2];
 
-    // find all entries with a delimiter in name
     {
-      vector<Integer> badEntries;
+      Statement setting = make_unique<Statement::element_type>(source, Statement2);
 
-      static const string Statement1 = "SELECT DISTINCT " + Table_Entries_Column_Name + " FROM " + Table_Entries;
-      auto stm = GetStatement(Statement1);
-
-      while (stm->executeStep())
-      {      
-        string name = stm->getColumn(0).getText();
+      for (int i = 0; i < 2; i++)
+      {
+        setting->bind(1, (i == 0) ? Setting_MajorVersion : Setting_MinorVersion);
 
-        // TODO: maybe use IsValidName() instead of (partly) reimplementing it here!?!
-        if (UTF8ToWchar(name).find(m_Delimiter) != String::npos)
+        if (!setting->executeStep())
         {
-          static const string Statement2 = "SELECT " + Table_Entries_Column_Id + " FROM " + Table_Entries +
-                                             " WHERE " + Table_Entries_Column_Name + " = ?1";
-          auto stm2 = GetStatement(Statement2);
+          throw ExceptionImpl<InvalidConfiguration>(L"Missing version information in " + fileName);
+        }
 
-          stm2->bind(1, name);
+        version[i] = setting->getColumn(0).getInt64();
 
-          while (stm2->executeStep())
-          {
-            badEntries.push_back(stm2->getColumn(0).getInt64());
-          }
-        }
+        setting->reset();
       }
+    }
 
-      if (!badEntries.empty())
-      {
-        wstring msg = (boost::wformat(L"Found following %1% entries with name delimiter in name: ") % badEntries.size()).str();
-      
-        for (auto i : badEntries)
-        {
-          msg += (boost::wformat(L" %1%, ") % i).str();
-        }
+    if (version[0] > CurrentMajorVersion)
+    {
+      throw ExceptionImpl<VersionNotSupported>((boost::wformat(L"Database version %1%.%2%") % version[0] % version[1]).str());
+    }
 
-        msg.resize(msg.size() - 2);
+    {
+      Statement root = make_unique<Statement::element_type>(source, Statement3);
 
-        throw ExceptionImpl<InvalidEntryNameFound>(msg);
+      if (root->executeStep() && (root->getColumn(0).getInt64() == 0) && (root->getColumn(1).getInt64() != 0))
+      {
+        throw ExceptionImpl<RootEntryMissing>(L"Missing root entry in non-empty table " + UTF8ToWchar(Table_Entries) + L" of " + fileName);
       }
     }
+  }
 
-    // check linking of all entries!
+  void Store::CopyDatabase(const wstring& fileName, bool load) const
+  {
+    // ATTACH and DETACH are not allowed within a transaction
+    if (m_Transaction.lock())
     {
-      // get id of ALL entries except root entry
-      set<Integer> entries;
-
-      // TODO: find better name for IdCounterMap
-      using IdCounterMap = map<Integer, Integer>;  // id + counter
+      throw ExceptionImpl<InvalidTransaction>(L"Can not copy database content within a transaction");
+    }
 
-      IdCounterMap duplicateIds;
+    static const string StatementAttach = "ATTACH DATABASE ?1 AS " + AttachedDatabaseName;
 
-      static const string Statement3 = "SELECT " + Table_Entries_Column_Id + " FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Id + " != 0";
-      auto stm = GetStatement(Statement3);
+    Statement attach = make_unique<Statement::element_type>(*m_Database, StatementAttach);
 
-      while (stm->executeStep())
-      {        
-        bool inserted;
+    attach->bind(1, WcharToUTF8(fileName));
+    attach->exec();
 
-        Integer id = stm->getColumn(0).getInt64();
+    try
+    {
+      const string source = load ? AttachedDatabaseName + "." : "main.";
+      const string target = load ? "main." : AttachedDatabaseName + ".";
 
-        tie(ignore, inserted) = entries.insert(id);
+      // we are not within a transaction, so we can (and have to) use a SQLite transaction directly
+      SQLite::Transaction transaction(*m_Database, SQLite::Transaction::TransactionType::Immediate);
 
-        if (!inserted)  // ids must be unique
-        {
-          // insert id into duplicateIds or increment counter if already present
-          IdCounterMap::iterator iter;
-          bool inserted;
+      m_Database->exec("DELETE FROM " + target + Table_Settings);
+      m_Database->exec("INSERT INTO " + target + Table_Settings + " (" + Table_Settings_Columns + ") "
+                         "SELECT " + Table_Settings_Columns + " FROM " + source + Table_Settings);
 
-          tie(iter, inserted) = duplicateIds.insert(make_pair(id, 1));
+      // a source of an older version lacks the columns added since (and the history table), targets always have the current layout
+      string entriesColumns;
+      bool history = true;
 
-          if (!inserted)
-          {
-            iter->second++;
-          }
-        }
+      if (load)
+      {
+        Statement columns = make_unique<Statement::element_type>(*m_Database, "PRAGMA " + source + "table_info(" + Table_Entries + ")");
 
-        if (!duplicateIds.empty())
+        while (columns->executeStep())
         {
-          String ids;
+          string column = columns->getColumn(1).getText();
 
-          for (auto id : duplicateIds)
+          if (("," + Table_Entries_Columns + ",").find("," + column + ",") != string::npos)
           {
-            if (!ids.empty())
-            {
-              ids += L' ';
-            }
-
-            ids += (boost::wformat(L"(id: %1%, count: %2%)") % id.first % id.second).str();
+            entriesColumns += (entriesColumns.empty() ? "" : ",") + column;
           }
-
-          throw ExceptionImpl<EntryIdNotUnique>((boost::wformat(L"Found %1% entry ids that are not unique: %2%") % duplicateIds.size() % ids).str());
         }
-      }
-
-      IdCounterMap brokenLinks;
-
-      // traverse all entries from root according to linking and remove them from our entries set
-      TraverseChildren(0, [&entries, &brokenLinks](Integer id)
-      { 
-        // each entry may only be a child of one parent entry
-        if (entries.erase(id) != 1)
-        {
-          // add id to broken link list or increment counter if already in broken link list
-          IdCounterMap::iterator iter;
-          bool inserted;
 
-          tie(iter, inserted) = brokenLinks.insert(make_pair(id, 1));
+        Statement table = make_unique<Statement::element_type>(*m_Database, "SELECT COUNT(*) FROM " + source + "sqlite_master WHERE type = 'table' AND name = '" + Table_History + "'");
 
-          if (!inserted)
-          {
-            iter->second++;
-          }
-        }
-      });
-      
-      if (!brokenLinks.empty())
+        history = table->executeStep() && (table->getColumn(0).getInt64() != 0);
+      }
+      else
       {
-        String ids;
+        entriesColumns = Table_Entries_Columns;
+      }
 
-        for (auto id : brokenLinks)
-        {
-          if (!ids.empty())
-          {
-            ids += L' ';
-          }
+      m_Database->exec("DELETE FROM " + target + Table_Entries);
+      m_Database->exec("INSERT INTO " + target + Table_Entries + " (" + entriesColumns + ") "
+                         "SELECT " + entriesColumns + " FROM " + source + Table_Entries);
 
-          ids += (boost::wformat(L"(id: %1%, count: %2%)") % id.first % id.second).str();
-        }
+      // history refers to entry ids, they are copied unchanged
+      m_Database->exec("DELETE FROM " + target + Table_History);
 
-        throw ExceptionImpl<InvalidEntryLinking>((boost::wformat(L"Found %1% entries with broken linking: %2%") % entries.size() % ids).str());
+      if (history)
+      {
+        m_Database->exec("INSERT INTO " + target + Table_History + " (" + Table_History_Columns + ") "
+                           "SELECT " + Table_History_Columns + " FROM " + source + Table_History);
       }
 
-      if (!entries.empty())
-      {
-        String ids;
+      // triggers are not copied, the ones of target have to match the retention copied along with the settings
+      CreateHistoryTriggers(target);
 
-        for (auto id : entries)
-        {
-          if (!ids.empty())
-          {
-            ids += L' ';
-          }
+      // the subtree index of target stays, its triggers may have seen children before their parents (ids get reused)
+      Statement closure = make_unique<Statement::element_type>(*m_Database, "SELECT COUNT(*) FROM " + target + "sqlite_master WHERE type = 'table' AND name = '" + Table_Closure + "'");
+      bool rebuild = closure->executeStep() && (closure->getColumn(0).getInt64() != 0);
 
-          ids += (boost::wformat(L"%1%") % id).str();
-        }
+      closure->reset();
 
-        throw ExceptionImpl<AbandonedEntry>((boost::wformat(L"Found %1% abandoned entries: %2%") % entries.size() % ids).str());
+      if (rebuild)
+      {
+        m_Database->exec(BuildClosure(target));
       }
-    }
-  }
 
-  Store::Integer Store::RepairDataConsistency()
-  {
-    WriteableTransaction transaction(*this);
-
-    // TODO: move all dangling / damaged entries into lost&found table?
+      transaction.commit();
+    }
 
-    transaction.Commit();
+    catch (...)
+    {
+      m_Database->exec("DETACH DATABASE " + AttachedDatabaseName);
+      throw;
+    }
 
-    return 0;
+    m_Database->exec("DETACH DATABASE " + AttachedDatabaseName);
   }
 
+  void Store::UpgradeDatabase()
+  {
+    assert(m_Transaction.lock() && m_WriteableTransaction);
 
+    // 1.0 -> 1.1: expiry time of entries
+    if (m_DatabaseVersionMinor < 1)
+    {
+      m_Database->exec("ALTER TABLE " + Table_Entries + " ADD COLUMN " + Table_Entries_Column_Expires + " INTEGER");
+    }
 
-  Store::String::value_type Store::GetNameDelimiter() const noexcept
-  {
-    return m_Delimiter;
-  }
+    // 1.1 -> 1.2: history table, created together with all other tables
 
-  bool Store::IsValidName(const String& name, String::value_type delimiter)
-  {
-    // must not be empty
-    if (name.empty())
+    // 1.2 -> 1.3: content hashes of entries
+    if (m_DatabaseVersionMinor < 3)
     {
-      return false;
+      m_Database->exec("ALTER TABLE " + Table_Entries + " ADD COLUMN " + Table_Entries_Column_Hash + " INTEGER");
+      m_Database->exec("ALTER TABLE " + Table_Entries + " ADD COLUMN " + Table_Entries_Column_HashRevision + " INTEGER");
     }
 
-    // must not start or end with delimiter
-    if ((name.front() == delimiter) || (name.back() == delimiter))
+    // 1.3 -> 1.4: name hashes, computed by UpdateNameHashes() once the index exists
+    if (m_DatabaseVersionMinor < 4)
     {
-      return false;
+      m_Database->exec("ALTER TABLE " + Table_Entries + " ADD COLUMN " + Table_Entries_Column_NameHash + " INTEGER");
     }
 
-    // must not contain multiple consecutive delimiters
-    if (name.find(String(2, delimiter)) != String::npos)
+    // 1.4 -> 1.5: full names of entries, only used in full path mode
+    if (m_DatabaseVersionMinor < 5)
     {
-      return false;
+      m_Database->exec("ALTER TABLE " + Table_Entries + " ADD COLUMN " + Table_Entries_Column_FullPath + " TEXT");
     }
 
-    return true;
+    // 1.5 -> 1.6: subtree statistics, computed by UpdateStats()
+    if (m_DatabaseVersionMinor < 6)
+    {
+      m_Database->exec("ALTER TABLE " + Table_Entries + " ADD COLUMN " + Table_Entries_Column_Descendants + " INTEGER");
+      m_Database->exec("ALTER TABLE " + Table_Entries + " ADD COLUMN " + Table_Entries_Column_SubtreeSize + " INTEGER");
+    }
+
+    SetSetting(Setting_MinorVersion, CurrentMinorVersion);
+    m_DatabaseVersionMinor = CurrentMinorVersion;
   }
 
-  Store::Path Store::ParseName(const String& name) const
+  void Store::UpdateNameHashes()
   {
-    if (!IsValidName(name))
+    assert(m_Transaction.lock() && m_WriteableTransaction);
+
+    static const string Statement1 = "SELECT " + Table_Entries_Column_Id + "," + Table_Entries_Column_Parent + "," + Table_Entries_Column_Name + " FROM " + Table_Entries +
+                                       " WHERE " + Table_Entries_Column_NameHash + " IS NULL";
+    static const string Statement2 = "UPDATE " + Table_Entries + " SET " + Table_Entries_Column_NameHash + " = ?2 WHERE " + Table_Entries_Column_Id + " = ?1";
+
+    // collect first, updating the rows we are iterating over is undefined in SQLite
+    vector<pair<Integer, Integer>> hashes;
+
     {
-      throw ExceptionImpl<InvalidName>(L"Invalid name: " + name);
-    }
-    
-    String delimiter;
-    delimiter += m_Delimiter;    
+      auto stm = GetStatement(Statement1);
 
-    using Tok = boost::tokenizer<boost::char_separator<String::value_type>, String::const_iterator, String>;
+      while (stm->executeStep())
+      {
+        hashes.push_back(make_pair(stm->getColumn(0).getInt64(), GetNameHash(stm->getColumn(1).getInt64(), string(stm->getColumn(2).getText(), stm->getColumn(2).size()))));
+      }
+    }
 
-    Tok tok(name, boost::char_separator<String::value_type>(delimiter.c_str(), 0));
+    auto update = GetStatement(Statement2);
 
-    return Path(begin(tok), end(tok));
+    for (const auto& hash : hashes)
+    {
+      update->bind(1, hash.first);
+      update->bind(2, hash.second);
+      update->exec();
+      update->reset();
+    }
   }
 
-  Store::String Store::PathToName(const Path& path) const
+  Store::Integer Store::GetNameHash(Integer parent, const string& name)
   {
-    String str;
-    String::value_type delim = m_Delimiter;
+    // name first, the hash of a name can be continued for different parents
+    ContentHasher hasher;
 
-    for_each(begin(path), end(path), [=, &str](const String& name) { if (!str.empty()) str += delim; str += name; });
+    hasher.Add(name.data(), name.size());
+    hasher.Add(static_cast<uint64_t>(parent));
 
-    return str;
+    return static_cast<Integer>(hasher.Get());
   }
 
-  Store::String Store::ValueTypeToString(ValueType type) const
+  void Store::SetFullPathMode(bool enable)
   {
-    switch (type)
-    {
-      case ValueType::Integer:
-        return L"Integer";
-        break;
+    WriteableTransaction transaction(*this);
 
-      case ValueType::String:
-        return L"String";
-        break;
+    if (enable)
+    {
+      UpdateFullPaths();
+    }
+    else
+    {
+      DeleteSetting(Setting_FullPaths);
+      m_Database->exec("UPDATE " + Table_Entries + " SET " + Table_Entries_Column_FullPath + " = NULL WHERE " + Table_Entries_Column_FullPath + " IS NOT NULL");
+    }
 
-      case ValueType::Binary:
-        return L"Binary";
-        break;
+    transaction.Commit();
 
-      default:
-        return (boost::wformat(L"Unknown type (%1%)") % static_cast<Integer>(type)).str();
-    }
+    m_FullPaths = enable;
   }
 
-  bool Store::GetEntryId(IdList& idPath, const String& name, Integer parent) const
+  bool Store::IsFullPathMode() const noexcept
   {
-    assert(m_Transaction.lock());
+    return m_FullPaths;
+  }
 
-    static const string Statement = "SELECT " + Table_Entries_Column_Id + " FROM " + Table_Entries +
-                                      " WHERE " + Table_Entries_Column_Name + " = ?1 AND " +
-                                                  Table_Entries_Column_Parent + " = ?2";
-    auto stm = GetStatement(Statement);
+  void Store::SetSubtreeIndex(bool enable)
+  {
+    WriteableTransaction transaction(*this);
 
-    stm->bind(1, WcharToUTF8(name));
-    stm->bind(2, parent);
+    m_Database->exec("DROP TRIGGER IF EXISTS " + Trigger_Closure_Insert);
+    m_Database->exec("DROP TRIGGER IF EXISTS " + Trigger_Closure_Delete);
+    m_Database->exec("DROP TABLE IF EXISTS " + Table_Closure);
 
-    if (!stm->executeStep())
+    if (enable)
     {
-      return false;
+      // clustered by ancestor and depth, subtrees are read parents first by a single range scan
+      m_Database->exec("CREATE TABLE " + Table_Closure + "(" +
+                                         Table_Closure_Column_Ancestor +   " INTEGER NOT NULL, " +
+                                         Table_Closure_Column_Descendant + " INTEGER NOT NULL, " +
+                                         Table_Closure_Column_Depth +      " INTEGER NOT NULL, " +
+                                         "PRIMARY KEY (" + Table_Closure_Column_Ancestor + "," + Table_Closure_Column_Depth + "," + Table_Closure_Column_Descendant + ")" +
+                                         ") WITHOUT ROWID");
+
+      m_Database->exec("CREATE INDEX " + Table_Closure_Descendant_Index + " ON " + Table_Closure + "(" + Table_Closure_Column_Descendant + "," + Table_Closure_Column_Ancestor + ")");
+
+      // an entry gets the ancestors of its parent plus itself, the root entry only itself
+      m_Database->exec("CREATE TRIGGER " + Trigger_Closure_Insert + " AFTER INSERT ON " + Table_Entries + " " +
+                         "BEGIN " +
+                           "INSERT INTO " + Table_Closure + " (" + Table_Closure_Column_Ancestor + "," + Table_Closure_Column_Descendant + "," + Table_Closure_Column_Depth + ") " +
+                             "SELECT " + Table_Closure_Column_Ancestor + ", NEW." + Table_Entries_Column_Id + "," + Table_Closure_Column_Depth + " + 1 FROM " + Table_Closure +
+                               " WHERE " + Table_Closure_Column_Descendant + " = NEW." + Table_Entries_Column_Parent + " AND NEW." + Table_Entries_Column_Id + " != 0" +
+                             " UNION ALL SELECT NEW." + Table_Entries_Column_Id + ", NEW." + Table_Entries_Column_Id + ", 0; " +
+                         "END");
+
+      m_Database->exec("CREATE TRIGGER " + Trigger_Closure_Delete + " AFTER DELETE ON " + Table_Entries + " " +
+                         "BEGIN " +
+                           "DELETE FROM " + Table_Closure + " WHERE " + Table_Closure_Column_Descendant + " = OLD." + Table_Entries_Column_Id + "; " +
+                         "END");
+
+      m_Database->exec(BuildClosure(""));
     }
 
-    idPath.push_back(stm->getColumn(0).getInt64());
-
-    assert(!stm->executeStep());
+    transaction.Commit();
 
-    return true;
+    m_SubtreeIndex = enable;
   }
 
-  bool Store::GetEntryId(IdList& idPath, Path::const_iterator& lastValid, const Path& path, Integer parent) const
+  bool Store::HasSubtreeIndex() const noexcept
   {
-    lastValid = end(path);
-    idPath.clear();
+    return m_SubtreeIndex;
+  }
 
-    for (auto iter = begin(path); iter != end(path); iter++)
-    {
-      if (!GetEntryId(idPath, *iter, !idPath.empty() ? idPath.back() : parent))
-      {
-        return false;
-      }
+  void Store::CreateStatsTriggers()
+  {
+    assert(m_Transaction.lock() && m_WriteableTransaction);
 
-      lastValid = iter;
-    }
+    const string columns = " (" + Table_StatsDelta_Column_EntryId + "," + Table_StatsDelta_Column_Descendants + "," + Table_StatsDelta_Column_Size + ") ";
 
-    assert(idPath.size() > 0);
+    m_Database->exec("CREATE TEMP TABLE IF NOT EXISTS " + Table_StatsDelta + "(" +
+                                                     Table_StatsDelta_Column_EntryId +     " INTEGER NOT NULL, " +
+                                                     Table_StatsDelta_Column_Descendants + " INTEGER NOT NULL, " +
+                                                     Table_StatsDelta_Column_Size +        " INTEGER NOT NULL" +
+                                                     ")");
 
-    return true;
+    // the new entry itself gets its statistics by the insert, pending changes of a deleted entry with the same id are stale
+    m_Database->exec("CREATE TEMP TRIGGER IF NOT EXISTS " + Trigger_Stats_Insert + " AFTER INSERT ON main." + Table_Entries +
+                       " WHEN NEW." + Table_Entries_Column_Id + " != 0 " +
+                       "BEGIN " +
+                         "DELETE FROM " + Table_StatsDelta + " WHERE " + Table_StatsDelta_Column_EntryId + " = NEW." + Table_Entries_Column_Id + "; " +
+                         "INSERT INTO " + Table_StatsDelta + columns + "VALUES (NEW." + Table_Entries_Column_Parent + ", 1, " + ValueSize("NEW." + Table_Entries_Column_Value) + "); " +
+                       "END");
+
+    m_Database->exec("CREATE TEMP TRIGGER IF NOT EXISTS " + Trigger_Stats_Update + " AFTER UPDATE OF " + Table_Entries_Column_Value + " ON main." + Table_Entries +
+                       " WHEN " + ValueSize("OLD." + Table_Entries_Column_Value) + " != " + ValueSize("NEW." + Table_Entries_Column_Value) + " " +
+                       "BEGIN " +
+                         "INSERT INTO " + Table_StatsDelta + columns + "VALUES (NEW." + Table_Entries_Column_Id + ", 0, " +
+                           ValueSize("NEW." + Table_Entries_Column_Value) + " - " + ValueSize("OLD." + Table_Entries_Column_Value) + "); " +
+                       "END");
+
+    // changes pending for descendants of a deleted entry are dropped with it, its own statistics do not include them yet
+    m_Database->exec("CREATE TEMP TRIGGER IF NOT EXISTS " + Trigger_Stats_Delete + " AFTER DELETE ON main." + Table_Entries + " " +
+                       "BEGIN " +
+                         "INSERT INTO " + Table_StatsDelta + columns + "VALUES (OLD." + Table_Entries_Column_Parent + ", " +
+                           "-1 - OLD." + Table_Entries_Column_Descendants + ", -OLD." + Table_Entries_Column_SubtreeSize + "); " +
+                       "END");
   }
 
-  bool Store::GetEntryId(IdList& idPath, const Path& path, Integer parent) const
+  void Store::ApplyStatsDeltas()
   {
-    Path::const_iterator iter;
+    assert(m_Transaction.lock() && m_WriteableTransaction);
 
-    return GetEntryId(idPath, iter, path, parent);
+    // each change goes to its entry and all ancestors, changes of entries deleted in the meantime stop right there
+    static const string Statement1 = "WITH RECURSIVE Up(Id, Count, Bytes) AS (SELECT " + Table_StatsDelta_Column_EntryId + "," + Table_StatsDelta_Column_Descendants + "," +
+                                                                                              Table_StatsDelta_Column_Size + " FROM " + Table_StatsDelta +
+                                                                                   " UNION ALL SELECT " + Table_Entries + "." + Table_Entries_Column_Parent + ", Up.Count, Up.Bytes FROM " + Table_Entries +
+                                                                                     " JOIN Up ON " + Table_Entries + "." + Table_Entries_Column_Id + " = Up.Id WHERE Up.Id != 0), " +
+                                            "Sums(Id, Count, Bytes) AS (SELECT Id, SUM(Count), SUM(Bytes) FROM Up GROUP BY Id) " +
+                                     "UPDATE " + Table_Entries + " SET " + Table_Entries_Column_Descendants + " = " + Table_Entries_Column_Descendants + " + Sums.Count, " +
+                                                                           Table_Entries_Column_SubtreeSize + " = " + Table_Entries_Column_SubtreeSize + " + Sums.Bytes" +
+                                       " FROM Sums WHERE " + Table_Entries + "." + Table_Entries_Column_Id + " = Sums.Id";
+    static const string Statement2 = "DELETE FROM " + Table_StatsDelta;
+
+    GetStatement(Statement1)->exec();
+    GetStatement(Statement2)->exec();
   }
 
-  Store::IdList Store::GetEntryId(const Path& path, Integer parent) const
+  void Store::UpdateStats(bool always)
   {
-    IdList idPath;
+    assert(m_Transaction.lock() && m_WriteableTransaction);
 
-    if (!GetEntryId(idPath, path, parent))
+    // entries created by versions before 1.6
+    static const string Statement1 = "SELECT 1 FROM " + Table_Entries + " WHERE " + Table_Entries_Column_SubtreeSize + " IS NULL LIMIT 1";
+
+    if (!always)
     {
-      throw ExceptionImpl<EntryNotFound>(L"Entry not found: " + PathToName(path));
-    }
+      auto stm = GetStatement(Statement1);
 
-    assert(!idPath.empty());
+      if (!stm->executeStep())
+      {
+        return;
+      }
+    }
 
-    return idPath;
+    // each entry counts for all its ancestors
+    static const string Statement2 = "UPDATE " + Table_Entries + " SET " + Table_Entries_Column_Descendants + " = 0, " +
+                                                                           Table_Entries_Column_SubtreeSize + " = " + ValueSize(Table_Entries_Column_Value);
+    static const string Statement3 = "WITH RECURSIVE Up(Id, Bytes) AS (SELECT " + Table_Entries_Column_Parent + "," + ValueSize(Table_Entries_Column_Value) + " FROM " + Table_Entries +
+                                                                       " WHERE " + Table_Entries_Column_Id + " != 0" +
+                                                                     " UNION ALL SELECT " + Table_Entries + "." + Table_Entries_Column_Parent + ", Up.Bytes FROM " + Table_Entries +
+                                                                       " JOIN Up ON " + Table_Entries + "." + Table_Entries_Column_Id + " = Up.Id WHERE Up.Id != 0), " +
+                                            "Sums(Id, Count, Bytes) AS (SELECT Id, COUNT(*), SUM(Bytes) FROM Up GROUP BY Id) " +
+                                     "UPDATE " + Table_Entries + " SET " + Table_Entries_Column_Descendants + " = Sums.Count, " +
+                                                                           Table_Entries_Column_SubtreeSize + " = " + Table_Entries_Column_SubtreeSize + " + Sums.Bytes" +
+                                       " FROM Sums WHERE " + Table_Entries + "." + Table_Entries_Column_Id + " = Sums.Id";
+
+    GetStatement(Statement2)->exec();
+    GetStatement(Statement3)->exec();
   }
 
-  Store::IdList Store::GetEntryId(const String& entryName, Integer parent) const
+  void Store::RebuildStats()
   {
-    Path path;
+    WriteableTransaction transaction(*this);
 
-    path.push_back(entryName);
+    m_Database->exec("DELETE FROM " + Table_StatsDelta);
 
-    return GetEntryId(path, parent);
-  }
+    UpdateStats(true);
 
-  bool Store::Exists(const Path& path) const
-  {
-    IdList id;
-    
-    return GetEntryId(id, path);
+    transaction.Commit();
   }
 
-  bool Store::Exists(const String& name) const
+  Store::Stats Store::GetStats(const String& name) const
   {
     ReadOnlyTransaction transaction(*this);
 
-    return Exists(ParseName(name));
-  }
-  
-  Store::Integer Store::GetEntryRevision(Integer id) const
-  {
+    Integer id = name.empty() ? 0 : GetTargetEntryId(ParseName(name));
+
+    static const string Statement = "SELECT " + Table_Entries_Column_Descendants + "," + Table_Entries_Column_SubtreeSize + " FROM " + Table_Entries +
+                                      " WHERE " + Table_Entries_Column_Id + " = ?1";
+    auto stm = GetStatement(Statement);
+
+    stm->bind(1, id);
+
+    if (!stm->executeStep())
+    {
+      throw ExceptionImpl<InvalidQuery>(L"Failed to query statistics of entry: " + name);
+    }
+
+    Stats stats;
+
+    stats.Descendants = stm->getColumn(0).getInt64();
+    stats.Size = stm->getColumn(1).getInt64();
+
+    return stats;
+  }
+
+  void Store::CheckFullPaths()
+  {
+    assert(m_Transaction.lock() && m_WriteableTransaction);
+
+    if (!m_FullPaths)
+    {
+      return;
+    }
+
+    // entries created by versions before 1.5 or by Store objects that did not know about full path mode yet
+    if (HasMissingFullPaths() || (GetSettingStr(Setting_FullPaths) != String(1, m_Delimiter)))
+    {
+      UpdateFullPaths();
+    }
+  }
+
+  bool Store::HasMissingFullPaths() const
+  {
+    assert(m_Transaction.lock());
+
+    static const string Statement = "SELECT 1 FROM " + Table_Entries + " WHERE " + Table_Entries_Column_FullPath + " IS NULL AND " + Table_Entries_Column_Id + " != 0 LIMIT 1";
+    auto stm = GetStatement(Statement);
+
+    return stm->executeStep();
+  }
+
+  void Store::ReadModes() const
+  {
+    assert(m_Transaction.lock());
+
+    // changes with each commit of another connection (not with ours, see GetTransaction())
+    static const string Statement1 = "PRAGMA data_version";
+    Integer dataVersion;
+
+    {
+      auto stm = GetStatement(Statement1);
+
+      if (!stm->executeStep())
+      {
+        throw ExceptionImpl<InvalidQuery>(L"Failed to query data version");
+      }
+
+      dataVersion = stm->getColumn(0).getInt64();
+
+      stm->reset();
+    }
+
+    if (dataVersion == m_DataVersion)
+    {
+      return;
+    }
+
+    m_DataVersion = dataVersion;
+    m_FullPaths = SettingExists(Setting_FullPaths);
+
+    // the triggers of an index created or dropped by another Store object are already in effect for us
+    static const string Statement2 = "SELECT COUNT(*) FROM sqlite_master WHERE type = 'table' AND name = '" + Table_Closure + "'";
+    auto stm = GetStatement(Statement2);
+
+    m_SubtreeIndex = stm->executeStep() && (stm->getColumn(0).getInt64() != 0);
+
+    // a pending read of the schema would lock the table for SetSubtreeIndex() within the same transaction
+    stm->reset();
+  }
+
+  void Store::UpdateFullPaths()
+  {
+    assert(m_Transaction.lock() && m_WriteableTransaction);
+
+    // Note: UPDATE FROM requires SQLite 3.33.0 or newer
+    static const string Statement = "WITH RECURSIVE Paths(Id, Path) AS (SELECT " + Table_Entries_Column_Id + "," + Table_Entries_Column_Name + " FROM " + Table_Entries +
+                                                                         " WHERE " + Table_Entries_Column_Parent + " = 0 AND " + Table_Entries_Column_Id + " != 0" +
+                                                                       " UNION ALL SELECT " + Table_Entries + "." + Table_Entries_Column_Id + ", Paths.Path || ?1 || " + Table_Entries + "." + Table_Entries_Column_Name +
+                                                                         " FROM " + Table_Entries + " JOIN Paths ON " + Table_Entries + "." + Table_Entries_Column_Parent + " = Paths.Id) " +
+                                    "UPDATE " + Table_Entries + " SET " + Table_Entries_Column_FullPath + " = Paths.Path FROM Paths" +
+                                      " WHERE " + Table_Entries + "." + Table_Entries_Column_Id + " = Paths.Id AND " + Table_Entries + "." + Table_Entries_Column_FullPath + " IS NOT Paths.Path";
+    auto stm = GetStatement(Statement);
+
+    stm->bind(1, WcharToUTF8(String(1, m_Delimiter)));
+    stm->exec();
+
+    SetSetting(Setting_FullPaths, String(1, m_Delimiter));
+  }
+
+  bool Store::GetEntryIdByFullPath(IdList& idPath, const Path& path) const
+  {
+    assert(m_Transaction.lock());
+
+    auto stm = GetStatement(Statement_GetEntryIdByFullPath);
+
+    stm->bind(1, WcharToUTF8(PathToName(path)));
+    stm->bind(2, GetStoreTime());
+
+    idPath.clear();
+
+    while (stm->executeStep())
+    {
+      if (stm->getColumn(1).getInt() == 0)
+      {
+        return false;
+      }
+
+      idPath.push_back(stm->getColumn(0).getInt64());
+    }
+
+    reverse(begin(idPath), end(idPath));
+
+    return idPath.size() == path.size();
+  }
+
+  void Store::GetAndCheckConfiguration(wchar_t nameDelimiter)
+  {
+    // open writeable transaction
+    WriteableTransaction transaction(*this);
+
+    // get and check version information
+    bool majorVersionExists = SettingExists(Setting_MajorVersion);
+    bool minorVersionExists = SettingExists(Setting_MinorVersion);
+
+    if (!majorVersionExists || !minorVersionExists)
+    {
+      if (majorVersionExists || minorVersionExists)  // check for partial version information
+      {
+        throw ExceptionImpl<InvalidConfiguration>(L"Partial version information found");
+      }
+
+      SetSetting(Setting_MajorVersion, CurrentMajorVersion);
+      SetSetting(Setting_MinorVersion, CurrentMinorVersion);
+    }
+
+    m_DatabaseVersionMajor = GetSettingInt(Setting_MajorVersion);
+    m_DatabaseVersionMinor = GetSettingInt(Setting_MinorVersion);
+
+    if (m_DatabaseVersionMajor > CurrentMajorVersion)
+    {
+      throw ExceptionImpl<VersionNotSupported>(
+        (boost::wformat(L"Database version %1%.%2%") % m_DatabaseVersionMajor % m_DatabaseVersionMinor).str());
+    }
+
+    if ((m_DatabaseVersionMajor == CurrentMajorVersion) && (m_DatabaseVersionMinor < CurrentMinorVersion))
+    {
+      UpgradeDatabase();
+    }
+
+    // get and check name delimiter
+    if (!SettingExists(Setting_NameDelimiter))
+    {
+      SetSetting(Setting_NameDelimiter, String(1, nameDelimiter));
+      m_Delimiter = nameDelimiter;
+    }
+    else
+    {
+      String delimiter = GetSettingStr(Setting_NameDelimiter);
+
+      if (delimiter.size() != 1)
+      {
+        throw ExceptionImpl<InvalidConfiguration>(
+          (boost::wformat(L"Invalid value for %1% setting (%2%)") % UTF8ToWchar(Setting_NameDelimiter) % delimiter).str());
+      }
+
+      if (delimiter.size() != 1)
+      {
+        throw ExceptionImpl<InvalidDelimiterSetting>((boost::wformat(L"Expected delimiter string with length 1 in configuration but found %1%.") % delimiter).str());
+      }
+
+      m_Delimiter = delimiter.at(0);
+    }
+
+    m_FullPaths = SettingExists(Setting_FullPaths);
+
+    transaction.Commit();
+  }
+
+  void Store::CheckOrSetRootEntry()
+  {
+    WriteableTransaction transaction(*this);
+
+    static const string Statement1 = "SELECT " + Table_Entries_Column_Id + "," +
+                                                 Table_Entries_Column_Parent + "," +
+                                                 Table_Entries_Column_Type + "," +
+                                                 Table_Entries_Column_Name + "," +
+                                                 Table_Entries_Column_Value +
+                                                   " FROM " + Table_Entries + " WHERE (" + Table_Entries_Column_Id + " = 0)";
+    auto root = GetStatement(Statement1);
+
+    if (!root->executeStep())
+    {  // root entry not found
+      // make sure the table is empty if there is no root entry!
+      static const string Statement2 = "SELECT COUNT(" + Table_Entries_Column_Id + ") FROM " + Table_Entries;
+      auto count = GetStatement(Statement2);
+
+      if (!count->executeStep())
+      {
+        throw ExceptionImpl<InvalidQuery>(L"Failed to query count of entries in table " + UTF8ToWchar(Table_Entries));
+      }
+      
+      if (count->getColumn(0).getInt64() != 0)
+      {
+        throw ExceptionImpl<RootEntryMissing>(L"Missing root entry in non-empty table " + UTF8ToWchar(Table_Entries));
+      }
+
+      // create new root entry
+      static const string Statement3 = "INSERT INTO " + Table_Entries + " (" + Table_Entries_Column_Id + "," +
+                                                                               Table_Entries_Column_Parent + "," +
+                                                                               Table_Entries_Column_Revision + "," +
+                                                                               Table_Entries_Column_Type + "," +
+                                                                               Table_Entries_Column_Name + "," +
+                                                                               Table_Entries_Column_Value + "," +
+                                                                               Table_Entries_Column_Descendants + "," +
+                                                                               Table_Entries_Column_SubtreeSize + ") "
+                                                                                 "VALUES (0, 0, 0, ?1, ?2, ?3, 0, " + ValueSize("?3") + ")";
+      auto newRoot = GetStatement(Statement3);
+      
+      newRoot->bind(1, static_cast<Integer>(DefaultEntryValueType));
+      newRoot->bind(2, Table_Entries_RootEntryName);
+      newRoot->bind(3, DefaultEntryValue);
+
+      if (newRoot->exec() != 1)
+      {
+        throw ExceptionImpl<InvalidInsert>(L"Failed to insert new root entry into table " + UTF8ToWchar(Table_Entries));
+      }
+    }
+    else
+    {
+      if ((root->getColumn(0).getInt64() != 0) ||
+          (root->getColumn(1).getInt64() != 0) ||
+          (root->getColumn(2).getInt64() != static_cast<Integer>(DefaultEntryValueType)) ||
+          (root->getColumn(3).getText()  != Table_Entries_RootEntryName) ||
+          (root->getColumn(4).getInt64() != 0))
+      {
+        throw ExceptionImpl<InvalidRootEntry>(L"Root entry contains invalid data");
+      }
+    }
+
+    transaction.Commit();
+  }
+
+  double Store::GetFreePageRatio() const
+  {
+    ReadOnlyTransaction transaction(*this);
+
+    auto freePages = GetStatement("PRAGMA freelist_count");
+    auto allPages  = GetStatement("PRAGMA page_count");
+
+    if (!freePages->executeStep() || !allPages->executeStep())
+    {
+      throw ExceptionImpl<InvalidQuery>(L"Failed to query page count");
+    }
+
+    Integer free = freePages->getColumn(0).getInt64();
+    Integer all  = allPages->getColumn(0).getInt64();
+
+    return (all > 0) ? static_cast<double>(free) / static_cast<double>(all) : 0.0;
+  }
+
+  Store::Integer Store::Compact(Integer maxPages)
+  {
+    WriteableTransaction transaction(*this);
+
+    auto freePages = GetStatement("PRAGMA freelist_count");
+
+    if (!freePages->executeStep())
+    {
+      throw ExceptionImpl<InvalidQuery>(L"Failed to query number of free pages");
+    }
+
+    Integer before = freePages->getColumn(0).getInt64();
+
+    // pragma arguments can not be bound
+    m_Database->exec((boost::format("PRAGMA incremental_vacuum(%1%)") % max<Integer>(maxPages, 0)).str());
+
+    freePages->reset();
+
+    if (!freePages->executeStep())
+    {
+      throw ExceptionImpl<InvalidQuery>(L"Failed to query number of free pages");
+    }
+
+    Integer after = freePages->getColumn(0).getInt64();
+
+    transaction.Commit();
+
+    return before - after;
+  }
+
+  void Store::Optimize()
+  {
+    WriteableTransaction transaction(*this);
+
+    // PRAGMA optimize only analyzes tables whose statistics are out of date, depending on the SQLite version this does
+    // not include tables that have never been analyzed, so we run a full ANALYZE the first time
+    static const string Statement = "SELECT COUNT(*) FROM sqlite_master WHERE type = 'table' AND name = 'sqlite_stat1'";
+    auto stm = GetStatement(Statement);
+
+    if (!stm->executeStep())
+    {
+      throw ExceptionImpl<InvalidQuery>(L"Failed to query for statistics table");
+    }
+
+    bool analyzed = stm->getColumn(0).getInt64() != 0;
+
+    stm->reset();
+
+    m_Database->exec(analyzed ? "PRAGMA optimize" : "ANALYZE");
+
+    transaction.Commit();
+  }
+
+  void Store::TraverseChildren(Integer id, std::function<void(Integer)> func) const
+  {
+    IdList children = GetChildEntries(id);
+
+    for (auto child : children)
+    {
+      func(child);
+
+      TraverseChildren(child, func);
+    }
+  }
+
+  Store::Integer Store::GetEntryHash(Integer id) const
+  {
+    assert(m_Transaction.lock());
+
+    static const string Statement1 = "SELECT " + Table_Entries_Column_Name + "," + Table_Entries_Column_Type + "," + Table_Entries_Column_Value + "," +
+                                                 Table_Entries_Column_Revision + "," + Table_Entries_Column_HashRevision + "," + Table_Entries_Column_Hash + "," +
+                                                 Table_Entries_Column_Expires +
+                                       " FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Id + " = ?1";
+    ContentHasher hasher;
+    Integer revision;
+
+    {
+      auto stm = GetStatement(Statement1);
+
+      stm->bind(1, id);
+
+      if (!stm->executeStep())
+      {
+        throw ExceptionImpl<InvalidQuery>((boost::wformat(L"Failed to query content of entry: %1%") % id).str());
+      }
+
+      revision = stm->getColumn(3).getInt64();
+
+      // any change of the entry or of one of its descendants bumps its revision
+      if (!stm->isColumnNull(4) && (stm->getColumn(4).getInt64() == revision))
+      {
+        return stm->getColumn(5).getInt64();
+      }
+
+      auto pending = m_PendingHashes.find(id);
+
+      if ((pending != end(m_PendingHashes)) && (pending->second.m_Revision == revision))
+      {
+        return pending->second.m_Hash;
+      }
+
+      ValueType type = static_cast<ValueType>(stm->getColumn(1).getInt64());
+
+      hasher.Add(stm->getColumn(0).getText(), stm->getColumn(0).size());
+      hasher.Add(static_cast<uint64_t>(type));
+
+      if (type == ValueType::Integer)
+      {
+        hasher.Add(static_cast<uint64_t>(stm->getColumn(2).getInt64()));
+      }
+      else
+      {
+        hasher.Add(stm->getColumn(2).getBlob(), stm->getColumn(2).size());
+      }
+
+      // entries expiring at different times are different, Diff() skips subtrees of equal hashes whatever has expired meanwhile
+      hasher.Add(static_cast<uint64_t>(stm->isColumnNull(6) ? 0 : 1));
+
+      if (!stm->isColumnNull(6))
+      {
+        hasher.Add(static_cast<uint64_t>(stm->getColumn(6).getInt64()));
+      }
+    }
+
+    // children have been ordered by name, hashes do not depend on the order entries have been created in
+    for (const auto& child : GetNamedChildEntries(id))
+    {
+      hasher.Add(static_cast<uint64_t>(GetEntryHash(child.second)));
+    }
+
+    Integer hash = static_cast<Integer>(hasher.Get());
+
+    if (m_WriteableTransaction)
+    {
+      static const string Statement2 = "UPDATE " + Table_Entries + " SET " + Table_Entries_Column_Hash + " = ?2, " +
+                                                                             Table_Entries_Column_HashRevision + " = ?3" +
+                                         " WHERE " + Table_Entries_Column_Id + " = ?1";
+      auto stm = GetStatement(Statement2);
+
+      stm->bind(1, id);
+      stm->bind(2, hash);
+      stm->bind(3, revision);
+
+      stm->exec();
+    }
+    else
+    {
+      m_PendingHashes[id] = CachedHash{revision, hash};
+    }
+
+    return hash;
+  }
+
+  void Store::PersistHashes() const
+  {
+    if (m_PendingHashes.empty() || m_Transaction.lock())
+    {
+      return;
+    }
+
+    // only entries that have not been changed meanwhile
+    static const string Statement = "UPDATE " + Table_Entries + " SET " + Table_Entries_Column_Hash + " = ?2, " +
+                                                                        Table_Entries_Column_HashRevision + " = ?3" +
+                                      " WHERE " + Table_Entries_Column_Id + " = ?1 AND " + Table_Entries_Column_Revision + " = ?3";
+
+    // hashes only save work, rather compute them again than wait for another writer
+    m_Database->setBusyTimeout(0);
+
+    try
+    {
+      auto transaction = GetTransaction(true);
+
+      {
+        auto stm = GetStatement(Statement);
+
+        for (const auto& pending : m_PendingHashes)
+        {
+          stm->bind(1, pending.first);
+          stm->bind(2, pending.second.m_Hash);
+          stm->bind(3, pending.second.m_Revision);
+          stm->exec();
+          stm->reset();
+        }
+      }
+
+      transaction->commit();
+
+      m_PendingHashes.clear();
+    }
+    catch (const SQLite::Exception&)
+    {
+      // kept for the next time
+    }
+
+    m_Database->setBusyTimeout(BusyTimeout);
+  }
+
+  void Store::DiffEntries(Integer id, const Store& other, Integer otherId, const String& name, Integer now, Difference& difference, const DifferenceCallback& callback) const
+  {
+    if (GetEntryHash(id) == other.GetEntryHash(otherId))
+    {
+      return;
+    }
+
+    // the root entry has no value of its own
+    if (id != 0)
+    {
+      static const string Statement = "SELECT " + Table_Entries_Column_Type + "," + Table_Entries_Column_Value + " FROM " + Table_Entries +
+                                        " WHERE " + Table_Entries_Column_Id + " = ?1";
+      auto stm = GetStatement(Statement);
+      auto otherStm = other.GetStatement(Statement);
+
+      stm->bind(1, id);
+      otherStm->bind(1, otherId);
+
+      if (!stm->executeStep() || !otherStm->executeStep())
+      {
+        throw ExceptionImpl<InvalidQuery>((boost::wformat(L"Failed to query content of entry: %1%") % id).str());
+      }
+
+      int size = stm->getColumn(1).size();
+
+      if ((stm->getColumn(0).getInt64() != otherStm->getColumn(0).getInt64()) ||
+          (size != otherStm->getColumn(1).size()) ||
+          ((size != 0) && (memcmp(stm->getColumn(1).getBlob(), otherStm->getColumn(1).getBlob(), size) != 0)))
+      {
+        difference.Type = DiffType::Changed;
+        difference.Name = name;
+
+        SetDifferenceValue(difference, *otherStm);
+
+        callback(difference);
+      }
+    }
+
+    // merge both ordered lists of children
+    auto children = GetNamedChildEntries(id, now);
+    auto otherChildren = other.GetNamedChildEntries(otherId, now);
+
+    auto child = begin(children);
+    auto otherChild = begin(otherChildren);
+
+    auto childName = [&name, this](const string& child) { return name.empty() ? UTF8ToWchar(child) : name + m_Delimiter + UTF8ToWchar(child); };
+
+    while ((child != end(children)) || (otherChild != end(otherChildren)))
+    {
+      if ((otherChild == end(otherChildren)) || ((child != end(children)) && (child->first < otherChild->first)))
+      {
+        ReportEntries(*this, child->second, childName(child->first), DiffType::Removed, now, difference, callback);
+
+        child++;
+      }
+      else if ((child == end(children)) || (otherChild->first < child->first))
+      {
+        ReportEntries(other, otherChild->second, childName(otherChild->first), DiffType::Added, now, difference, callback);
+
+        otherChild++;
+      }
+      else
+      {
+        DiffEntries(child->second, other, otherChild->second, childName(child->first), now, difference, callback);
+
+        child++;
+        otherChild++;
+      }
+    }
+  }
+
+  void Store::ReportEntries(const Store& store, Integer id, const String& name, DiffType type, Integer now, Difference& difference, const DifferenceCallback& callback) const
+  {
+    difference.Type = type;
+    difference.Name = name;
+
+    if (type != DiffType::Removed)
+    {
+      static const string Statement = "SELECT " + Table_Entries_Column_Type + "," + Table_Entries_Column_Value + " FROM " + Table_Entries +
+                                        " WHERE " + Table_Entries_Column_Id + " = ?1";
+      auto stm = store.GetStatement(Statement);
+
+      stm->bind(1, id);
+
+      if (!stm->executeStep())
+      {
+        throw ExceptionImpl<InvalidQuery>((boost::wformat(L"Failed to query content of entry: %1%") % id).str());
+      }
+
+      SetDifferenceValue(difference, *stm);
+    }
+
+    callback(difference);
+
+    for (const auto& child : store.GetNamedChildEntries(id, now))
+    {
+      ReportEntries(store, child.second, name + m_Delimiter + UTF8ToWchar(child.first), type, now, difference, callback);
+    }
+  }
+
+  void Store::CheckDataConsistency(size_t threads) const
+  {
+    threads = Detail::GetThreadCount(threads);
+
+    // connections of the workers would not see changes of a transaction of ours that has not been committed yet
+    if ((threads == 1) || (m_FileName == WcharToUTF8(InMemoryFileName)) || m_Transaction.lock())
+    {
+      CheckDataConsistencyImpl();
+      return;
+    }
+
+    static const string Statement1 = "SELECT COUNT(" + Table_Entries_Column_Id + "), MIN(" + Table_Entries_Column_Id + "), MAX(" + Table_Entries_Column_Id + ")" +
+                                       " FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Id + " != 0";
+    // a deferred transaction takes the read lock with its first read
+    static const string Statement2 = "SELECT 1 FROM " + Table_Settings + " LIMIT 1";
+
+    vector<unique_ptr<SQLite::Database>> databases;
+
+    for (size_t i = 0; i < threads; i++)
+    {
+      databases.push_back(make_unique<SQLite::Database>(m_FileName, SQLITE_OPEN_READONLY | SQLITE_OPEN_URI | SQLITE_OPEN_FULLMUTEX));
+
+      // see LockAll(), once the read lock is held reads do not wait anyway
+      databases.back()->setBusyTimeout(0);
+    }
+
+    unique_ptr<ReadOnlyTransaction>          transaction;
+    vector<unique_ptr<SQLite::Transaction>>  transactions(threads);
+    Integer                                  count = 0;
+    Integer                                  first = 0;
+    Integer                                  last = 0;
+
+    // all connections hold their read locks before any of them is used, writers can not commit until all workers are done
+    // and so all of them see the same state
+    Detail::LockAll(threads + 1, [&](size_t index, bool wait)
+    {
+      if (index == 0)
+      {
+        transaction = make_unique<ReadOnlyTransaction>(*this);
+
+        auto stm = GetStatement(Statement1);
+
+        if (!stm->executeStep())
+        {
+          throw ExceptionImpl<InvalidQuery>(L"Failed to query count of entries in table " + UTF8ToWchar(Table_Entries));
+        }
+
+        count = stm->getColumn(0).getInt64();
+        first = stm->getColumn(1).getInt64();
+        last = stm->getColumn(2).getInt64();
+
+        return true;
+      }
+
+      auto& database = *databases[index - 1];
+
+      transactions[index - 1] = make_unique<SQLite::Transaction>(database, SQLite::Transaction::TransactionType::Deferred);
+
+      try
+      {
+        SQLite::Statement(database, Statement2).executeStep();
+      }
+      catch (const SQLite::Exception& e)
+      {
+        transactions[index - 1].reset();
+
+        if (wait || (e.getErrorCode() != SQLITE_BUSY))
+        {
+          throw;
+        }
+
+        return false;
+      }
+
+      return true;
+    },
+    [&](size_t index)
+    {
+      if (index == 0)
+      {
+        transaction.reset();
+      }
+      else
+      {
+        transactions[index - 1].reset();
+      }
+    });
+
+    if (count == 0)
+    {
+      return;
+    }
+
+    // names and types are checked per id range, linking per top level subtree (each entry has exactly one parent, so
+    // entries reachable from the root entry are counted exactly once)
+    static const string Statement3 = "SELECT " + Table_Entries_Column_Id + "," + Table_Entries_Column_Name + "," + Table_Entries_Column_Type + " FROM " + Table_Entries +
+                                       " WHERE " + Table_Entries_Column_Id + " BETWEEN ?1 AND ?2 AND " + Table_Entries_Column_Id + " != 0";
+    static const string Statement4 = "WITH RECURSIVE Subtree(Id) AS (SELECT " + Table_Entries_Column_Id + " FROM " + Table_Entries +
+                                                                      " WHERE " + Table_Entries_Column_Parent + " = 0 AND " + Table_Entries_Column_Id + " != 0 AND " +
+                                                                                  "ABS(" + Table_Entries_Column_Id + ") % ?1 = ?2" +
+                                                                    " UNION ALL SELECT " + Table_Entries + "." + Table_Entries_Column_Id + " FROM " + Table_Entries +
+                                                                      " JOIN Subtree ON " + Table_Entries + "." + Table_Entries_Column_Parent + " = Subtree.Id) " +
+                                       "SELECT COUNT(Id) FROM Subtree";
+
+    Integer span = ((last - first) / static_cast<Integer>(threads)) + 1;
+
+    vector<IdList>  badNames(threads);
+    vector<IdList>  badTypes(threads);
+    vector<Integer> reached(threads, 0);
+
+    Detail::RunParallel(threads, [&](size_t index)
+    {
+      auto& database = *databases[index];
+
+      SQLite::Statement entries(database, Statement3);
+
+      entries.bind(1, first + (span * static_cast<Integer>(index)));
+      entries.bind(2, first + (span * static_cast<Integer>(index + 1)) - 1);
+
+      while (entries.executeStep())
+      {
+        // names of entries are single path components
+        String name = UTF8ToWchar(entries.getColumn(1).getText());
+
+        if (!IsValidName(name, m_Delimiter) || (name.find(m_Delimiter) != String::npos))
+        {
+          badNames[index].push_back(entries.getColumn(0).getInt64());
+        }
+
+        Integer type = entries.getColumn(2).getInt64();
+
+        if ((type < static_cast<Integer>(ValueType::Integer)) || (type > static_cast<Integer>(ValueType::Binary)))
+        {
+          badTypes[index].push_back(entries.getColumn(0).getInt64());
+        }
+      }
+
+      SQLite::Statement subtrees(database, Statement4);
+
+      subtrees.bind(1, static_cast<Integer>(threads));
+      subtrees.bind(2, static_cast<Integer>(index));
+
+      if (!subtrees.executeStep())
+      {
+        throw ExceptionImpl<InvalidQuery>(L"Failed to query count of linked entries in table " + UTF8ToWchar(Table_Entries));
+      }
+
+      reached[index] = subtrees.getColumn(0).getInt64();
+    });
+
+    auto merge = [](const vector<IdList>& lists)
+    {
+      IdList ids;
+
+      for (const auto& list : lists)
+      {
+        ids.insert(end(ids), begin(list), end(list));
+      }
+
+      String text;
+
+      for (auto id : ids)
+      {
+        text += (text.empty() ? L"" : L", ") + to_wstring(id);
+      }
+
+      return make_pair(ids.size(), text);
+    };
+
+    auto names = merge(badNames);
+
+    if (names.first > 0)
+    {
+      throw ExceptionImpl<InvalidEntryNameFound>((boost::wformat(L"Found following %1% entries with invalid name: %2%") % names.first % names.second).str());
+    }
+
+    auto types = merge(badTypes);
+
+    if (types.first > 0)
+    {
+      throw ExceptionImpl<UnknownEntryType>((boost::wformat(L"Found following %1% entries with unknown type: %2%") % types.first % types.second).str());
+    }
+
+    Integer linked = 0;
+
+    for (auto i : reached)
+    {
+      linked += i;
+    }
+
+    if (linked != count)
+    {
+      // the sequential check finds out which entries are broken
+      CheckDataConsistencyImpl();
+
+      throw ExceptionImpl<InvalidEntryLinking>((boost::wformat(L"Found %1% entries not linked to the root entry") % (count - linked)).str());
+    }
+  }
+
+  void Store::CheckDataConsistencyImpl() const
+  {
+    ReadOnlyTransaction transaction(*this);
+
+    // find all entries with an invalid name (e.g. empty or containing the delimiter), the root entry has none
+    {
+      vector<Integer> badEntries;
+
+      static const string Statement1 = "SELECT DISTINCT " + Table_Entries_Column_Name + " FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Id + " != 0";
+      auto stm = GetStatement(Statement1);
+
+      while (stm->executeStep())
+      {      
+        string name = stm->getColumn(0).getText();
+        String wideName = UTF8ToWchar(name);
+
+        // names of entries are single path components
+        if (!IsValidName(wideName, m_Delimiter) || (wideName.find(m_Delimiter) != String::npos))
+        {
+          static const string Statement2 = "SELECT " + Table_Entries_Column_Id + " FROM " + Table_Entries +
+                                             " WHERE " + Table_Entries_Column_Name + " = ?1 AND " + Table_Entries_Column_Id + " != 0";
+          auto stm2 = GetStatement(Statement2);
+
+          stm2->bind(1, name);
+
+          while (stm2->executeStep())
+          {
+            badEntries.push_back(stm2->getColumn(0).getInt64());
+          }
+        }
+      }
+
+      if (!badEntries.empty())
+      {
+        wstring msg = (boost::wformat(L"Found following %1% entries with invalid name: ") % badEntries.size()).str();
+      
+        for (auto i : badEntries)
+        {
+          msg += (boost::wformat(L" %1%, ") % i).str();
+        }
+
+        msg.resize(msg.size() - 2);
+
+        throw ExceptionImpl<InvalidEntryNameFound>(msg);
+      }
+    }
+
+    // find all entries with an unknown type
+    {
+      vector<Integer> badEntries;
+
+      static const string Statement = "SELECT " + Table_Entries_Column_Id + " FROM " + Table_Entries +
+                                        " WHERE " + Table_Entries_Column_Id + " != 0 AND " + Table_Entries_Column_Type + " NOT IN (" +
+                                          to_string(static_cast<int>(ValueType::Integer)) + "," + to_string(static_cast<int>(ValueType::String)) + "," +
+                                          to_string(static_cast<int>(ValueType::Binary)) + ")";
+      auto stm = GetStatement(Statement);
+
+      while (stm->executeStep())
+      {
+        badEntries.push_back(stm->getColumn(0).getInt64());
+      }
+
+      if (!badEntries.empty())
+      {
+        wstring msg = (boost::wformat(L"Found following %1% entries with unknown type: ") % badEntries.size()).str();
+
+        for (auto i : badEntries)
+        {
+          msg += (boost::wformat(L" %1%, ") % i).str();
+        }
+
+        msg.resize(msg.size() - 2);
+
+        throw ExceptionImpl<UnknownEntryType>(msg);
+      }
+    }
+
+    // check linking of all entries!
+    {
+      // get id of ALL entries except root entry
+      set<Integer> entries;
+
+      // TODO: find better name for IdCounterMap
+      using IdCounterMap = map<Integer, Integer>;  // id + counter
+
+      IdCounterMap duplicateIds;
+
+      static const string Statement3 = "SELECT " + Table_Entries_Column_Id + " FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Id + " != 0";
+      auto stm = GetStatement(Statement3);
+
+      while (stm->executeStep())
+      {        
+        bool inserted;
+
+        Integer id = stm->getColumn(0).getInt64();
+
+        tie(ignore, inserted) = entries.insert(id);
+
+        if (!inserted)  // ids must be unique
+        {
+          // insert id into duplicateIds or increment counter if already present
+          IdCounterMap::iterator iter;
+          bool inserted;
+
+          tie(iter, inserted) = duplicateIds.insert(make_pair(id, 1));
+
+          if (!inserted)
+          {
+            iter->second++;
+          }
+        }
+
+        if (!duplicateIds.empty())
+        {
+          String ids;
+
+          for (auto id : duplicateIds)
+          {
+            if (!ids.empty())
+            {
+              ids += L' ';
+            }
+
+            ids += (boost::wformat(L"(id: %1%, count: %2%)") % id.first % id.second).str();
+          }
+
+          throw ExceptionImpl<EntryIdNotUnique>((boost::wformat(L"Found %1% entry ids that are not unique: %2%") % duplicateIds.size() % ids).str());
+        }
+      }
+
+      IdCounterMap brokenLinks;
+
+      // traverse all entries from root according to linking and remove them from our entries set
+      TraverseChildren(0, [&entries, &brokenLinks](Integer id)
+      { 
+        // each entry may only be a child of one parent entry
+        if (entries.erase(id) != 1)
+        {
+          // add id to broken link list or increment counter if already in broken link list
+          IdCounterMap::iterator iter;
+          bool inserted;
+
+          tie(iter, inserted) = brokenLinks.insert(make_pair(id, 1));
+
+          if (!inserted)
+          {
+            iter->second++;
+          }
+        }
+      });
+      
+      if (!brokenLinks.empty())
+      {
+        String ids;
+
+        for (auto id : brokenLinks)
+        {
+          if (!ids.empty())
+          {
+            ids += L' ';
+          }
+
+          ids += (boost::wformat(L"(id: %1%, count: %2%)") % id.first % id.second).str();
+        }
+
+        throw ExceptionImpl<InvalidEntryLinking>((boost::wformat(L"Found %1% entries with broken linking: %2%") % entries.size() % ids).str());
+      }
+
+      if (!entries.empty())
+      {
+        String ids;
+
+        for (auto id : entries)
+        {
+          if (!ids.empty())
+          {
+            ids += L' ';
+          }
+
+          ids += (boost::wformat(L"%1%") % id).str();
+        }
+
+        throw ExceptionImpl<AbandonedEntry>((boost::wformat(L"Found %1% abandoned entries: %2%") % entries.size() % ids).str());
+      }
+    }
+  }
+
+  Store::Integer Store::RepairDataConsistency()
+  {
+    WriteableTransaction transaction(*this);
+
+    // TODO: move all dangling / damaged entries into lost&found table?
+
+    transaction.Commit();
+
+    return 0;
+  }
+
+
+
+  Store::String::value_type Store::GetNameDelimiter() const noexcept
+  {
+    return m_Delimiter;
+  }
+
+  bool Store::IsValidName(const String& name, String::value_type delimiter)
+  {
+    // must not be empty, start or end with delimiter or contain multiple consecutive delimiters
+    return Detail::ScanName(name.data(), name.size(), delimiter);
+  }
+
+  Store::Path Store::ParseName(const String& name) const
+  {
+    // validates and finds the segments in one pass
+    Detail::DelimiterPositions delimiters;
+
+    if (!Detail::ScanName(name.data(), name.size(), m_Delimiter, &delimiters))
+    {
+      throw ExceptionImpl<InvalidName>(L"Invalid name: " + name);
+    }
+
+    Path path;
+    size_t first = 0;
+
+    path.reserve(delimiters.size() + 1);
+
+    for (auto pos : delimiters)
+    {
+      path.emplace_back(name, first, pos - first);
+      first = pos + 1;
+    }
+
+    path.emplace_back(name, first, String::npos);
+
+    return path;
+  }
+
+  Store::String Store::PathToName(const Path& path) const
+  {
+    String str;
+    String::value_type delim = m_Delimiter;
+
+    for_each(begin(path), end(path), [=, &str](const String& name) { if (!str.empty()) str += delim; str += name; });
+
+    return str;
+  }
+
+  Store::String Store::ValueTypeToString(ValueType type) const
+  {
+    switch (type)
+    {
+      case ValueType::Integer:
+        return L"Integer";
+        break;
+
+      case ValueType::String:
+        return L"String";
+        break;
+
+      case ValueType::Binary:
+        return L"Binary";
+        break;
+
+      default:
+        return (boost::wformat(L"Unknown type (%1%)") % static_cast<Integer>(type)).str();
+    }
+  }
+
+  bool Store::GetEntryId(IdList& idPath, const String& name, Integer parent) const
+  {
+    return GetEntryId(idPath, WcharToUTF8(name), parent);
+  }
+
+  bool Store::GetEntryId(IdList& idPath, const string& name, Integer parent) const
+  {
+    assert(m_Transaction.lock());
+
+    auto stm = GetStatement(m_HashNameLookup ? Statement_GetEntryIdByHash : Statement_GetEntryId);
+
+    stm->bind(1, name);
+    stm->bind(2, parent);
+    stm->bind(3, GetStoreTime());
+
+    if (m_HashNameLookup)
+    {
+      stm->bind(4, GetNameHash(parent, name));
+    }
+
+    if (!stm->executeStep())
+    {
+      return false;
+    }
+
+    idPath.push_back(stm->getColumn(0).getInt64());
+
+    assert(!stm->executeStep());
+
+    return true;
+  }
+
+  bool Store::GetEntryId(IdList& idPath, Path::const_iterator& lastValid, const Path& path, Integer parent) const
+  {
+    // a miss is resolved segment by segment below, callers need to know which part of the path exists
+    if (m_FullPaths && (parent == 0) && !path.empty() && GetEntryIdByFullPath(idPath, path))
+    {
+      lastValid = end(path) - 1;
+      return true;
+    }
+
+    lastValid = end(path);
+    idPath.clear();
+
+    for (auto iter = begin(path); iter != end(path); iter++)
+    {
+      if (!GetEntryId(idPath, *iter, !idPath.empty() ? idPath.back() : parent))
+      {
+        return false;
+      }
+
+      lastValid = iter;
+    }
+
+    assert(idPath.size() > 0);
+
+    return true;
+  }
+
+  bool Store::GetEntryId(IdList& idPath, const Path& path, Integer parent) const
+  {
+    Path::const_iterator iter;
+
+    return GetEntryId(idPath, iter, path, parent);
+  }
+
+  Store::IdList Store::GetEntryId(const Path& path, Integer parent) const
+  {
+    IdList idPath;
+
+    if (!GetEntryId(idPath, path, parent))
+    {
+      throw ExceptionImpl<EntryNotFound>(L"Entry not found: " + PathToName(path));
+    }
+
+    assert(!idPath.empty());
+
+    return idPath;
+  }
+
+  bool Store::GetTargetEntryId(Integer& id, const Path& path) const
+  {
+    // in full path mode a single probe, as long as no entry on the path is expired there is no need to check the ancestors
+    // entries without full name are not found and resolved segment by segment below
+    if (m_FullPaths && !path.empty())
+    {
+      auto stm = GetStatement(Statement_GetTargetEntryIdByFullPath);
+
+      stm->bind(1, WcharToUTF8(PathToName(path)));
+      stm->bind(2, GetStoreTime());
+      stm->bind(3, WcharToUTF8(String(1, m_Delimiter)));
+
+      if (stm->executeStep() && (stm->getColumn(1).getInt() != 0))
+      {
+        id = stm->getColumn(0).getInt64();
+        return true;
+      }
+    }
+
+    IdList idPath;
+
+    if (!GetEntryId(idPath, path))
+    {
+      return false;
+    }
+
+    id = idPath.back();
+
+    return true;
+  }
+
+  Store::Integer Store::GetTargetEntryId(const Path& path) const
+  {
+    Integer id;
+
+    if (!GetTargetEntryId(id, path))
+    {
+      throw ExceptionImpl<EntryNotFound>(L"Entry not found: " + PathToName(path));
+    }
+
+    return id;
+  }
+
+  Store::IdList Store::GetEntryId(const String& entryName, Integer parent) const
+  {
+    Path path;
+
+    path.push_back(entryName);
+
+    return GetEntryId(path, parent);
+  }
+
+  bool Store::Exists(const Path& path) const
+  {
+    Integer id;
+    
+    return GetTargetEntryId(id, path);
+  }
+
+  bool Store::Exists(const String& name) const
+  {
+    ReadOnlyTransaction transaction(*this);
+
+    return Exists(ParseName(name));
+  }
+  
+  Store::Integer Store::GetEntryRevision(Integer id) const
+  {
     static_assert((sizeof(GetEntryRevision(0)) * 8) >= 64, 
                   "Revision returned by GetEntryRevision() must be at least 64 bits wide");
     static_assert(is_same<decltype(GetEntryRevision(0)), Store::Integer>::value,
                   "We currently require GetEntryRevision() to return an Store::Integer, implementation detail");
 
-    assert(m_Transaction.lock());
+    assert(m_Transaction.lock());
+
+    auto stm = GetStatement(Statement_GetEntryRevision);
+
+    stm->bind(1, id);
+
+    if (!stm->executeStep())
+    {
+      throw ExceptionImpl<InvalidQuery>((boost::wformat(L"Failed to query revision of entry: %1%") % id).str());
+    }
+
+    Integer revision = stm->getColumn(0).getInt64();
+
+    assert(!stm->executeStep());
+
+    return revision;
+  }
+
+  void Store::GetEntryRevisions(const vector<Revision>& handles, bool checkHandles, vector<Revision>& revisions) const
+  {
+    assert(m_Transaction.lock());
+
+    // fixed number of parameters so the statement can be cached, unused ones get an id no entry has
+    static const size_t Count = 64;
+    static const string Statement = []
+    {
+      string params;
+
+      for (size_t i = 1; i <= Count; i++)
+      {
+        params += ((i > 1) ? ",?" : "?") + to_string(i);
+      }
+
+      return "SELECT " + Table_Entries_Column_Id + "," + Table_Entries_Column_Revision + "," + Table_Entries_Column_NameHash + " FROM " + Table_Entries +
+               " WHERE " + Table_Entries_Column_Id + " IN (" + params + ") AND " + NotExpired("?" + to_string(Count + 1));
+    }();
+    // only needed as long as expired entries have not been deleted yet
+    static const string StatementAnyExpired = "SELECT 1 FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Expires + " <= ?1 LIMIT 1";
+    static const string StatementExpiredAncestor = "WITH RECURSIVE Ancestors(Id) AS (SELECT " + Table_Entries_Column_Parent + " FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Id + " = ?1" +
+                                                                                   " UNION ALL SELECT " + Table_Entries + "." + Table_Entries_Column_Parent + " FROM " + Table_Entries +
+                                                                                     " JOIN Ancestors ON " + Table_Entries + "." + Table_Entries_Column_Id + " = Ancestors.Id" +
+                                                                                     " WHERE Ancestors.Id != 0) " +
+                                                     "SELECT 1 FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Id + " IN Ancestors AND NOT " + NotExpired("?2") + " LIMIT 1";
+
+    auto stm = GetStatement(Statement);
+    auto now = GetStoreTime();
+
+    map<Integer, Revision> found;
+
+    for (size_t first = 0; first < handles.size(); first += Count)
+    {
+      stm->reset();
+
+      for (size_t i = 0; i < Count; i++)
+      {
+        stm->bind(static_cast<int>(i + 1), ((first + i) < handles.size()) ? handles[first + i].m_Id : -1);
+      }
+
+      stm->bind(static_cast<int>(Count + 1), now);
+
+      while (stm->executeStep())
+      {
+        Integer id = stm->getColumn(0).getInt64();
+
+        found[id] = Revision(id, stm->getColumn(1).getInt64(), ((id != 0) && !stm->isColumnNull(2)) ? stm->getColumn(2).getInt64() : 0);
+      }
+    }
+
+    bool anyExpired = false;
+
+    if (checkHandles && !found.empty())
+    {
+      auto any = GetStatement(StatementAnyExpired);
+
+      any->bind(1, now);
+      anyExpired = any->executeStep();
+      any->reset();
+    }
+
+    revisions.clear();
+    revisions.reserve(handles.size());
+
+    for (const auto& handle : handles)
+    {
+      auto iter = found.find(handle.m_Id);
+
+      if ((iter == end(found)) || (checkHandles && (iter->second.m_NameHash != handle.m_NameHash)))
+      {
+        revisions.push_back(Revision());
+        continue;
+      }
+
+      if (anyExpired && (handle.m_Id != 0))
+      {
+        auto ancestor = GetStatement(StatementExpiredAncestor);
+
+        ancestor->bind(1, handle.m_Id);
+        ancestor->bind(2, now);
+
+        bool hidden = ancestor->executeStep();
+
+        ancestor->reset();
+
+        if (hidden)
+        {
+          revisions.push_back(Revision());
+          continue;
+        }
+      }
+
+      revisions.push_back(iter->second);
+    }
+  }
+
+  bool Store::UpdateRootRevision(Revision& root) const
+  {
+    Revision current(0, GetEntryRevision(0));
+
+    if (current == root)
+    {
+      return false;
+    }
+
+    root = current;
+
+    return true;
+  }
+
+  bool Store::GetRevisions(const vector<Revision>& handles, vector<Revision>& revisions, Revision& root) const
+  {
+    ReadOnlyTransaction transaction(*this);
+
+    if (!UpdateRootRevision(root))
+    {
+      return false;
+    }
+
+    vector<Revision> valid;
+
+    valid.reserve(handles.size());
+
+    for (const auto& handle : handles)
+    {
+      valid.push_back((handle != Revision()) ? handle : Revision(-1));
+    }
+
+    GetEntryRevisions(valid, true, revisions);
+
+    return true;
+  }
+
+  bool Store::GetRevisions(const vector<String>& names, vector<Revision>& revisions, Revision& root) const
+  {
+    ReadOnlyTransaction transaction(*this);
+
+    if (!UpdateRootRevision(root))
+    {
+      return false;
+    }
+
+    vector<Revision> entries;
+
+    entries.reserve(names.size());
+
+    for (const auto& name : names)
+    {
+      Integer id = 0;
+
+      if (!name.empty() && !GetTargetEntryId(id, ParseName(name)))
+      {
+        id = -1;
+      }
+
+      entries.push_back(Revision(id));
+    }
+
+    GetEntryRevisions(entries, false, revisions);
+
+    return true;
+  }
+
+  Store::Integer Store::GetEntryParent(Integer id) const
+  {
+    assert(m_Transaction.lock());
+
+    auto stm = GetStatement(Statement_GetEntryParent);
+
+    stm->bind(1, id);
+
+    if (!stm->executeStep())
+    {
+      throw ExceptionImpl<InvalidQuery>((boost::wformat(L"Failed to query parent of entry: %1%") % id).str());
+    }
+
+    Integer parent = stm->getColumn(0).getInt64();
+
+    assert(!stm->executeStep());
+
+    return parent;
+  }
+
+  Store::Revision Store::GetRevision(const String& name) const
+  {
+    // strange syntax but actually Revision::m_Id is not a valid expression for runtime-code so the compiler can't defer its type and so also not its size
+    static_assert(((sizeof(Revision().m_Id) * 8) >= 64) && ((sizeof(Revision().m_Revision) * 8) >= 64),
+                  "Entry ids and revisions must be at least 64 bits wide");
+
+    ReadOnlyTransaction transaction(*this);
+
+    if (name.empty())
+    {
+      return Revision(0, GetEntryRevision(0));
+    }
+
+    Integer id = GetTargetEntryId(ParseName(name));
+    auto stm = GetStatement(Statement_GetEntryRevisionAndNameHash);
+
+    stm->bind(1, id);
+
+    if (!stm->executeStep())
+    {
+      throw ExceptionImpl<InvalidQuery>((boost::wformat(L"Failed to query revision of entry: %1%") % id).str());
+    }
+
+    Revision revision(id, stm->getColumn(0).getInt64(), !stm->isColumnNull(1) ? stm->getColumn(1).getInt64() : 0);
+
+    assert(!stm->executeStep());
+
+    return revision;
+  }
+
+  void Store::UpdateRevision(IdList::const_iterator first, IdList::const_iterator last)  
+  {
+    assert(m_Transaction.lock() && m_WriteableTransaction);
+
+    ApplyStatsDeltas();
+
+    auto get = GetStatement(Statement_GetEntryRevision);
+    auto update = GetStatement(Statement_SetEntryRevision);
+
+    // get root revision
+    get->bind(1, 0);
+
+    if (!get->executeStep())
+    {
+      throw ExceptionImpl<InvalidQuery>(L"Failed to query revision of entry: 0");
+    }
+
+    Integer revision = get->getColumn(0).getInt64();
+
+    assert(!get->executeStep());
+
+    // update root revision
+    update->bind(1, 0);
+    update->bind(2, ++revision);
+    update->exec();
+
+    // update entries from idPath
+    while (first != last)
+    {
+      get->reset();
+      update->reset();
+
+      // get revision
+      get->bind(1, *first);
+
+      if (!get->executeStep())
+      {
+        throw ExceptionImpl<InvalidQuery>((boost::wformat(L"Failed to query revision of entry: %1%") % *first).str());
+      }
+
+      revision = get->getColumn(0).getInt64();
+
+      assert(!get->executeStep());
+
+      // update revision
+      update->bind(1, *first);
+      update->bind(2, ++revision);
+      update->exec();
+
+      first++;
+    }
+  }
+
+  void Store::UpdateRevisions(IdList ids)
+  {
+    assert(m_Transaction.lock() && m_WriteableTransaction);
+
+    ApplyStatsDeltas();
+
+    ids.push_back(0);
+
+    sort(begin(ids), end(ids));
+    ids.erase(unique(begin(ids), end(ids)), end(ids));
+
+    auto update = GetStatement(Statement_BumpEntryRevision);
+
+    for (auto id : ids)
+    {
+      update->reset();
+
+      update->bind(1, id);
+      update->exec();
+    }
+  }
+
+  void Store::SetEntryValue(Integer id, ValueType type, const ValueBinder& bindValue)
+  {
+    assert(m_Transaction.lock() && m_WriteableTransaction);
+
+    auto stm = GetStatement(Statement_SetEntry);
+
+    stm->bind(1, static_cast<Integer>(type));
+    bindValue(2, *stm);
+    stm->bind(3, id);
+
+    stm->exec();
+  }
+
+  void Store::SetEntry(const IdList& idPath, ValueType type, const ValueBinder& bindValue)
+  {
+    SetEntryValue(idPath.back(), type, bindValue);
+
+    UpdateRevision(begin(idPath), end(idPath));
+  }
+
+  void Store::SetEntry(const String& name, ValueType type, const ValueBinder& bindValue)
+  {
+    WriteableTransaction transaction(*this);
+
+    SetEntry(GetEntryId(ParseName(name)), type, bindValue);
+
+    transaction.Commit();
+  }
+
+  void Store::Set(const String& name, const String& value)
+  {
+    if (WriteBack(name, value, false))
+    {
+      return;
+    }
+
+    SetEntry(name, ValueType::String, [&value](int index, SQLite::Statement& stm) { stm.bind(index, WcharToUTF8(value)); });
+  }
+
+  void Store::Set(const String& name, Integer value)
+  {
+    if (WriteBack(name, value, false))
+    {
+      return;
+    }
+
+    SetEntry(name, ValueType::Integer, [&value](int index, SQLite::Statement& stm) { stm.bind(index, value); });
+  }
+
+  void Store::Set(const String& name, const Binary& value)
+  {
+    if (WriteBack(name, value, false))
+    {
+      return;
+    }
+
+    SetEntry(name, ValueType::Binary, [&value](int index, SQLite::Statement& stm) { stm.bind(index, value.data(), value.size()); });
+  }
+
+  bool Store::SetEntryIf(const String& name, ValueType type, const ValueBinder& bindValue, const Revision& expected)
+  {
+    WriteableTransaction transaction(*this);
+
+    IdList idPath;
+
+    if (!GetEntryId(idPath, ParseName(name)) || (idPath.back() != expected.m_Id))
+    {
+      return false;  // entry not found or re-created
+    }
+
+    auto stm = GetStatement(Statement_SetEntryIf);
+
+    stm->bind(1, static_cast<Integer>(type));
+    bindValue(2, *stm);
+    stm->bind(3, expected.m_Id);
+    stm->bind(4, expected.m_Revision);
+
+    if (stm->exec() != 1)
+    {
+      return false;  // entry has been changed
+    }
+
+    // revision of entry itself has already been updated
+    UpdateRevision(begin(idPath), begin(idPath) + (idPath.size() - 1));
+
+    transaction.Commit();
+
+    return true;
+  }
+
+  bool Store::SetIf(const String& name, const String& value, const Revision& expected)
+  {
+    return SetEntryIf(name, ValueType::String, [&value](int index, SQLite::Statement& stm) { stm.bind(index, WcharToUTF8(value)); }, expected);
+  }
+
+  bool Store::SetIf(const String& name, Integer value, const Revision& expected)
+  {
+    return SetEntryIf(name, ValueType::Integer, [&value](int index, SQLite::Statement& stm) { stm.bind(index, value); }, expected);
+  }
+
+  bool Store::SetIf(const String& name, const Binary& value, const Revision& expected)
+  {
+    return SetEntryIf(name, ValueType::Binary, [&value](int index, SQLite::Statement& stm) { stm.bind(index, value.data(), value.size()); }, expected);
+  }
+
+  bool Store::UpdateEntryValue(const String& name, ValueType type, const string& statementText,
+                               const vector<ValueBinder>& bindValues, const ValueGetter& getResult)
+  {
+    WriteableTransaction transaction(*this);
+
+    Path path = ParseName(name);
+    IdList idPath = GetEntryId(path);
+
+    auto stm = GetStatement(statementText);
+
+    stm->bind(1, idPath.back());
+    stm->bind(2, static_cast<Integer>(type));
+
+    int index = 3;
+
+    for (const auto& bindValue : bindValues)
+    {
+      bindValue(index++, *stm);
+    }
+
+    if (!stm->executeStep())
+    {
+      // only look at the type if the update failed, saves a query in the common case
+      if (GetEntryType(idPath.back()) != type)
+      {
+        throw ExceptionImpl<WrongValueType>((boost::wformat(L"Expected value type %1% for entry %2% but found: %3%") % ValueTypeToString(type) % PathToName(path) % ValueTypeToString(GetEntryType(idPath.back()))).str());
+      }
+
+      return false;
+    }
+
+    getResult(*stm);
+
+    // the update is done with the first step, make sure the statement is not pending when we commit
+    stm->reset();
+
+    // revision of entry itself has already been updated
+    UpdateRevision(begin(idPath), begin(idPath) + (idPath.size() - 1));
+
+    transaction.Commit();
+
+    return true;
+  }
+
+  Store::Integer Store::Increment(const String& name, Integer delta)
+  {
+    Integer value = 0;
+
+    if (!UpdateEntryValue(name, ValueType::Integer, Statement_IncrementEntry,
+                          { [delta](int index, SQLite::Statement& stm) { stm.bind(index, delta); } },
+                          [&value](SQLite::Statement& stm) { value = stm.getColumn(0).getInt64(); }))
+    {
+      throw ExceptionImpl<ValueOutOfRange>((boost::wformat(L"Incrementing entry %1% by %2% would overflow") % name % delta).str());
+    }
+
+    return value;
+  }
+
+  Store::Integer Store::AppendBinary(const String& name, const Binary& data)
+  {
+    Integer size = 0;
+
+    if (!UpdateEntryValue(name, ValueType::Binary, Statement_AppendEntry,
+                          { [&data](int index, SQLite::Statement& stm) { stm.bind(index, data.data(), data.size()); } },
+                          [&size](SQLite::Statement& stm) { size = stm.getColumn(0).getInt64(); }))
+    {
+      throw ExceptionImpl<InvalidQuery>(L"Failed to append to value of entry: " + name);
+    }
+
+    return size;
+  }
+
+  bool Store::CompareAndSwap(const String& name, const String& expected, const String& desired)
+  {
+    return UpdateEntryValue(name, ValueType::String, Statement_CompareAndSwapEntry,
+                            { [&expected](int index, SQLite::Statement& stm) { stm.bind(index, WcharToUTF8(expected)); },
+                              [&desired](int index, SQLite::Statement& stm) { stm.bind(index, WcharToUTF8(desired)); } },
+                            [](SQLite::Statement&) {});
+  }
+
+  bool Store::CompareAndSwap(const String& name, Integer expected, Integer desired)
+  {
+    return UpdateEntryValue(name, ValueType::Integer, Statement_CompareAndSwapEntry,
+                            { [expected](int index, SQLite::Statement& stm) { stm.bind(index, expected); },
+                              [desired](int index, SQLite::Statement& stm) { stm.bind(index, desired); } },
+                            [](SQLite::Statement&) {});
+  }
+
+  bool Store::CompareAndSwap(const String& name, const Binary& expected, const Binary& desired)
+  {
+    return UpdateEntryValue(name, ValueType::Binary, Statement_CompareAndSwapEntry,
+                            { [&expected](int index, SQLite::Statement& stm) { stm.bind(index, expected.data(), expected.size()); },
+                              [&desired](int index, SQLite::Statement& stm) { stm.bind(index, desired.data(), desired.size()); } },
+                            [](SQLite::Statement&) {});
+  }
+
+  Store::Integer Store::GetRandomRevision()
+  {
+    // TODO: thread safety!!
+    if (!m_RandomNumberGenerator)
+    {
+      m_RandomNumberGenerator = make_unique<RandomNumberGenerator::element_type>();
+    }
+
+    return m_RandomNumberGenerator->Get();
+  }
+
+  void Store::CreateEntry(Integer parent, const String& name, ValueType type, const ValueBinder& bindValue)
+  {
+    CreateEntry(parent, WcharToUTF8(name), type, bindValue);
+  }
+
+  void Store::CreateEntry(Integer parent, const string& name, ValueType type, const ValueBinder& bindValue)
+  {
+    assert(m_Transaction.lock() && m_WriteableTransaction);
+
+    // an expired entry keeps its name until ExpireDue() deletes it
+    auto expired = GetStatement(Statement_GetExpiredEntry);
+
+    expired->bind(1, name);
+    expired->bind(2, parent);
+    expired->bind(3, GetStoreTime());
+
+    if (expired->executeStep())
+    {
+      Integer id = expired->getColumn(0).getInt64();
+
+      expired->reset();
+
+      TryDeleteEntryImpl(id, true);
+    }
+
+    auto stm = GetStatement(m_FullPaths ? Statement_CreateEntryWithPath : Statement_CreateEntry);
+  
+    stm->bind(1, name);
+    stm->bind(2, parent);
+    stm->bind(3, static_cast<Integer>(type));
+    stm->bind(4, GetRandomRevision());
+    bindValue(5, *stm);
+    stm->bind(6, GetNameHash(parent, name));
+
+    if (m_FullPaths)
+    {
+      stm->bind(7, WcharToUTF8(String(1, m_Delimiter)));
+    }
+
+    stm->exec();
+  }
+
+  void Store::CreateEntry(IdList parentPath, Path::const_iterator first, const Path::const_iterator& last, ValueType type, const ValueBinder& bindValue)
+  {
+    while (first != last)
+    {
+      if ((first + 1) == last)
+      {
+        // create new entry
+        CreateEntry(!parentPath.empty() ? parentPath.back() : 0, *first, type, bindValue);
+      }
+      else
+      {
+        // create intermediate entry with defualt values
+        CreateEntry(!parentPath.empty() ? parentPath.back() : 0, *first, DefaultEntryValueType,
+                    [](int index, SQLite::Statement& stm) { stm.bind(index, DefaultEntryValue); });
+
+        // get id of new entry and set it as new parent
+        parentPath.push_back(GetEntryId(*first, !parentPath.empty() ? parentPath.back() : 0).back());
+      }
+
+      first++;
+    }
+  }
+
+  void Store::CreateEntry(const Path& path, ValueType type, const ValueBinder& bindValue)
+  {
+    WriteableTransaction transaction(*this);
+
+    IdList idPath;
+    auto   lastValid = end(path);
+  
+    assert(!path.empty());
+
+    // get id of parent for our new entry
+    // GetEntryId() will stop at the last valid/found entry in the path
+    if (!GetEntryId(idPath, lastValid, path))
+    {
+      assert((idPath.empty()) && (lastValid == end(path)) || ((!idPath.empty()) && (lastValid != end(path))));
+
+      auto iter = (lastValid == end(path)) ? begin(path) : ++lastValid;  // handle case "no valid name in path found"
+
+      assert(iter != end(path));
+
+      // create missing part of path + our new entry, insert default values in new entries, idPath contains existing parent path
+      CreateEntry(idPath, iter, end(path), type, bindValue);
+
+      // update revision in parent path entries
+      UpdateRevision(begin(idPath), end(idPath));
+    }
+    else
+    {
+      throw ExceptionImpl<NameAlreadyExists>(L"Name alreday exists: " + PathToName(path));
+    }
+
+    transaction.Commit();
+  }
+
+  void Store::Create(const String& name, const String& value)
+  {
+    CreateEntry(ParseName(name), ValueType::String, [&value](int index, SQLite::Statement& stm) { stm.bind(index, WcharToUTF8(value)); });
+  }
+
+  void Store::Create(const String& name, Integer value)
+  {
+    CreateEntry(ParseName(name), ValueType::Integer, [&value](int index, SQLite::Statement& stm) { stm.bind(index, value); });
+  }
+
+  void Store::Create(const String& name, const Binary& value)
+  {
+    CreateEntry(ParseName(name), ValueType::Binary, [&value](int index, SQLite::Statement& stm) { stm.bind(index, value.data(), value.size()); });
+  }
+
+
+  void Store::SetOrCreate(const Path& path, ValueType type, const ValueBinder& bindValue)
+  {
+    WriteableTransaction transaction(*this);
+
+    IdList idPath;
+    auto lastValid = end(path);
+
+    assert(!path.empty());
+
+    // get id of parent for our new entry
+    // GetEntryId() will stop at the last valid/found entry in the path
+    if (!GetEntryId(idPath, lastValid, path))
+    {
+      assert((idPath.empty()) && (lastValid == end(path)) || ((!idPath.empty()) && (lastValid != end(path))));
+
+      auto iter = (lastValid == end(path)) ? begin(path) : ++lastValid;  // handle case "no valid name in path found"
+
+      assert(iter != end(path));
+
+      // create missing part of path + our new entry, insert default values in new entries, idPath contains existing parent path
+      CreateEntry(idPath, iter, end(path), type, bindValue);
+
+      // update revision in parent path entries
+      UpdateRevision(begin(idPath), end(idPath));
+    }
+    else
+    {
+      // set existing entry
+      SetEntry(idPath, type, bindValue);
+    }
+
+    transaction.Commit();
+  }
+
+  void Store::SetOrCreate(const String& name, const String& value)
+  {
+    if (WriteBack(name, value, true))
+    {
+      return;
+    }
+
+    SetOrCreate(ParseName(name), ValueType::String, [&value](int index, SQLite::Statement& stm) { stm.bind(index, WcharToUTF8(value)); });
+  }
+
+  void Store::SetOrCreate(const String& name, Integer value)
+  {
+    if (WriteBack(name, value, true))
+    {
+      return;
+    }
+
+    SetOrCreate(ParseName(name), ValueType::Integer, [&value](int index, SQLite::Statement& stm) { stm.bind(index, value); });
+  }
+
+  void Store::SetOrCreate(const String& name, const Binary& value)
+  {
+    if (WriteBack(name, value, true))
+    {
+      return;
+    }
+
+    SetOrCreate(ParseName(name), ValueType::Binary, [&value](int index, SQLite::Statement& stm) { stm.bind(index, value.data(), value.size()); });
+  }
+
+  void Store::GetEntryValue(const Path& path, ValueType type, const ValueGetter& getValue) const
+  {
+    ReadOnlyTransaction transaction(*this);
+
+    Integer id = GetTargetEntryId(path);
+
+    if (GetEntryType(id) != type)
+    {
+      throw ExceptionImpl<WrongValueType>((boost::wformat(L"Expected value type %1% for entry %2% but found: %3%") % ValueTypeToString(type) % PathToName(path) % ValueTypeToString(GetEntryType(id))).str());
+    }
+
+    auto stm = GetStatement(Statement_GetEntryValue);
+
+    stm->bind(1, id);
+
+    if (!stm->executeStep())
+    {
+      throw ExceptionImpl<InvalidQuery>(L"Failed to query value of entry: " + PathToName(path));
+    }
+    
+    getValue(*stm);
+
+    assert(!stm->executeStep());
+  }
+
+  Store::String Store::GetString(const String& name) const
+  {
+    String value;
+    Path   path = ParseName(name);
+
+    if (GetPendingValue(path, ValueType::String, value))
+    {
+      return value;
+    }
+
+    // Note: SQLite will automatically convert NULL to "" (empty string)
+    GetEntryValue(path, ValueType::String, [&value](SQLite::Statement& stm) { value = UTF8ToWchar(stm.getColumn(0).getText()); });
+
+    return value;
+  }
+
+  Store::Integer Store::GetInteger(const String& name) const
+  {
+    Integer value;
+    Path    path = ParseName(name);
+
+    if (GetPendingValue(path, ValueType::Integer, value))
+    {
+      return value;
+    }
+
+    // Note: SQLite will automatically convert NULL to 0
+    GetEntryValue(path, ValueType::Integer, [&value](SQLite::Statement& stm) { value = stm.getColumn(0).getInt64(); });
+
+    return value;
+  }
+
+  Store::Binary Store::GetBinary(const String& name) const
+  {
+    Binary value;
+    Path   path = ParseName(name);
+
+    if (GetPendingValue(path, ValueType::Binary, value))
+    {
+      return value;
+    }
+
+    GetEntryValue(path, ValueType::Binary, [&value](SQLite::Statement& stm) { if (!stm.isColumnNull(0)) 
+                                                                                         {
+                                                                                           value.resize(stm.getColumn(0).size());
+                                                                                           memcpy(value.data(), stm.getColumn(0).getBlob(), value.size());
+                                                                                         }
+                                                                                       });
+
+    return value;
+  }
 
-    // duplicate statement in UpdateRevision(), reason is performance !
-    static const string Statement = "SELECT " + Table_Entries_Column_Revision + " FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Id + " = ?1";
+  bool Store::HasChild(Integer parent) const
+  {
+    assert(m_Transaction.lock());
 
-    auto stm = GetStatement(Statement);
+    auto stm = GetStatement(Statement_CountChildEntries);
 
-    stm->bind(1, id);
+    stm->bind(1, parent);
+    stm->bind(2, GetStoreTime());
 
     if (!stm->executeStep())
     {
-      throw ExceptionImpl<InvalidQuery>((boost::wformat(L"Failed to query revision of entry: %1%") % id).str());
+      throw ExceptionImpl<InvalidQuery>((boost::wformat(L"Failed to query number of childs for: %1%") % parent).str());
     }
 
-    Integer revision = stm->getColumn(0).getInt64();
+    Integer count = stm->getColumn(0).getInt64();
+
+    if (parent == 0)
+    {
+      assert(count > 0);
+      count--;
+    }
 
     assert(!stm->executeStep());
 
-    return revision;
+    return count > 0;
   }
 
-  Store::Revision Store::GetRevision(const String& name) const
+  bool Store::HasChild(const String& name) const
   {
-    // strange syntax but actually Revision::m_Id is not a valid expression for runtime-code so the compiler can't defer its type and so also not its size
-    static_assert(((sizeof(Revision().m_Id) * 8) >= 64) && ((sizeof(Revision().m_Revision) * 8) >= 64),
-                  "Entry ids and revisions must be at least 64 bits wide");
-
     ReadOnlyTransaction transaction(*this);
 
-    Integer id = !name.empty() ? GetEntryId(ParseName(name)).back() : 0;
+    return HasChild(name.empty() ? 0 : GetTargetEntryId(ParseName(name)));
+  }
+
+
+  Store::IdList Store::GetChildEntries(Integer parent) const
+  {
+    assert(m_Transaction.lock());
+
+    auto stm = GetStatement(Statement_GetChildEntries);
+
+    stm->bind(1, parent);
+
+    IdList ids;
+
+    while (stm->executeStep())
+    {
+      ids.push_back(stm->getColumn(0).getInt64());
+    }
 
-    return Revision(id, GetEntryRevision(id));
+    return ids;
   }
 
-  void Store::UpdateRevision(IdList::const_iterator first, IdList::const_iterator last)  
+  vector<pair<string, Store::Integer>> Store::GetNamedChildEntries(Integer parent) const
   {
-    assert(m_Transaction.lock() && m_WriteableTransaction);
+    assert(m_Transaction.lock());
 
-    // duplicate statement in GetEntryRevision(), reason is performance !
-    static const string StatementGet = "SELECT " + Table_Entries_Column_Revision + " FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Id + " = ?1";
+    static const string Statement = "SELECT " + Table_Entries_Column_Name + "," + Table_Entries_Column_Id + " FROM " + Table_Entries +
+                                      " WHERE " + Table_Entries_Column_Parent + " = ?1 AND " + Table_Entries_Column_Id + " != 0" +
+                                      " ORDER BY " + Table_Entries_Column_Name;
+    auto stm = GetStatement(Statement);
 
-    static const string StatementUpdate = "UPDATE " + Table_Entries + " SET " + Table_Entries_Column_Revision + " = ?2" +
-                                                                        " WHERE " + Table_Entries_Column_Id + " = ?1";
-    auto get = GetStatement(StatementGet);
-    auto update = GetStatement(StatementUpdate);
+    stm->bind(1, parent);
 
-    // get root revision
-    get->bind(1, 0);
+    vector<pair<string, Integer>> children;
 
-    if (!get->executeStep())
+    while (stm->executeStep())
     {
-      throw ExceptionImpl<InvalidQuery>(L"Failed to query revision of entry: 0");
+      children.emplace_back(stm->getColumn(0).getText(), stm->getColumn(1).getInt64());
     }
 
-    Integer revision = get->getColumn(0).getInt64();
+    return children;
+  }
 
-    assert(!get->executeStep());
+  vector<pair<string, Store::Integer>> Store::GetNamedChildEntries(Integer parent, Integer now) const
+  {
+    assert(m_Transaction.lock());
 
-    // update root revision
-    update->bind(1, 0);
-    update->bind(2, ++revision);
-    update->exec();
+    static const string Statement = "SELECT " + Table_Entries_Column_Name + "," + Table_Entries_Column_Id + " FROM " + Table_Entries +
+                                      " WHERE " + Table_Entries_Column_Parent + " = ?1 AND " + Table_Entries_Column_Id + " != 0 AND " + NotExpired("?2") +
+                                      " ORDER BY " + Table_Entries_Column_Name;
+    auto stm = GetStatement(Statement);
 
-    // update entries from idPath
-    while (first != last)
+    stm->bind(1, parent);
+    stm->bind(2, now);
+
+    vector<pair<string, Integer>> children;
+
+    while (stm->executeStep())
     {
-      get->reset();
-      update->reset();
+      children.emplace_back(stm->getColumn(0).getText(), stm->getColumn(1).getInt64());
+    }
 
-      // get revision
-      get->bind(1, *first);
+    return children;
+  }
 
-      if (!get->executeStep())
+  Store::Children Store::GetChildEntryNames(Integer parent) const
+  {
+    assert(m_Transaction.lock());
+
+    auto stm = GetStatement(Statement_GetChildEntryNames);
+
+    stm->bind(1, parent);
+    stm->bind(2, GetStoreTime());
+
+    Children children;
+
+    while (stm->executeStep())
+    {
+      children.push_back(UTF8ToWchar(stm->getColumn(0).getText()));
+    }
+
+    return children;
+  }
+
+  Store::Integer Store::CountDescendants(const String& name) const
+  {
+    ReadOnlyTransaction transaction(*this);
+
+    Integer id = name.empty() ? 0 : GetTargetEntryId(ParseName(name));
+
+    // all descendants minus the ones that are expired or below an expired one
+    // CROSS JOIN makes SQLite start with the (usually few) expired entries instead of all descendants
+    static const string StatementByIndex = "SELECT (SELECT COUNT(*) FROM " + Table_Closure + " WHERE " + Table_Closure_Column_Ancestor + " = ?1 AND " + Table_Closure_Column_Depth + " > 0) - " +
+                                             "(SELECT COUNT(DISTINCT Hidden." + Table_Closure_Column_Descendant + ") FROM " + Table_Entries +
+                                               " CROSS JOIN " + Table_Closure + " AS Below CROSS JOIN " + Table_Closure + " AS Hidden" +
+                                               " WHERE " + Table_Entries + "." + Table_Entries_Column_Expires + " <= ?2 AND " +
+                                                       "Below." + Table_Closure_Column_Descendant + " = " + Table_Entries + "." + Table_Entries_Column_Id + " AND " +
+                                                       "Below." + Table_Closure_Column_Ancestor + " = ?1 AND Below." + Table_Closure_Column_Depth + " > 0 AND " +
+                                                       "Hidden." + Table_Closure_Column_Ancestor + " = " + Table_Entries + "." + Table_Entries_Column_Id + ")";
+    static const string Statement = "WITH RECURSIVE Subtree(Id) AS (SELECT ?1 UNION ALL SELECT " + Table_Entries + "." + Table_Entries_Column_Id + " FROM " + Table_Entries +
+                                                                     " JOIN Subtree ON " + Table_Entries + "." + Table_Entries_Column_Parent + " = Subtree.Id" +
+                                                                     " WHERE " + Table_Entries + "." + Table_Entries_Column_Id + " != 0 AND " + NotExpired("?2") + ") " +
+                                      "SELECT COUNT(*) - 1 FROM Subtree";
+    auto stm = GetStatement(m_SubtreeIndex ? StatementByIndex : Statement);
+
+    stm->bind(1, id);
+    stm->bind(2, GetStoreTime());
+
+    if (!stm->executeStep())
+    {
+      throw ExceptionImpl<InvalidQuery>(L"Failed to count descendants of entry: " + name);
+    }
+
+    return stm->getColumn(0).getInt64();
+  }
+
+  Store::Children Store::GetSubtree(const String& name) const
+  {
+    ReadOnlyTransaction transaction(*this);
+
+    Integer id = name.empty() ? 0 : GetTargetEntryId(ParseName(name));
+
+    // descendants ordered by depth, each with its parent and whether it is expired
+    static const string StatementByIndex = "SELECT " + Table_Entries + "." + Table_Entries_Column_Id + "," + Table_Entries_Column_Parent + "," + Table_Entries_Column_Name + "," + NotExpired("?2") +
+                                             " FROM " + Table_Closure + " JOIN " + Table_Entries + " ON " + Table_Entries + "." + Table_Entries_Column_Id + " = " + Table_Closure + "." + Table_Closure_Column_Descendant +
+                                             " WHERE " + Table_Closure + "." + Table_Closure_Column_Ancestor + " = ?1 AND " + Table_Closure + "." + Table_Closure_Column_Depth + " > 0" +
+                                             " ORDER BY " + Table_Closure + "." + Table_Closure_Column_Depth;
+    static const string Statement = "WITH RECURSIVE Subtree(Id, Depth) AS (SELECT ?1, 0 UNION ALL SELECT " + Table_Entries + "." + Table_Entries_Column_Id + ", Subtree.Depth + 1 FROM " + Table_Entries +
+                                                                            " JOIN Subtree ON " + Table_Entries + "." + Table_Entries_Column_Parent + " = Subtree.Id" +
+                                                                            " WHERE " + Table_Entries + "." + Table_Entries_Column_Id + " != 0 AND " + NotExpired("?2") + ") " +
+                                      "SELECT " + Table_Entries + "." + Table_Entries_Column_Id + "," + Table_Entries_Column_Parent + "," + Table_Entries_Column_Name + ", 1" +
+                                        " FROM Subtree JOIN " + Table_Entries + " ON " + Table_Entries + "." + Table_Entries_Column_Id + " = Subtree.Id" +
+                                        " WHERE Subtree.Depth > 0 ORDER BY Subtree.Depth";
+    auto stm = GetStatement(m_SubtreeIndex ? StatementByIndex : Statement);
+
+    stm->bind(1, id);
+    stm->bind(2, GetStoreTime());
+
+    // parents come first, entries whose parent is missing are below an expired entry
+    map<Integer, String> names;
+    Children subtree;
+
+    while (stm->executeStep())
+    {
+      Integer parent = stm->getColumn(1).getInt64();
+      auto    iter = names.find(parent);
+
+      if ((stm->getColumn(3).getInt() == 0) || ((parent != id) && (iter == end(names))))
       {
-        throw ExceptionImpl<InvalidQuery>((boost::wformat(L"Failed to query revision of entry: %1%") % *first).str());
+        continue;
       }
 
-      revision = get->getColumn(0).getInt64();
+      String childName = UTF8ToWchar(stm->getColumn(2).getText());
 
-      assert(!get->executeStep());
+      if (parent != id)
+      {
+        childName = iter->second + m_Delimiter + childName;
+      }
 
-      // update revision
-      update->bind(1, *first);
-      update->bind(2, ++revision);
-      update->exec();
+      names.emplace(stm->getColumn(0).getInt64(), childName);
+      subtree.push_back(move(childName));
+    }
 
-      first++;
+    return subtree;
+  }
+
+  Store::Children Store::GetChildren(const String& name) const
+  {
+    if (m_ChildrenCache->Capacity() == 0)
+    {
+      ReadOnlyTransaction transaction(*this);
+
+      return GetChildEntryNames(name.empty() ? 0 : GetTargetEntryId(ParseName(name)));
     }
+
+    return *GetSharedChildren(name);
   }
 
-  void Store::SetEntry(const IdList& idPath, ValueType type, const ValueBinder& bindValue)
+  Store::SharedChildren Store::GetSharedChildren(const String& name) const
   {
-    assert(m_Transaction.lock() && m_WriteableTransaction);
+    ReadOnlyTransaction transaction(*this);
 
-    static const string Statement = "UPDATE " + Table_Entries + " SET " + Table_Entries_Column_Type + " = ?1 , " +
-                                                                          Table_Entries_Column_Value + " = ?2 " +
-                                                                            "WHERE " + Table_Entries_Column_Id + " = ?3";
-    auto stm = GetStatement(Statement);
+    Integer id = name.empty() ? 0 : GetTargetEntryId(ParseName(name));
 
-    stm->bind(1, static_cast<Integer>(type));
-    bindValue(2, *stm);
-    stm->bind(3, idPath.back());
+    if (m_ChildrenCache->Capacity() == 0)
+    {
+      return make_shared<const Children>(GetChildEntryNames(id));
+    }
 
-    stm->exec();
+    // creating or deleting a child entry bumps the revision of the parent entry, expiring a child does not
+    Integer revision = GetEntryRevision(id);
 
-    UpdateRevision(begin(idPath), end(idPath));
+    CachedChildren* cached = m_ChildrenCache->Find(id);
+
+    if ((cached != nullptr) && (cached->m_Revision == revision) && (GetStoreTime() < cached->m_Expires))
+    {
+      return cached->m_Children;
+    }
+
+    auto stm = GetStatement(Statement_GetChildEntriesExpiry);
+
+    stm->bind(1, id);
+
+    if (!stm->executeStep())
+    {
+      throw ExceptionImpl<InvalidQuery>((boost::wformat(L"Failed to query expiry of childs for: %1%") % id).str());
+    }
+
+    Integer expires = stm->isColumnNull(0) ? numeric_limits<Integer>::max() : stm->getColumn(0).getInt64();
+
+    SharedChildren children = make_shared<const Children>(GetChildEntryNames(id));
+
+    m_ChildrenCache->Insert(id, CachedChildren{revision, expires, children});
+
+    return children;
   }
 
-  void Store::SetEntry(const String& name, ValueType type, const ValueBinder& bindValue)
+  Store::ValueType Store::GetType(const String& name) const
   {
-    WriteableTransaction transaction(*this);
-
-    SetEntry(GetEntryId(ParseName(name)), type, bindValue);
+    return GetEntryType(ParseName(name));
+  }
 
-    transaction.Commit();
+  bool Store::IsInteger(const String& name) const
+  {
+    return GetEntryType(ParseName(name)) == ValueType::Integer;
   }
 
-  void Store::Set(const String& name, const String& value)
+  bool Store::IsString(const String& name) const
   {
-    SetEntry(name, ValueType::String, [&value](int index, SQLite::Statement& stm) { stm.bind(index, WcharToUTF8(value)); });
+    return GetEntryType(ParseName(name)) == ValueType::String;
   }
 
-  void Store::Set(const String& name, Integer value)
+  bool Store::IsBinary(const String& name) const
   {
-    SetEntry(name, ValueType::Integer, [&value](int index, SQLite::Statement& stm) { stm.bind(index, value); });
+    return GetEntryType(ParseName(name)) == ValueType::Binary;
   }
 
-  void Store::Set(const String& name, const Binary& value)
+  Store::ValueType Store::GetEntryType(const Path& path) const
   {
-    SetEntry(name, ValueType::Binary, [&value](int index, SQLite::Statement& stm) { stm.bind(index, value.data(), value.size()); });
+    if (m_WriteBack)
+    {
+      auto iter = m_WriteBack->m_Pending.find(path);
+
+      if (iter != end(m_WriteBack->m_Pending))
+      {
+        return Detail::WriteBackBuffer::GetType(iter->second);
+      }
+    }
+
+    ReadOnlyTransaction transcation(*this);
+
+    return GetEntryType(GetTargetEntryId(path));
   }
 
-  Store::Integer Store::GetRandomRevision()
+  Store::ValueType Store::GetEntryType(Integer id) const
   {
-    // TODO: thread safety!!
-    if (!m_RandomNumberGenerator)
+    assert(m_Transaction.lock());
+
+    auto stm = GetStatement(Statement_GetEntryType);
+
+    stm->bind(1, id);
+
+    if (!stm->executeStep())
     {
-      m_RandomNumberGenerator = make_unique<RandomNumberGenerator::element_type>();
+      ExceptionImpl<InvalidQuery>((boost::wformat(L"Failed to query value type for: %1%") % id).str());
     }
 
-    return m_RandomNumberGenerator->Get();
+    ValueType type = static_cast<ValueType>(stm->getColumn(0).getInt64());
+    
+    switch (type)
+    {
+      case ValueType::Integer:
+      case ValueType::String:
+      case ValueType::Binary:
+        break;
+
+      default: throw ExceptionImpl<UnknownEntryType>((boost::wformat(L"Entry %1% has unknown value type: %2%") % id % static_cast<Integer>(type)).str());
+    }
+
+    assert(!stm->executeStep());
+
+    return type;
   }
 
-  void Store::CreateEntry(Integer parent, const String& name, ValueType type, const ValueBinder& bindValue)
+  bool Store::TryDeleteEntryImpl(Integer id, bool recursive)
   {
-    assert(m_Transaction.lock() && m_WriteableTransaction);
+    assert(id != 0);
 
-    static const string Statement = "INSERT INTO " + Table_Entries + " (" + Table_Entries_Column_Name + "," +
-                                                                            Table_Entries_Column_Parent + "," +
-                                                                            Table_Entries_Column_Type + "," +
-                                                                            Table_Entries_Column_Revision + "," +
-                                                                            Table_Entries_Column_Value + ") " +
-                                                                              "VALUES (?1, ?2, ?3, ?4, ?5)";
-    auto stm = GetStatement(Statement);
-  
-    stm->bind(1, WcharToUTF8(name));
-    stm->bind(2, parent);
-    stm->bind(3, static_cast<Integer>(type));
-    stm->bind(4, GetRandomRevision());
-    bindValue(5, *stm);
+    if (!recursive && HasChild(id))
+    {
+      return false;
+    }
+
+    // whole subtree incl. expired entries at once, the trigger drops the index rows of each deleted entry
+    if (m_SubtreeIndex)
+    {
+      static const string Statement = "DELETE FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Id + " IN " +
+                                        "(SELECT " + Table_Closure_Column_Descendant + " FROM " + Table_Closure + " WHERE " + Table_Closure_Column_Ancestor + " = ?1)";
+      auto stm = GetStatement(Statement);
+
+      stm->bind(1, id);
+      stm->exec();
+
+      return true;
+    }
+
+    // with recursive == false only expired children are left, HasChild() does not see them but they have to go as well
+    IdList childs = GetChildEntries(id);
+
+    for (auto child : childs)
+    {
+      TryDeleteEntryImpl(child, true);
+    }
+
+    assert(m_Transaction.lock());
+
+    auto stm = GetStatement(Statement_DeleteEntry);
+
+    stm->bind(1, id);
 
     stm->exec();
+
+    return true;
   }
 
-  void Store::CreateEntry(IdList parentPath, Path::const_iterator first, const Path::const_iterator& last, ValueType type, const ValueBinder& bindValue)
+  bool Store::TryDeleteEntry(const IdList& idPath, bool recursive)
   {
-    while (first != last)
-    {
-      if ((first + 1) == last)
-      {
-        // create new entry
-        CreateEntry(!parentPath.empty() ? parentPath.back() : 0, *first, type, bindValue);
-      }
-      else
-      {
-        // create intermediate entry with defualt values
-        CreateEntry(!parentPath.empty() ? parentPath.back() : 0, *first, DefaultEntryValueType,
-                    [](int index, SQLite::Statement& stm) { stm.bind(index, DefaultEntryValue); });
+    assert(!idPath.empty());
 
-        // get id of new entry and set it as new parent
-        parentPath.push_back(GetEntryId(*first, !parentPath.empty() ? parentPath.back() : 0).back());
-      }
+    if (TryDeleteEntryImpl(idPath.back(), recursive))
+    {
+      // update revision of parent entries
+      UpdateRevision(begin(idPath), begin(idPath) + (idPath.size() - 1));
 
-      first++;
+      return true;
     }
+
+    return false;
   }
 
-  void Store::CreateEntry(const Path& path, ValueType type, const ValueBinder& bindValue)
+  bool Store::TryDelete(const String& name, bool recursive)
   {
     WriteableTransaction transaction(*this);
 
     IdList idPath;
-    auto   lastValid = end(path);
-  
-    assert(!path.empty());
 
-    // get id of parent for our new entry
-    // GetEntryId() will stop at the last valid/found entry in the path
-    if (!GetEntryId(idPath, lastValid, path))
+    if (!GetEntryId(idPath, ParseName(name)))
     {
-      assert((idPath.empty()) && (lastValid == end(path)) || ((!idPath.empty()) && (lastValid != end(path))));
-
-      auto iter = (lastValid == end(path)) ? begin(path) : ++lastValid;  // handle case "no valid name in path found"
-
-      assert(iter != end(path));
-
-      // create missing part of path + our new entry, insert default values in new entries, idPath contains existing parent path
-      CreateEntry(idPath, iter, end(path), type, bindValue);
-
-      // update revision in parent path entries
-      UpdateRevision(begin(idPath), end(idPath));
+      return false;  // entry not found
     }
-    else
+
+    if (!TryDeleteEntry(idPath, recursive))
     {
-      throw ExceptionImpl<NameAlreadyExists>(L"Name alreday exists: " + PathToName(path));
+      return false;  // has children and recursive == false
     }
 
     transaction.Commit();
-  }
 
-  void Store::Create(const String& name, const String& value)
-  {
-    CreateEntry(ParseName(name), ValueType::String, [&value](int index, SQLite::Statement& stm) { stm.bind(index, WcharToUTF8(value)); });
+    return true;
   }
 
-  void Store::Create(const String& name, Integer value)
+  void Store::Delete(const String& name, bool recursive)
   {
-    CreateEntry(ParseName(name), ValueType::Integer, [&value](int index, SQLite::Statement& stm) { stm.bind(index, value); });
-  }
+    WriteableTransaction transaction(*this);
 
-  void Store::Create(const String& name, const Binary& value)
-  {
-    CreateEntry(ParseName(name), ValueType::Binary, [&value](int index, SQLite::Statement& stm) { stm.bind(index, value.data(), value.size()); });
-  }
+    if (!TryDeleteEntry(GetEntryId(ParseName(name)), recursive))
+    {
+      throw ExceptionImpl<HasChildEntry>(L"Faild to delete due to existing child entries: " + name);
+    }
 
+    transaction.Commit();
+  }
 
-  void Store::SetOrCreate(const Path& path, ValueType type, const ValueBinder& bindValue)
+  bool Store::DeleteIf(const String& name, const Revision& expected, bool recursive)
   {
     WriteableTransaction transaction(*this);
 
     IdList idPath;
-    auto lastValid = end(path);
 
-    assert(!path.empty());
+    if (!GetEntryId(idPath, ParseName(name)) || (idPath.back() != expected.m_Id))
+    {
+      return false;  // entry not found or re-created
+    }
 
-    // get id of parent for our new entry
-    // GetEntryId() will stop at the last valid/found entry in the path
-    if (!GetEntryId(idPath, lastValid, path))
+    // we hold the write lock, nobody can change the entry between check and delete
+    if (GetEntryRevision(idPath.back()) != expected.m_Revision)
     {
-      assert((idPath.empty()) && (lastValid == end(path)) || ((!idPath.empty()) && (lastValid != end(path))));
+      return false;  // entry has been changed
+    }
 
-      auto iter = (lastValid == end(path)) ? begin(path) : ++lastValid;  // handle case "no valid name in path found"
+    if (!TryDeleteEntry(idPath, recursive))
+    {
+      return false;  // has children and recursive == false
+    }
 
-      assert(iter != end(path));
+    transaction.Commit();
 
-      // create missing part of path + our new entry, insert default values in new entries, idPath contains existing parent path
-      CreateEntry(idPath, iter, end(path), type, bindValue);
+    return true;
+  }
 
-      // update revision in parent path entries
-      UpdateRevision(begin(idPath), end(idPath));
+  void Store::SetEntryExpiry(const String& name, bool expires, Integer expiryTime)
+  {
+    WriteableTransaction transaction(*this);
+
+    IdList idPath = GetEntryId(ParseName(name));
+
+    static const string Statement = "UPDATE " + Table_Entries + " SET " + Table_Entries_Column_Expires + " = ?2 WHERE " + Table_Entries_Column_Id + " = ?1";
+    auto stm = GetStatement(Statement);
+
+    stm->bind(1, idPath.back());
+
+    if (expires)
+    {
+      stm->bind(2, expiryTime);
     }
     else
     {
-      // set existing entry
-      SetEntry(idPath, type, bindValue);
+      stm->bind(2);
     }
 
+    stm->exec();
+
+    UpdateRevision(begin(idPath), end(idPath));
+
     transaction.Commit();
   }
 
-  void Store::SetOrCreate(const String& name, const String& value)
+  void Store::SetExpiry(const String& name, const TimePoint& expires)
   {
-    SetOrCreate(ParseName(name), ValueType::String, [&value](int index, SQLite::Statement& stm) { stm.bind(index, WcharToUTF8(value)); });
+    SetEntryExpiry(name, true, ToStoreTime(expires));
   }
 
-  void Store::SetOrCreate(const String& name, Integer value)
+  void Store::SetTimeToLive(const String& name, const chrono::milliseconds& timeToLive)
   {
-    SetOrCreate(ParseName(name), ValueType::Integer, [&value](int index, SQLite::Statement& stm) { stm.bind(index, value); });
+    SetEntryExpiry(name, true, ToStoreTime(chrono::system_clock::now() + timeToLive));
   }
 
-  void Store::SetOrCreate(const String& name, const Binary& value)
+  void Store::ClearExpiry(const String& name)
   {
-    SetOrCreate(ParseName(name), ValueType::Binary, [&value](int index, SQLite::Statement& stm) { stm.bind(index, value.data(), value.size()); });
+    SetEntryExpiry(name, false, 0);
   }
 
-  void Store::GetEntryValue(const Path& path, ValueType type, const ValueGetter& getValue) const
+  bool Store::GetExpiry(const String& name, TimePoint& expires) const
   {
     ReadOnlyTransaction transaction(*this);
 
-    Integer id = GetEntryId(path).back();
-
-    if (GetEntryType(id) != type)
-    {
-      throw ExceptionImpl<WrongValueType>((boost::wformat(L"Expected value type %1% for entry %2% but found: %3%") % ValueTypeToString(type) % PathToName(path) % ValueTypeToString(GetEntryType(id))).str());
-    }
+    Integer id = GetTargetEntryId(ParseName(name));
 
-    static const string Statement = "SELECT " + Table_Entries_Column_Value + " FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Id + " = ?1";
+    static const string Statement = "SELECT " + Table_Entries_Column_Expires + " FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Id + " = ?1";
     auto stm = GetStatement(Statement);
 
     stm->bind(1, id);
 
     if (!stm->executeStep())
     {
-      throw ExceptionImpl<InvalidQuery>(L"Failed to query value of entry: " + PathToName(path));
+      throw ExceptionImpl<InvalidQuery>(L"Failed to query expiry of entry: " + name);
     }
-    
-    getValue(*stm);
 
-    assert(!stm->executeStep());
+    if (stm->isColumnNull(0))
+    {
+      return false;
+    }
+
+    expires = FromStoreTime(stm->getColumn(0).getInt64());
+
+    return true;
   }
 
-  Store::String Store::GetString(const String& name) const
+  void Store::SetHistoryRetention(Integer maxValues, const chrono::milliseconds& maxAge)
   {
-    String value;
+    WriteableTransaction transaction(*this);
 
-    // Note: SQLite will automatically convert NULL to "" (empty string)
-    GetEntryValue(ParseName(name), ValueType::String, [&value](SQLite::Statement& stm) { value = UTF8ToWchar(stm.getColumn(0).getText()); });
+    if (maxValues <= 0)
+    {
+      m_Database->exec("DELETE FROM " + Table_History);
 
-    return value;
-  }
+      DeleteSetting(Setting_HistoryMaxValues);
+      DeleteSetting(Setting_HistoryMaxAge);
+      DeleteSetting(Setting_HistorySince);
+    }
+    else
+    {
+      // changing the limits of an enabled history keeps what has been recorded so far
+      if (!SettingExists(Setting_HistorySince))
+      {
+        SetSetting(Setting_HistorySince, GetStoreTime());
+      }
 
-  Store::Integer Store::GetInteger(const String& name) const
-  {
-    Integer value;
+      SetSetting(Setting_HistoryMaxValues, maxValues);
+      SetSetting(Setting_HistoryMaxAge, static_cast<Integer>(maxAge.count()));
+    }
 
-    // Note: SQLite will automatically convert NULL to 0
-    GetEntryValue(ParseName(name), ValueType::Integer, [&value](SQLite::Statement& stm) { value = stm.getColumn(0).getInt64(); });
+    CreateHistoryTriggers("main.");
 
-    return value;
+    transaction.Commit();
   }
 
-  Store::Binary Store::GetBinary(const String& name) const
+  void Store::CreateHistoryTriggers(const string& schema) const
   {
-    Binary value;
+    m_Database->exec("DROP TRIGGER IF EXISTS " + schema + Trigger_History_Update);
+    m_Database->exec("DROP TRIGGER IF EXISTS " + schema + Trigger_History_Delete);
 
-    GetEntryValue(ParseName(name), ValueType::Binary, [&value](SQLite::Statement& stm) { if (!stm.isColumnNull(0)) 
-                                                                                         {
-                                                                                           value.resize(stm.getColumn(0).size());
-                                                                                           memcpy(value.data(), stm.getColumn(0).getBlob(), value.size());
-                                                                                         }
-                                                                                       });
+    Statement setting = make_unique<Statement::element_type>(*m_Database, "SELECT " + Table_Settings_Column_Value + " FROM " + schema + Table_Settings +
+                                                                             " WHERE " + Table_Settings_Column_Name + " = ?1");
+    auto getSetting = [&setting](const string& name)
+    {
+      setting->bind(1, name);
 
-    return value;
-  }
+      Integer value = setting->executeStep() ? setting->getColumn(0).getInt64() : 0;
 
-  bool Store::HasChild(Integer parent) const
-  {
-    assert(m_Transaction.lock());
+      setting->reset();
 
-    static const string Statement = "SELECT COUNT(" + Table_Entries_Column_Id + ") FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Parent + " = ?1";
-    auto stm = GetStatement(Statement);
+      return value;
+    };
 
-    stm->bind(1, parent);
+    Integer maxValues = getSetting(Setting_HistoryMaxValues);
+    Integer maxAge = getSetting(Setting_HistoryMaxAge);
+    Integer since = getSetting(Setting_HistorySince);
 
-    if (!stm->executeStep())
+    if (maxValues <= 0)
     {
-      throw ExceptionImpl<InvalidQuery>((boost::wformat(L"Failed to query number of childs for: %1%") % parent).str());
+      return;
     }
 
-    Integer count = stm->getColumn(0).getInt64();
+    // triggers can not take parameters, the limits become part of the trigger definition
+    // statements within a trigger refer to the schema of the trigger
+    const string sameEntry = Table_History_Column_EntryId + " = OLD." + Table_Entries_Column_Id;
 
-    if (parent == 0)
+    string prune = "DELETE FROM " + Table_History + " WHERE " + sameEntry + " AND rowid NOT IN " +
+                     "(SELECT rowid FROM " + Table_History + " WHERE " + sameEntry + " ORDER BY rowid DESC LIMIT " + to_string(maxValues) + "); ";
+
+    if (maxAge > 0)
     {
-      assert(count > 0);
-      count--;
+      // the latest value stays, it tells us since when the current value is valid
+      prune += "DELETE FROM " + Table_History + " WHERE " + sameEntry + " AND " +
+                 Table_History_Column_ValidTo + " < " + Expression_Now + " - " + to_string(maxAge) + " AND " +
+                 "rowid != (SELECT MAX(rowid) FROM " + Table_History + " WHERE " + sameEntry + "); ";
     }
 
-    assert(!stm->executeStep());
-
-    return count > 0;
+    // the value replaced by the first recorded change is known to be valid since the history has been enabled
+    m_Database->exec("CREATE TRIGGER " + schema + Trigger_History_Update + " AFTER UPDATE OF " + Table_Entries_Column_Type + "," + Table_Entries_Column_Value +
+                       " ON " + Table_Entries +
+                       " WHEN (OLD." + Table_Entries_Column_Type + " IS NOT NEW." + Table_Entries_Column_Type + ") OR " +
+                             "(OLD." + Table_Entries_Column_Value + " IS NOT NEW." + Table_Entries_Column_Value + ") " +
+                       "BEGIN " +
+                         "INSERT INTO " + Table_History + " (" + Table_History_Columns + ") VALUES (OLD." + Table_Entries_Column_Id + ", " +
+                                                                                                  "OLD." + Table_Entries_Column_Revision + ", " +
+                                                                                                  "OLD." + Table_Entries_Column_Type + ", " +
+                                                                                                  "OLD." + Table_Entries_Column_Value + ", " +
+                           "COALESCE((SELECT MAX(" + Table_History_Column_ValidTo + ") FROM " + Table_History + " WHERE " + sameEntry + "), " + to_string(since) + "), " +
+                           Expression_Now + "); " +
+                         prune +
+                       "END");
+
+    // entry ids get reused, history must not outlive its entry
+    m_Database->exec("CREATE TRIGGER " + schema + Trigger_History_Delete + " AFTER DELETE ON " + Table_Entries + " " +
+                       "BEGIN " +
+                         "DELETE FROM " + Table_History + " WHERE " + sameEntry + "; " +
+                       "END");
   }
 
-  bool Store::HasChild(const String& name) const
+  void Store::GetEntryValueAt(const Path& path, ValueType type, const TimePoint* time, const Revision* revision, const ValueGetter& getValue) const
   {
+    assert((time != nullptr) != (revision != nullptr));
+
     ReadOnlyTransaction transaction(*this);
 
-    return HasChild(name.empty() ? 0 : GetEntryId(ParseName(name)).back());
-  }
+    Integer id = GetTargetEntryId(path);
 
+    if ((revision != nullptr) && (revision->m_Id != id))
+    {
+      throw ExceptionImpl<EntryNotFound>(L"Revision belongs to another entry: " + PathToName(path));
+    }
 
-  Store::IdList Store::GetChildEntries(Integer parent) const
-  {
-    assert(m_Transaction.lock());
+    // changes before the history has been enabled have not been recorded
+    if (!SettingExists(Setting_HistorySince) || ((time != nullptr) && (ToStoreTime(*time) < GetSettingInt(Setting_HistorySince))))
+    {
+      throw ExceptionImpl<EntryNotFound>(L"Value is not recorded for entry: " + PathToName(path));
+    }
 
-    static const string Statement = "SELECT " + Table_Entries_Column_Id + " FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Parent + " = ?1 AND " + Table_Entries_Column_Id + " != 0";
-    auto stm = GetStatement(Statement);
+    // the value valid at a given time or revision is the first one replaced after it
+    static const string Statement1 = "SELECT " + Table_History_Column_Value + "," + Table_History_Column_Type + "," + Table_History_Column_ValidFrom +
+                                       " FROM " + Table_History + " WHERE " + Table_History_Column_EntryId + " = ?1 AND " + Table_History_Column_ValidTo + " > ?2" +
+                                       " ORDER BY " + Table_History_Column_ValidTo + ", rowid LIMIT 1";
+    static const string Statement2 = "SELECT " + Table_History_Column_Value + "," + Table_History_Column_Type + "," + Table_History_Column_ValidFrom +
+                                       " FROM " + Table_History + " WHERE " + Table_History_Column_EntryId + " = ?1 AND " + Table_History_Column_Revision + " >= ?2" +
+                                       " ORDER BY " + Table_History_Column_ValidTo + ", rowid LIMIT 1";
+    auto stm = GetStatement((time != nullptr) ? Statement1 : Statement2);
 
-    stm->bind(1, parent);
+    stm->bind(1, id);
+    stm->bind(2, (time != nullptr) ? ToStoreTime(*time) : revision->m_Revision);
 
-    IdList ids;
+    if (!stm->executeStep())
+    {
+      // no change recorded since then
+      GetEntryValue(path, type, getValue);
+      return;
+    }
 
-    while (stm->executeStep())
+    if ((time != nullptr) && !stm->isColumnNull(2) && (stm->getColumn(2).getInt64() > ToStoreTime(*time)))
     {
-      ids.push_back(stm->getColumn(0).getInt64());
+      throw ExceptionImpl<EntryNotFound>(L"Value is no longer recorded for entry: " + PathToName(path));
     }
 
-    return ids;
+    ValueType recordedType = static_cast<ValueType>(stm->getColumn(1).getInt64());
+
+    if (recordedType != type)
+    {
+      throw ExceptionImpl<WrongValueType>((boost::wformat(L"Expected value type %1% for entry %2% but found: %3%") % ValueTypeToString(type) % PathToName(path) % ValueTypeToString(recordedType)).str());
+    }
+
+    getValue(*stm);
   }
 
-  Store::Children Store::GetChildEntryNames(Integer parent) const
+  Store::String Store::GetStringAt(const String& name, const TimePoint& time) const
   {
-    assert(m_Transaction.lock());
+    String value;
 
-    static const string Statement = "SELECT " + Table_Entries_Column_Name + " FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Parent + " = ?1 AND " + Table_Entries_Column_Id + " != 0";
-    auto stm = GetStatement(Statement);
+    GetEntryValueAt(ParseName(name), ValueType::String, &time, nullptr, [&value](SQLite::Statement& stm) { value = UTF8ToWchar(stm.getColumn(0).getText()); });
 
-    stm->bind(1, parent);
+    return value;
+  }
 
-    Children children;
+  Store::Integer Store::GetIntegerAt(const String& name, const TimePoint& time) const
+  {
+    Integer value;
 
-    while (stm->executeStep())
-    {
-      children.push_back(UTF8ToWchar(stm->getColumn(0).getText()));
-    }
+    GetEntryValueAt(ParseName(name), ValueType::Integer, &time, nullptr, [&value](SQLite::Statement& stm) { value = stm.getColumn(0).getInt64(); });
 
-    return children;
+    return value;
   }
 
-  Store::Children Store::GetChildren(const String& name) const
+  Store::Binary Store::GetBinaryAt(const String& name, const TimePoint& time) const
   {
-    ReadOnlyTransaction transaction(*this);
+    Binary value;
 
-    return GetChildEntryNames(name.empty() ? 0 : GetEntryId(ParseName(name)).back());
-  }
+    GetEntryValueAt(ParseName(name), ValueType::Binary, &time, nullptr, [&value](SQLite::Statement& stm) { if (!stm.isColumnNull(0))
+                                                                                                          {
+                                                                                                            value.resize(stm.getColumn(0).size());
+                                                                                                            memcpy(value.data(), stm.getColumn(0).getBlob(), value.size());
+                                                                                                          }
+                                                                                                        });
 
-  Store::ValueType Store::GetType(const String& name) const
-  {
-    return GetEntryType(ParseName(name));
+    return value;
   }
 
-  bool Store::IsInteger(const String& name) const
+  Store::String Store::GetStringAt(const String& name, const Revision& revision) const
   {
-    return GetEntryType(ParseName(name)) == ValueType::Integer;
+    String value;
+
+    GetEntryValueAt(ParseName(name), ValueType::String, nullptr, &revision, [&value](SQLite::Statement& stm) { value = UTF8ToWchar(stm.getColumn(0).getText()); });
+
+    return value;
   }
 
-  bool Store::IsString(const String& name) const
+  Store::Integer Store::GetIntegerAt(const String& name, const Revision& revision) const
   {
-    return GetEntryType(ParseName(name)) == ValueType::String;
+    Integer value;
+
+    GetEntryValueAt(ParseName(name), ValueType::Integer, nullptr, &revision, [&value](SQLite::Statement& stm) { value = stm.getColumn(0).getInt64(); });
+
+    return value;
   }
 
-  bool Store::IsBinary(const String& name) const
+  Store::Binary Store::GetBinaryAt(const String& name, const Revision& revision) const
   {
-    return GetEntryType(ParseName(name)) == ValueType::Binary;
+    Binary value;
+
+    GetEntryValueAt(ParseName(name), ValueType::Binary, nullptr, &revision, [&value](SQLite::Statement& stm) { if (!stm.isColumnNull(0))
+                                                                                                              {
+                                                                                                                value.resize(stm.getColumn(0).size());
+                                                                                                                memcpy(value.data(), stm.getColumn(0).getBlob(), value.size());
+                                                                                                              }
+                                                                                                            });
+
+    return value;
   }
 
-  Store::ValueType Store::GetEntryType(const Path& path) const
+  Store::Integer Store::RollbackSubtree(const String& name, const TimePoint& time)
   {
-    ReadOnlyTransaction transcation(*this);
+    WriteableTransaction transaction(*this);
 
-    return GetEntryType(GetEntryId(path).back());
-  }
+    Integer id = name.empty() ? 0 : GetTargetEntryId(ParseName(name));
+
+    // value of each entry valid at ?2 is the first one replaced after ?2, unless it became valid after ?2 (older values have been dropped)
+    // the history trigger records the replaced values, a rollback can be rolled back as well
+    auto rollback = [](const string& subtree)
+    {
+      return subtree + ", " +
+                     "Target(EntryId, Type, Value) AS (SELECT " + Table_History_Column_EntryId + "," + Table_History_Column_Type + "," + Table_History_Column_Value +
+                       " FROM " + Table_History + " AS Recorded WHERE " + Table_History_Column_EntryId + " IN Subtree AND " +
+                       Table_History_Column_ValidTo + " > ?2 AND (" + Table_History_Column_ValidFrom + " IS NULL OR " + Table_History_Column_ValidFrom + " <= ?2) AND " +
+                       "rowid = (SELECT rowid FROM " + Table_History + " WHERE " + Table_History_Column_EntryId + " = Recorded." + Table_History_Column_EntryId + " AND " +
+                                                                                 Table_History_Column_ValidTo + " > ?2" +
+                                " ORDER BY " + Table_History_Column_ValidTo + ", rowid LIMIT 1)) " +
+              "UPDATE " + Table_Entries + " SET " + Table_Entries_Column_Type + " = (SELECT Type FROM Target WHERE EntryId = " + Table_Entries + "." + Table_Entries_Column_Id + "), " +
+                                                    Table_Entries_Column_Value + " = (SELECT Value FROM Target WHERE EntryId = " + Table_Entries + "." + Table_Entries_Column_Id + "), " +
+                                                    Table_Entries_Column_Revision + " = " + Expression_NextRevision +
+                " WHERE " + Table_Entries_Column_Id + " IN (SELECT EntryId FROM Target)" +
+                " RETURNING " + Table_Entries_Column_Parent;
+    };
+    static const string Statement = rollback("WITH RECURSIVE Subtree(Id) AS (SELECT ?1 UNION ALL SELECT " + Table_Entries + "." + Table_Entries_Column_Id + " FROM " + Table_Entries +
+                                                                              " JOIN Subtree ON " + Table_Entries + "." + Table_Entries_Column_Parent + " = Subtree.Id" +
+                                                                              " WHERE " + Table_Entries + "." + Table_Entries_Column_Id + " != 0)");
+    // in full path mode all descendants are a range of full names, [?3, ?4), as long as no entry is missing its full name
+    static const string StatementByFullPath = rollback("WITH Subtree(Id) AS (SELECT ?1 UNION ALL SELECT " + Table_Entries_Column_Id + " FROM " + Table_Entries +
+                                                                              " WHERE " + Table_Entries_Column_FullPath + " >= ?3 AND " + Table_Entries_Column_FullPath + " < ?4)");
+    bool byFullPath = m_FullPaths && (id != 0) && !HasMissingFullPaths();
+    IdList parents;
+
+    {
+      auto stm = GetStatement(byFullPath ? StatementByFullPath : Statement);
+
+      stm->bind(1, id);
+      stm->bind(2, ToStoreTime(time));
+
+      if (byFullPath)
+      {
+        // UTF-8 sorts like the code points, bytes 0xFF do not occur in UTF-8
+        auto lower = WcharToUTF8(PathToName(ParseName(name)) + m_Delimiter);
+        auto upper = lower;
+
+        upper.back()++;
+
+        stm->bind(3, lower);
+        stm->bind(4, upper);
+      }
 
-  Store::ValueType Store::GetEntryType(Integer id) const
-  {
-    assert(m_Transaction.lock());
+      while (stm->executeStep())
+      {
+        parents.push_back(stm->getColumn(0).getInt64());
+      }
+    }
 
-    static const string Statement = "SELECT " + Table_Entries_Column_Type + " FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Id + " = ?1";
-    auto stm = GetStatement(Statement);
+    Integer count = static_cast<Integer>(parents.size());
 
-    stm->bind(1, id);
+    // bump all parents of changed entries once, stop as soon as we reach a parent we have seen already
+    set<Integer> ancestors;
 
-    if (!stm->executeStep())
+    for (auto parent : parents)
     {
-      ExceptionImpl<InvalidQuery>((boost::wformat(L"Failed to query value type for: %1%") % id).str());
+      while ((parent != 0) && ancestors.insert(parent).second)
+      {
+        parent = GetEntryParent(parent);
+      }
     }
 
-    ValueType type = static_cast<ValueType>(stm->getColumn(0).getInt64());
-    
-    switch (type)
+    if (count > 0)
     {
-      case ValueType::Integer:
-      case ValueType::String:
-      case ValueType::Binary:
-        break;
-
-      default: throw ExceptionImpl<UnknownEntryType>((boost::wformat(L"Entry %1% has unknown value type: %2%") % id % static_cast<Integer>(type)).str());
+      UpdateRevisions(IdList(begin(ancestors), end(ancestors)));
     }
 
-    assert(!stm->executeStep());
+    transaction.Commit();
 
-    return type;
+    return count;
   }
 
-  bool Store::TryDeleteEntryImpl(Integer id, bool recursive)
+  Store::Integer Store::GetContentHash(const String& name) const
   {
-    assert(id != 0);
+    Integer hash;
 
-    if (recursive)
     {
-      IdList childs = GetChildEntries(id);
+      ReadOnlyTransaction transaction(*this);
 
-      for (auto child : childs)
-      {
-        TryDeleteEntryImpl(child, recursive);
-      }
-    }
-    else
-    {
-      if (HasChild(id))
-      {
-        return false;
-      }
+      hash = GetEntryHash(name.empty() ? 0 : GetTargetEntryId(ParseName(name)));
     }
 
-    assert(m_Transaction.lock());
+    PersistHashes();
 
-    static const string Statement = "DELETE FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Id + " = ?1";
-    auto stm = GetStatement(Statement);
+    return hash;
+  }
 
-    stm->bind(1, id);
+  void Store::Diff(const Store& other, const String& subtree, const DifferenceCallback& callback) const
+  {
+    {
+      ReadOnlyTransaction transaction(*this);
+      ReadOnlyTransaction otherTransaction(other);
 
-    stm->exec();
+      Integer now = GetStoreTime();
+      Difference difference;
 
-    return true;
+      // subtree is a name of this store, its segments are looked up in other whatever delimiter other uses
+      Path path = subtree.empty() ? Path() : ParseName(subtree);
+
+      DiffEntries(path.empty() ? 0 : GetTargetEntryId(path), other, path.empty() ? 0 : other.GetTargetEntryId(path), subtree, now, difference, callback);
+    }
+
+    PersistHashes();
+    other.PersistHashes();
   }
 
-  bool Store::TryDeleteEntry(const IdList& idPath, bool recursive)
+  bool Store::ApplyDiff(const std::vector<Difference>& differences)
   {
-    assert(!idPath.empty());
+    WriteBatch batch(*this);
 
-    if (TryDeleteEntryImpl(idPath.back(), recursive))
+    // children of a removed entry follow it, they get deleted together with it
+    String removed;
+
+    for (const auto& difference : differences)
     {
-      // update revision of parent entries
-      UpdateRevision(begin(idPath), begin(idPath) + (idPath.size() - 1));
+      if (!removed.empty() && (difference.Name.compare(0, removed.size(), removed) == 0))
+      {
+        continue;
+      }
 
-      return true;
+      removed.clear();
+
+      switch (difference.Type)
+      {
+        case DiffType::Removed:
+          batch.Delete(difference.Name, true);
+          removed = difference.Name + m_Delimiter;
+          break;
+
+        case DiffType::Added:
+        case DiffType::Changed:
+          switch (difference.EntryType)
+          {
+            case ValueType::Integer:
+              batch.SetOrCreate(difference.Name, difference.IntegerValue);
+              break;
+
+            case ValueType::String:
+              batch.SetOrCreate(difference.Name, difference.StringValue);
+              break;
+
+            case ValueType::Binary:
+              batch.SetOrCreate(difference.Name, difference.BinaryValue);
+              break;
+          }
+          break;
+      }
     }
 
-    return false;
+    return batch.Apply();
   }
 
-  bool Store::TryDelete(const String& name, bool recursive)
+  Store::Integer Store::ExpireDue(Integer maxEntries)
   {
     WriteableTransaction transaction(*this);
 
-    IdList idPath;
+    // driven by the partial index on the expiry time
+    static const string Statement1 = "SELECT " + Table_Entries_Column_Id + " FROM " + Table_Entries + " WHERE " + Table_Entries_Column_Expires + " <= ?1 " +
+                                       "ORDER BY " + Table_Entries_Column_Expires + " LIMIT ?2";
+
+    IdList expired;
 
-    if (!GetEntryId(idPath, ParseName(name)))
     {
-      return false;  // entry not found
+      auto stm = GetStatement(Statement1);
+
+      stm->bind(1, GetStoreTime());
+      stm->bind(2, (maxEntries > 0) ? maxEntries : -1);
+
+      while (stm->executeStep())
+      {
+        expired.push_back(stm->getColumn(0).getInt64());
+      }
     }
 
-    if (!TryDeleteEntry(idPath, recursive))
+    auto getParent = GetStatement(Statement_GetEntryParent);
+
+    IdList  parents;
+    Integer count = 0;
+
+    for (auto id : expired)
     {
-      return false;  // has children and recursive == false
-    }
+      // collect parents up to the root, expired entries below an other expired entry might be gone already
+      IdList  path;
+      Integer current = id;
+      bool    exists = true;
 
-    transaction.Commit();
+      while (current != 0)
+      {
+        getParent->reset();
+        getParent->bind(1, current);
 
-    return true;
-  }
+        if (!getParent->executeStep())
+        {
+          exists = false;
+          break;
+        }
 
-  void Store::Delete(const String& name, bool recursive)
-  {
-    WriteableTransaction transaction(*this);
+        current = getParent->getColumn(0).getInt64();
 
-    if (!TryDeleteEntry(GetEntryId(ParseName(name)), recursive))
+        if (current != 0)
+        {
+          path.push_back(current);
+        }
+      }
+
+      getParent->reset();
+
+      if (exists)
+      {
+        TryDeleteEntryImpl(id, true);
+
+        parents.insert(end(parents), begin(path), end(path));
+        count++;
+      }
+    }
+
+    if (count > 0)
     {
-      throw ExceptionImpl<HasChildEntry>(L"Faild to delete due to existing child entries: " + name);
+      UpdateRevisions(parents);
     }
 
     transaction.Commit();
+
+    return count;
   }
 
   bool Store::IsValidNewDelimiter(String::value_type delimiter) const
@@ -1240,6 +4125,20 @@ namespace Configuration
 
     SetSetting(Setting_NameDelimiter, String({delimiter}));
 
+    // names do not contain the new delimiter, so replacing the old one is unambiguous
+    if (m_FullPaths)
+    {
+      static const string Statement = "UPDATE " + Table_Entries + " SET " + Table_Entries_Column_FullPath + " = REPLACE(" + Table_Entries_Column_FullPath + ", ?1, ?2)" +
+                                        " WHERE " + Table_Entries_Column_FullPath + " IS NOT NULL";
+      auto stm = GetStatement(Statement);
+
+      stm->bind(1, WcharToUTF8(String(1, m_Delimiter)));
+      stm->bind(2, WcharToUTF8(String(1, delimiter)));
+      stm->exec();
+
+      SetSetting(Setting_FullPaths, String(1, delimiter));
+    }
+
     transaction.Commit();
 
     // should never throw an exception!
@@ -1264,12 +4163,22 @@ namespace Configuration
     else
     {
       // open new transcation
+      // cached statements that have not run to completion keep holding a read lock on the database (or table for shared-cache
+      // in-memory databases) even after the transaction has ended, so we reset all of them at the end of the outermost transaction
+      // our own commits do not change the data version, modes switched (or rolled back) by them have to be read again
       transaction.reset(new SQLite::Transaction(*m_Database, writeable ? SQLite::Transaction::TransactionType::Immediate :
-                                                                         SQLite::Transaction::TransactionType::Deferred));
+                                                                         SQLite::Transaction::TransactionType::Deferred),
+                        [this, writeable](SQLite::Transaction* ptr) { ResetStatements(); delete ptr; m_DataVersion = writeable ? -1 : m_DataVersion; });
 
       m_Transaction = transaction;
       m_WriteableTransaction = writeable;
 
+      // nothing to read before the constructor has set up the database
+      if (m_DatabaseVersionMajor != 0)
+      {
+        ReadModes();
+      }
+
       return transaction;
     }
   }
@@ -1310,12 +4219,27 @@ namespace Configuration
     }
   }
 
+  void Store::DeleteSetting(const string& name)
+  {
+    assert(m_Transaction.lock() && m_WriteableTransaction);
+
+    // the settings table has been created w/o primary key, INSERT OR REPLACE would just add another row
+    static const string Statement = "DELETE FROM " + Table_Settings + " WHERE " + Table_Settings_Column_Name + " = ?1";
+    auto stm = GetStatement(Statement);
+
+    stm->bind(1, name);
+
+    stm->exec();
+  }
+
   template <typename Value>
   void Store::SetSettingImpl(const string& name, const Value& value)
   {
     assert(m_Transaction.lock() && m_WriteableTransaction);
 
-    static const string Statement = "INSERT OR REPLACE INTO " + Table_Settings + " VALUES (?1, ?2)";
+    DeleteSetting(name);
+
+    static const string Statement = "INSERT INTO " + Table_Settings + " VALUES (?1, ?2)";
     auto stm = GetStatement(Statement);
 
     stm->bind(1, name);
@@ -1328,7 +4252,9 @@ namespace Configuration
   {
     assert(m_Transaction.lock() && m_WriteableTransaction);
 
-    static const string Statement = "INSERT OR REPLACE INTO " + Table_Settings + " VALUES (?1, ?2)";
+    DeleteSetting(name);
+
+    static const string Statement = "INSERT INTO " + Table_Settings + " VALUES (?1, ?2)";
     auto stm = GetStatement(Statement);
 
     stm->bind(1, name);
@@ -1433,17 +4359,229 @@ namespace Configuration
     }
   }
 
+  void Store::EnableWriteBack(const String& name, const WriteBackPolicy& policy)
+  {
+    Flush();
+
+    m_WriteBack = make_unique<Detail::WriteBackBuffer>(!name.empty() ? ParseName(name) : Path(), policy);
+  }
+
+  void Store::DisableWriteBack()
+  {
+    Flush();
+
+    m_WriteBack.reset();
+  }
+
+  bool Store::IsWriteBackEnabled() const noexcept
+  {
+    return static_cast<bool>(m_WriteBack);
+  }
+
+  size_t Store::GetPendingWrites() const noexcept
+  {
+    return m_WriteBack ? m_WriteBack->m_Pending.size() : 0;
+  }
+
+  void Store::Flush()
+  {
+    if (!m_WriteBack || m_WriteBack->m_Pending.empty())
+    {
+      return;
+    }
+
+    if (m_Transaction.lock())
+    {
+      throw ExceptionImpl<InvalidTransaction>(L"Pending writes must not be flushed within a transaction");
+    }
+
+    // take pending writes out of the buffer first, the batch opens a writeable transaction that would flush them again
+    auto pending = std::move(m_WriteBack->m_Pending);
+
+    m_WriteBack->m_Pending.clear();
+
+    try
+    {
+      WriteBatch batch(*this);
+
+      for (const auto& write : pending)
+      {
+        boost::apply_visitor(Detail::AddToBatch(batch, PathToName(write.first)), write.second);
+      }
+
+      // failing writes belong to entries deleted by someone else in the meantime, drop them
+      batch.Apply();
+    }
+    catch (...)
+    {
+      m_WriteBack->m_Pending = std::move(pending);
+      throw;
+    }
+  }
+
+  bool Store::FlushDue()
+  {
+    if (!m_WriteBack || m_WriteBack->m_Pending.empty() ||
+        ((chrono::steady_clock::now() - m_WriteBack->m_FirstPending) < m_WriteBack->m_Policy.MaxPendingTime))
+    {
+      return false;
+    }
+
+    Flush();
+
+    return true;
+  }
+
+  template <typename T>
+  bool Store::WriteBack(const String& name, const T& value, bool create)
+  {
+    if (!m_WriteBack || m_Transaction.lock())
+    {
+      return false;
+    }
+
+    Path path = ParseName(name);
+
+    if (!m_WriteBack->Contains(path))
+    {
+      return false;
+    }
+
+    auto& pending = m_WriteBack->m_Pending;
+    auto  iter = pending.find(path);
+
+    if (iter != end(pending))
+    {
+      iter->second = value;
+    }
+    else
+    {
+      // only writes to existing entries are buffered, new entries are created right away
+      if (!Exists(name))
+      {
+        if (create)
+        {
+          return false;
+        }
+
+        throw ExceptionImpl<EntryNotFound>(L"Entry not found: " + name);
+      }
+
+      if (pending.empty())
+      {
+        m_WriteBack->m_FirstPending = chrono::steady_clock::now();
+      }
+
+      pending.emplace(std::move(path), value);
+    }
+
+    if ((pending.size() >= m_WriteBack->m_Policy.MaxPendingEntries) ||
+        ((chrono::steady_clock::now() - m_WriteBack->m_FirstPending) >= m_WriteBack->m_Policy.MaxPendingTime))
+    {
+      Flush();
+    }
+
+    return true;
+  }
+
+  template <typename T>
+  bool Store::GetPendingValue(const Path& path, ValueType type, T& value) const
+  {
+    if (!m_WriteBack)
+    {
+      return false;
+    }
+
+    auto iter = m_WriteBack->m_Pending.find(path);
+
+    if (iter == end(m_WriteBack->m_Pending))
+    {
+      return false;
+    }
+
+    const T* pending = boost::get<T>(&iter->second);
+
+    if (pending == nullptr)
+    {
+      throw ExceptionImpl<WrongValueType>((boost::wformat(L"Expected value type %1% for entry %2% but found: %3%") % ValueTypeToString(type) % PathToName(path) % ValueTypeToString(Detail::WriteBackBuffer::GetType(iter->second))).str());
+    }
+
+    value = *pending;
+
+    return true;
+  }
+
+  shared_ptr<SQLite::Transaction> Store::GetWriteableTransaction()
+  {
+    if (!m_Transaction.lock())
+    {
+      Flush();
+    }
+
+    return GetTransaction(true);
+  }
+
+  void Store::ClearCaches() const noexcept
+  {
+    m_ChildrenCache->Clear();
+    m_PendingHashes.clear();
+  }
+
+  void Store::SignalChange() noexcept
+  {
+    if (m_ChangeSignal)
+    {
+      try
+      {
+        m_ChangeSignal->Notify();
+      }
+      catch (...)
+      {
+        // the commit has been done, watchers waiting with a timeout will see it nevertheless
+      }
+    }
+  }
+
+  void Store::PrepareStatements() const
+  {
+    for (const auto& statement : PreparedStatements)
+    {
+      GetStatement(statement);
+    }
+  }
+
+  void Store::ResetStatements() const noexcept
+  {
+    for (auto& statement : m_StatementCache)
+    {
+      try
+      {
+        statement.second->reset();
+      }
+
+      catch (...)
+      {
+        // reset() reports the error of the last execution (if any), which has already been reported when it happend
+      }
+    }
+  }
+
   ReadOnlyTransaction::ReadOnlyTransaction(const Store& store)
   : m_Transaction(store.GetTransaction(false))
   {
   }
 
+  ReadOnlyTransaction::ReadOnlyTransaction(shared_ptr<SQLite::Transaction> transaction)
+  : m_Transaction(move(transaction))
+  {
+  }
+
   ReadOnlyTransaction::~ReadOnlyTransaction() noexcept
   {
   }
 
   WriteableTransaction::WriteableTransaction(Store& store)
-  : m_Commited(false), m_SavepointName(), m_Transaction(store.GetTransaction(true))
+  : m_Store(store), m_Commited(false), m_SavepointName(), m_Transaction(store.GetWriteableTransaction())
   {
     if (!m_Transaction.unique())
     {
@@ -1461,9 +4599,15 @@ namespace Configuration
     // Rational: if we know we can't recover from an error in a save and sane way there is only one safe option we have left 
     //           => terminate execution immediately to save the day!
 
-    if (!m_Commited && !m_SavepointName.empty())
+    if (!m_Commited)
     {
-      m_Transaction->RollbackSavepoint(m_SavepointName);
+      // a rollback resets revisions to values we might see again later on with different data attached
+      m_Store.ClearCaches();
+
+      if (!m_SavepointName.empty())
+      {
+        m_Transaction->RollbackSavepoint(m_SavepointName);
+      }
     }
   }
 
@@ -1479,6 +4623,11 @@ namespace Configuration
     }
 
     m_Commited = true;
+
+    if (m_SavepointName.empty())
+    {
+      m_Store.SignalChange();
+    }
   }
 
 }
@@ -13,6 +13,7 @@
 #include <exception>
 #include <functional>
 #include <map>
+#include <chrono>
 
 #include <boost\noncopyable.hpp>
 
@@ -32,6 +33,11 @@ namespace Configuration
   {
     template <typename Integer>
     class RandomNumberGenerator;
+
+    template <typename Key, typename Value>
+    class LruCache;
+
+    struct WriteBackBuffer;
   }
 
   namespace UnitTest
@@ -45,6 +51,8 @@ namespace Configuration
 
   class ReadOnlyTransaction;
   class WriteableTransaction;
+  class WriteBatch;
+  class ChangeSignal;
 
   // TODO: multi-thread safety !?!?!
   // TODO: retries in case of a busy database!?
@@ -66,19 +74,49 @@ namespace Configuration
       using Binary  = std::vector<std::uint8_t>;
 
       using Children = std::vector<String>;
+      using SharedChildren = std::shared_ptr<const Children>;
 
       enum class ValueType {Integer = 1, String = 2, Binary = 3};
 
+      // Added: entry exists in the other store only, Removed: entry exists in this store only, Changed: type or value differ
+      enum class DiffType {Added, Removed, Changed};
+
+      // difference reported by Diff(), type and value are the ones in the other store (not set for Removed)
+      struct Difference
+      {
+        Difference();
+
+        DiffType  Type;
+        String    Name;
+        ValueType EntryType;
+        Integer   IntegerValue;
+        String    StringValue;
+        Binary    BinaryValue;
+      };
+
+      using DifferenceCallback = std::function<void(const Difference& difference)>;
+
+      // size of a subtree as returned by GetStats()
+      struct Stats
+      {
+        Stats();
+
+        // number of descendants of the entry
+        Integer Descendants;
+        // bytes of the values of the entry and all its descendants (UTF-8 strings, binaries, 8 per integer)
+        Integer Size;
+      };
+
       class Revision
       {
         public:
-          inline explicit Revision(Integer id = 0, Integer revision = 0) noexcept
-          : m_Id(id), m_Revision(revision)
+          inline explicit Revision(Integer id = 0, Integer revision = 0, Integer nameHash = 0) noexcept
+          : m_Id(id), m_Revision(revision), m_NameHash(nameHash)
           {}
 
           inline bool operator==(const Revision& rhs) const noexcept 
           {
-            return (m_Id == rhs.m_Id) && (m_Revision == rhs.m_Revision);
+            return (m_Id == rhs.m_Id) && (m_Revision == rhs.m_Revision) && (m_NameHash == rhs.m_NameHash);
           }
 
           inline bool operator!=(const Revision& rhs) const noexcept 
@@ -91,18 +129,96 @@ namespace Configuration
 
           Integer m_Id;
           Integer m_Revision;
+          // hash of the name and parent of the entry (0 for root), tells an entry from a later one that got the same id
+          Integer m_NameHash;
       };
 
       static const String::value_type DefaultNameDelimiter;
 
+      // options applied when opening a store, they are not persisted in the store
+      struct Options
+      {
+        Options();
+
+        // overwrite content of deleted entries, makes deleting entries considerably more expensive
+        // default: false
+        bool SecureDelete;
+
+        // prepare all statements used by regular operations when opening the store
+        // moves the preparation cost from the first operations to opening the store
+        // default: false
+        bool PrepareStatements;
+
+        // max. number of child lists cached by GetChildren() and GetSharedChildren(), 0 disables the cache
+        // cached lists are validated by the revision of their parent entry
+        // default: 0
+        std::size_t ChildrenCacheSize;
+
+        // resolve names by probing an integer index of hashes of parent and name instead of the index of the names
+        // the names are only compared for entries with a matching hash, pays off for long names and deep paths
+        // default: false
+        bool HashNameLookup;
+
+        // bump the cross-process change signal of the store (see ChangeSignal) on every commit of an outermost transaction
+        // processes watching the store then no longer need to poll, not available for private in-memory stores
+        // default: false
+        bool SignalChanges;
+      };
+
+      // limits for pending writes in write-back mode, see EnableWriteBack()
+      struct WriteBackPolicy
+      {
+        WriteBackPolicy();
+
+        // pending writes are flushed as soon as this number of entries is pending
+        // default: 1000
+        std::size_t MaxPendingEntries;
+
+        // pending writes are flushed by the first write after the oldest pending write got older than this
+        // default: 1 sec
+        std::chrono::milliseconds MaxPendingTime;
+      };
+
+      // file name of a private in-memory store, content is lost when the Store object is destroyed
+      static const std::wstring InMemoryFileName;
+
+      // returns file name of a named in-memory store that is shared by all Store objects in the same process opened with the same name
+      // content is lost when the last Store object referring to it is destroyed
+      static std::wstring GetSharedInMemoryFileName(const std::wstring& name);
+
 
       // opens existing configuration store
-      explicit Store(const std::wstring& fileName, bool create = false, wchar_t nameDelimiter = DefaultNameDelimiter);
+      // use InMemoryFileName or GetSharedInMemoryFileName() as fileName to open an in-memory store, <create> is ignored for in-memory stores
+      explicit Store(const std::wstring& fileName, bool create = false, wchar_t nameDelimiter = DefaultNameDelimiter, const Options& options = Options());
 
       ~Store() noexcept;
 
       String::value_type GetNameDelimiter() const noexcept;
 
+      bool IsInMemory() const noexcept;
+
+      // file name the store has been opened with, can be used to open further Store objects on the same store
+      // (not for InMemoryFileName, each of them is a separate store)
+      std::wstring GetFileName() const;
+
+      // true while a ReadOnlyTransaction or WriteableTransaction (incl. the ones used internally) is active
+      bool IsInTransaction() const noexcept;
+
+      // starts a read-only transaction holding the read lock, returns nullptr instead of waiting if a writer is about to commit
+      // lets several Store objects take their read locks without deadlocking with that writer (see Detail::LockAll())
+      std::unique_ptr<ReadOnlyTransaction> TryReadOnlyTransaction() const;
+
+      // replaces the whole content of the store with the content of the store in fileName
+      // fileName is only read, the content of a store of an older version is upgraded in this store only
+      // pending writes of write-back mode are dropped, they belong to the replaced content
+      // must not be called within a transaction
+      void LoadFrom(const std::wstring& fileName);
+
+      // copies the whole content of the store into fileName, creates fileName if needed, any existing content is replaced
+      // pending writes of write-back mode are not copied, call Flush() before if they are needed
+      // must not be called within a transaction
+      void SaveTo(const std::wstring& fileName) const;
+
       // valid names must not:
       // - start or end with a delimiter
       // - conttain multiple consecutive delimiters
@@ -130,10 +246,38 @@ namespace Configuration
       //   -> next to impossible in finite time and space given that entry ids and revisions internally are at least 64 bit wide
       Revision GetRevision(const String& name = L"") const;
 
+      // polls revisions of many entries at once, e.g. of subtrees watched for changes
+      // returns false right away if the revision of the root entry still equals root (no entry has changed since),
+      // otherwise updates root and sets revisions[i] to the current revision of handles[i] or names[i], all by a few queries
+      // handles are revisions returned by GetRevision() or GetRevisions() before, they are polled by the id of their entry
+      // without resolving names, deleted entries get Revision() (re-created ones have to be polled by name again), so do
+      // handles whose id has been reused by an entry with another name or parent
+      // entries that do not exist or are expired (incl. their ancestors) get Revision(), an entry expiring does not change
+      // the revision of root
+      bool GetRevisions(const std::vector<Revision>& handles, std::vector<Revision>& revisions, Revision& root) const;
+      bool GetRevisions(const std::vector<String>& names, std::vector<Revision>& revisions, Revision& root) const;
+
       // empty name == root
       bool HasChild(const String& name) const;
       // empty name == root
       Children GetChildren(const String& name) const;
+      // empty name == root
+      // same as GetChildren() but the returned list may be shared with other callers, see Options::ChildrenCacheSize
+      SharedChildren GetSharedChildren(const String& name) const;
+      // empty name == root
+      // number of all descendants, expired entries and their descendants are not counted
+      Integer CountDescendants(const String& name) const;
+      // empty name == root
+      // names of all descendants relative to name, parents before their children, expired entries and their descendants excluded
+      Children GetSubtree(const String& name) const;
+      // empty name == root
+      // O(1), the statistics are kept in each entry and updated along the ancestors by every write
+      // expired entries are covered until they get deleted by ExpireDue()
+      Stats GetStats(const String& name) const;
+      // recomputes the statistics of all entries, O(n * depth)
+      // only needed if a store has been written by versions before 1.6 since it was opened the last time, missing statistics
+      // of entries created by them are computed when opening the store
+      void RebuildStats();
 
       // create new entry, fails if already exests
       void Create(const String& name, const String& value);
@@ -145,11 +289,29 @@ namespace Configuration
       void Set(const String& name, Integer       value);
       void Set(const String& name, const Binary& value);
 
+      // set existing entry only if its revision still equals expected (e.g. as returned by GetRevision(name))
+      // returns false if the entry has been changed, deleted or re-created in the meantime
+      // checked and written by a single conditional update, no need to hold a transaction between GetRevision() and SetIf()
+      bool SetIf(const String& name, const String& value, const Revision& expected);
+      bool SetIf(const String& name, Integer       value, const Revision& expected);
+      bool SetIf(const String& name, const Binary& value, const Revision& expected);
+
       // create new or set existing entry
       void SetOrCreate(const String& name, const String& value);
       void SetOrCreate(const String& name, Integer       value);
       void SetOrCreate(const String& name, const Binary& value);
 
+      // atomic operations on existing entries, each executed by a single update within the database
+      // throw WrongValueType if the entry has another value type
+      // adds delta to the value and returns the new value, throws ValueOutOfRange if the result does not fit into an Integer
+      Integer Increment(const String& name, Integer delta = 1);
+      // appends data to the value and returns the new size of the value
+      Integer AppendBinary(const String& name, const Binary& data);
+      // sets the value to desired only if it currently equals expected, returns false otherwise
+      bool CompareAndSwap(const String& name, const String& expected, const String& desired);
+      bool CompareAndSwap(const String& name, Integer       expected, Integer       desired);
+      bool CompareAndSwap(const String& name, const Binary& expected, const Binary& desired);
+
       // get value, entry has to exist
       String GetString(const String& name) const;
       Integer GetInteger(const String& name) const;
@@ -160,9 +322,127 @@ namespace Configuration
       // throws EntryNotFound if name does not exist
       // throws HasChildEntry if recursive == false and name has children
       void Delete(const String& name, bool recursive = true);
+      // deletes name only if its revision still equals expected (e.g. as returned by GetRevision(name))
+      // returns false if the entry has been changed, deleted or re-created in the meantime or has children and recursive == false
+      bool DeleteIf(const String& name, const Revision& expected, bool recursive = true);
+
+      using TimePoint = std::chrono::system_clock::time_point;
+
+      // expired entries (incl. their children) are treated as not existing and get deleted by ExpireDue()
+      // changing the expiry time bumps the revision of the entry, expiring does not
+      void SetExpiry(const String& name, const TimePoint& expires);
+      void SetTimeToLive(const String& name, const std::chrono::milliseconds& timeToLive);
+      void ClearExpiry(const String& name);
+      // returns false if the entry never expires
+      bool GetExpiry(const String& name, TimePoint& expires) const;
+
+      // history of values, recorded by all Store objects as it is part of the store
+      // keeps up to maxValues previous values per entry that are not older than maxAge (0 == no limit), the latest one is always kept
+      // maxValues == 0 disables the history and drops all recorded values
+      void SetHistoryRetention(Integer maxValues, const std::chrono::milliseconds& maxAge = std::chrono::milliseconds(0));
+
+      // value an entry had at a past point in time or revision (as returned by GetRevision(name))
+      // returns the current value if no change after time or revision has been recorded
+      // throws EntryNotFound if the value has already been dropped from the history, revision belongs to another entry,
+      // the history is disabled or time is before the history has been enabled (changes before have not been recorded)
+      // revisions are not timestamped, revisions from before the history has been enabled can not be detected
+      String GetStringAt(const String& name, const TimePoint& time) const;
+      Integer GetIntegerAt(const String& name, const TimePoint& time) const;
+      Binary GetBinaryAt(const String& name, const TimePoint& time) const;
+      String GetStringAt(const String& name, const Revision& revision) const;
+      Integer GetIntegerAt(const String& name, const Revision& revision) const;
+      Binary GetBinaryAt(const String& name, const Revision& revision) const;
+
+      // sets all entries below and incl. name (empty name == root) back to the value they had at time with a single update
+      // entries created or deleted in the meantime are not touched, neither are entries whose value at time is not recorded
+      // takes a point in time and not a revision: revisions are per entry and the ones of ancestors are bumped by changes of
+      // descendants without being recorded, there is no revision of a whole subtree to go back to
+      // returns number of changed entries
+      Integer RollbackSubtree(const String& name, const TimePoint& time);
+
+      // content hash of an entry and all its descendants (empty name == root), covers names, types, values and expiry times
+      // but not revisions -> equal for equal content in different stores
+      // hashes are stored in the store and only recomputed for entries whose revision changed since (i.e. changed subtrees)
+      // expired entries are covered until they get deleted by ExpireDue()
+      // hashes computed outside of a transaction are written to the store afterwards by a short writeable transaction of
+      // their own unless the store is locked by another writer, within a transaction they are kept by this Store object
+      Integer GetContentHash(const String& name) const;
+
+      // reports all differences of subtree (empty name == root) in other compared to this store in name order, parents
+      // before their children, names are reported using the delimiter of this store
+      // only descends into subtrees whose content hashes differ, entries of a subtree existing in one store only are
+      // reported one by one
+      // expired entries are treated as not existing, subtree has to exist in both stores, this store and other have to use
+      // different databases, hashes are stored in both like by GetContentHash()
+      void Diff(const Store& other, const String& subtree, const DifferenceCallback& callback) const;
+
+      // applies differences reported by Diff() within one transaction, this store becomes equal to the other one
+      // removed entries are deleted recursively, their removed children are skipped
+      // returns false if some differences could not be applied (e.g. due to changes in the meantime), the others are applied anyway
+      bool ApplyDiff(const std::vector<Difference>& differences);
+
+      // deletes up to maxEntries (0 == all) expired entries incl. their children, earliest expired first
+      // cost depends on the number of expired entries and not on the size of the store
+      // returns number of deleted expired entries, children are not counted
+      Integer ExpireDue(Integer maxEntries = 0);
+
+      // write-back mode: Set() and SetOrCreate() of existing entries below name (empty name == whole store) are buffered in memory
+      // instead of being written into the database, writes within an explicit transaction are never buffered
+      // buffered values are immediately visible to GetType(), Is...() and Get...() of this Store object, all others
+      // (other Store objects, GetRevision(), HasChild(), GetChildren(), ...) only see them after they have been flushed
+      // pending writes are flushed by Flush(), FlushDue(), when a limit of policy is reached, before any other write and by the destructor
+      //   -> if the process dies, writes of up to policy.MaxPendingTime are lost as long as writes keep coming or FlushDue() is
+      //      called periodically (Store objects are not multi-thread safe, so there is no flushing thread of their own),
+      //      call Flush() where a tighter bound is needed
+      // writes to entries deleted by other Store objects in the meantime are dropped when flushed
+      // only one subtree at a time, enabling write-back again flushes pending writes first
+      void EnableWriteBack(const String& name, const WriteBackPolicy& policy = WriteBackPolicy());
+      // flushes pending writes
+      void DisableWriteBack();
+      bool IsWriteBackEnabled() const noexcept;
+
+      // writes all pending writes within one transaction, must not be called within a transaction
+      void Flush();
+      // flushes pending writes if the oldest of them is older than policy.MaxPendingTime, e.g. called from a timer of the
+      // application to bound the loss window while no further writes come, must not be called within a transaction
+      // returns true if pending writes have been flushed
+      bool FlushDue();
+      std::size_t GetPendingWrites() const noexcept;
+
+      // pages freed by deleting entries are not returned to the file system until the store is compacted
+      // returns ratio of free pages to all pages in the database, 0.0 - 1.0
+      double GetFreePageRatio() const;
+
+      // returns free pages to the file system, at most maxPages (0 == all) are freed to keep the write transaction short
+      // returns number of freed pages
+      Integer Compact(Integer maxPages = 0);
+
+      // updates the statistics the query planner uses to select indices, statistics are persisted in the store
+      // run from time to time (e.g. see BackgroundMaintenance) and after large changes
+      void Optimize();
+
+      // full path mode: each entry also stores its full name in an indexed column, names of any depth are resolved by a single
+      // index probe instead of one probe per name segment and subtrees are read by range scans
+      // costs the storage of the full names, the mode is stored in the store and applies to all Store objects using it from their
+      // next transaction on
+      // enabling computes the full names of all entries, O(n)
+      void SetFullPathMode(bool enable);
+      bool IsFullPathMode() const noexcept;
+
+      // subtree index: a closure table of all (ancestor, descendant) pairs maintained by triggers, CountDescendants(),
+      // GetSubtree() and deleting subtrees become indexed range queries instead of recursive traversals
+      // costs one row per entry and ancestor, creating and deleting entries gets more expensive
+      // the index is part of the store and maintained by all Store objects, they use it from their next transaction on
+      void SetSubtreeIndex(bool enable);
+      bool HasSubtreeIndex() const noexcept;
 
       // slow, depends on number of entries in DB! >= O(n)!
-      void CheckDataConsistency() const;
+      // checks names, types and linking of all entries
+      // threads > 1 (0 == one per core) checks partitions of the entries in parallel, each thread using its own read-only
+      // connection, all of them take their read locks before any is used and so see the same state of the store
+      // private in-memory stores can not be opened a second time and are always checked by the calling thread, so is a store
+      // within a transaction (the connections of the threads would not see its changes)
+      void CheckDataConsistency(std::size_t threads = 1) const;
 
       // slow, depends on number of entries in DB! >= O(n)!
       // returns number of moved entries
@@ -181,11 +461,30 @@ namespace Configuration
 
       using RandomNumberGenerator = std::unique_ptr<Detail::RandomNumberGenerator<Integer>>;
 
+      struct CachedChildren
+      {
+        Integer        m_Revision;  // revision of parent entry
+        Integer        m_Expires;   // earliest expiry time of the children
+        SharedChildren m_Children;
+      };
+
+      using ChildrenCache = std::unique_ptr<Detail::LruCache<Integer, CachedChildren>>;
+
+      // content hashes computed within read-only transactions, written to the store by PersistHashes()
+      struct CachedHash
+      {
+        Integer m_Revision;  // revision of the entry
+        Integer m_Hash;
+      };
+
+      using PendingHashes = std::map<Integer, CachedHash>;
+
       using Database = std::unique_ptr<SQLite::Database>;
       using Statement = std::unique_ptr<SQLite::Statement>;
 
       friend class ReadOnlyTransaction;
       friend class WriteableTransaction;
+      friend class WriteBatch;
       
       // this is a somewhat dirty trick to get access to private members in Store objects ...
 #ifdef CONFIGURATION_UNITTEST_ENABLE_PRIVATEACCESS
@@ -210,6 +509,8 @@ namespace Configuration
       void SetSettingImpl(const std::string& name, const Value& value);
       void SetSettingImpl(const std::string& name, const Store::Binary& value);
 
+      void DeleteSetting(const std::string& name);
+
       void SetSetting(const std::string& name, Integer value);
       void SetSetting(const std::string& name, const String& value);
       void SetSetting(const std::string& name, const Binary& value);
@@ -221,7 +522,41 @@ namespace Configuration
       Binary GetSettingBin(const std::string& name) const;
 
       void GetAndCheckConfiguration(wchar_t nameDelimiter);
+      // upgrades the database layout from an older minor version to the current one
+      void UpgradeDatabase();
       void CheckOrSetRootEntry();
+      // computes missing name hashes, e.g. of entries created by versions before 1.4
+      void UpdateNameHashes();
+
+      // hash of a UTF-8 name of an entry below parent, as stored in the NameHash column
+      static Integer GetNameHash(Integer parent, const std::string& name);
+
+      // computes full names of entries if they are missing or have been computed with another delimiter, see SetFullPathMode()
+      void CheckFullPaths();
+      void UpdateFullPaths();
+      // true if any entry has no full name (created while another Store object did not know about full path mode yet)
+      bool HasMissingFullPaths() const;
+
+      // re-reads the modes other Store objects on the same database may have switched, at the start of each transaction
+      // the modes are only queried if the data version has changed since they have been read the last time
+      void ReadModes() const;
+
+      // changes of the statistics are collected per connection by temporary triggers and applied to all ancestors
+      // of the changed entries by UpdateRevision() and UpdateRevisions()
+      void CreateStatsTriggers();
+      void ApplyStatsDeltas();
+      // computes statistics of all entries if some are missing (always == true: in any case)
+      void UpdateStats(bool always);
+
+      // checks that fileName contains a store we can load, without changing (upgrading) it
+      static void CheckSourceDatabase(const std::wstring& fileName);
+
+      // (re-)creates the history triggers in schema ("main." or the attached database) according to the retention in its settings
+      void CreateHistoryTriggers(const std::string& schema) const;
+
+      // copies content of fileName into this store (load == true) or content of this store into fileName (load == false)
+      // an older source is copied into the current layout, only the columns it has are copied
+      void CopyDatabase(const std::wstring& fileName, bool load) const;
 
 
       using IdList = std::vector<Integer>;
@@ -242,7 +577,13 @@ namespace Configuration
       bool GetEntryId(IdList& idPath, const Path& path, Integer parent = 0) const;
       IdList GetEntryId(const Path& path, Integer parent = 0) const;
       bool GetEntryId(IdList& idPath, const String& name, Integer parent = 0) const;
+      bool GetEntryId(IdList& idPath, const std::string& name, Integer parent) const;  // UTF-8 name
       IdList GetEntryId(const String& entryName, Integer parent = 0) const;
+      // resolves path (below root) by its full name, false if not found or any entry of the path is expired
+      bool GetEntryIdByFullPath(IdList& idPath, const Path& path) const;
+      // id of the entry path (below root) refers to, same as GetEntryId(path).back() but the ids of the ancestors are not needed
+      bool GetTargetEntryId(Integer& id, const Path& path) const;
+      Integer GetTargetEntryId(const Path& path) const;
 
 
       using ValueBinder = std::function<void(int, SQLite::Statement&)>;
@@ -251,23 +592,48 @@ namespace Configuration
       bool Store::HasChild(Integer parent) const;
 
       Integer GetEntryRevision(Integer id) const;
+      // ids < 0 and ids of entries that do not exist or are expired get Revision()
+      // with checkHandles also entries with another name hash than their handle and entries with an expired ancestor
+      void GetEntryRevisions(const std::vector<Revision>& handles, bool checkHandles, std::vector<Revision>& revisions) const;
+      // false if root is still the current revision of the root entry, updates root otherwise
+      bool UpdateRootRevision(Revision& root) const;
+
+      Integer GetEntryParent(Integer id) const;
 
       Integer GetRandomRevision();
       // bumps revision of the root entry and all ids in idPath, idPath may be empty
       void UpdateRevision(IdList::const_iterator first, IdList::const_iterator last);
+      // bumps revision of the root entry and of each id in ids exactly once, ids of no longer existing entries are ignored
+      void UpdateRevisions(IdList ids);
 
       void SetEntry(const IdList& idPath, ValueType type, const ValueBinder& bindValue);
+      // does not update any revision, caller has to take care of them
+      void SetEntryValue(Integer id, ValueType type, const ValueBinder& bindValue);
       void SetEntry(const String& name, ValueType type, const ValueBinder& bindValue);
+      bool SetEntryIf(const String& name, ValueType type, const ValueBinder& bindValue, const Revision& expected);
+      // expires == false clears the expiry time
+      void SetEntryExpiry(const String& name, bool expires, Integer expiryTime);
+      // executes statementText with ?1 == id, ?2 == type and bindValues starting at ?3, the statement has to return a row on success
+      // returns false if no row was returned, throws WrongValueType if the entry has another type
+      bool UpdateEntryValue(const String& name, ValueType type, const std::string& statementText,
+                            const std::vector<ValueBinder>& bindValues, const ValueGetter& getResult);
 
       void CreateEntry(Integer parent, const String& name, ValueType type, const ValueBinder& bindValue);
+      void CreateEntry(Integer parent, const std::string& name, ValueType type, const ValueBinder& bindValue);  // UTF-8 name
       void CreateEntry(IdList parentPath, Path::const_iterator first, const Path::const_iterator& last, ValueType type, const ValueBinder& bindValue);
       void CreateEntry(const Path& path, ValueType type, const ValueBinder& bindValue);
 
       void SetOrCreate(const Path& path, ValueType type, const ValueBinder& bindValue);
 
       void GetEntryValue(const Path& path, ValueType type, const ValueGetter& getValue) const;
+      // either time or revision has to be given
+      void GetEntryValueAt(const Path& path, ValueType type, const TimePoint* time, const Revision* revision, const ValueGetter& getValue) const;
 
       IdList GetChildEntries(Integer parent) const;
+      // UTF-8 names and ids of all children incl. expired ones, ordered by name (byte-wise == by code point, same on all platforms)
+      std::vector<std::pair<std::string, Integer>> GetNamedChildEntries(Integer parent) const;
+      // same as above but only children that have not expired at now
+      std::vector<std::pair<std::string, Integer>> GetNamedChildEntries(Integer parent, Integer now) const;
       Children GetChildEntryNames(Integer parent) const;
 
       // do not use directly, always call TryDeleteEntry() !
@@ -278,8 +644,38 @@ namespace Configuration
       String ValueTypeToString(ValueType type) const;
 
       void TraverseChildren(Integer id, std::function<void(Integer)> func) const;
+      void CheckDataConsistencyImpl() const;
+
+      // recomputes stale hashes of id and its descendants, they are only written within a writeable transaction and
+      // kept in m_PendingHashes otherwise
+      Integer GetEntryHash(Integer id) const;
+      // writes m_PendingHashes by a writeable transaction of its own, does nothing within a transaction
+      // hashes are kept if another writer holds the lock, we do not wait for it
+      void PersistHashes() const;
+      // both entries have to exist, name is the name of id in this store
+      void DiffEntries(Integer id, const Store& other, Integer otherId, const String& name, Integer now, Difference& difference, const DifferenceCallback& callback) const;
+      // reports id and all its descendants of store, type and value are taken from store unless type == Removed
+      void ReportEntries(const Store& store, Integer id, const String& name, DiffType type, Integer now, Difference& difference, const DifferenceCallback& callback) const;
+
+      // returns true if the write has been buffered, see EnableWriteBack()
+      template <typename T>
+      bool WriteBack(const String& name, const T& value, bool create);
+      // returns true if value has been taken from a pending write
+      template <typename T>
+      bool GetPendingValue(const Path& path, ValueType type, T& value) const;
+
+      // flushes pending writes before a new outermost transaction is started
+      std::shared_ptr<SQLite::Transaction> GetWriteableTransaction();
+
+      // drops all cached data that is not validated against the database, e.g. after a rollback
+      void ClearCaches() const noexcept;
+
+      // called after an outermost transaction has been committed, see Options::SignalChanges
+      void SignalChange() noexcept;
 
       CachedStatement GetStatement(const std::string& statementText) const;
+      void PrepareStatements() const;
+      void ResetStatements() const noexcept;
 
       static const Integer CurrentMajorVersion;
       static const Integer CurrentMinorVersion;
@@ -291,17 +687,33 @@ namespace Configuration
       // variables
       mutable Database m_Database;
 
+      std::string m_FileName;  // UTF-8
+
+      bool m_InMemory;
+
       Integer m_DatabaseVersionMajor;
       Integer m_DatabaseVersionMinor;
 
       String::value_type m_Delimiter;
 
+      bool m_HashNameLookup;
+      mutable bool m_FullPaths;
+      mutable bool m_SubtreeIndex;
+      mutable Integer m_DataVersion;  // of the modes read last, -1 after a writeable transaction of ours
+
       mutable std::weak_ptr<SQLite::Transaction> m_Transaction;
       mutable bool                               m_WriteableTransaction;
 
       mutable StatementCache m_StatementCache;
 
       RandomNumberGenerator m_RandomNumberGenerator;
+
+      mutable ChildrenCache m_ChildrenCache;
+      mutable PendingHashes m_PendingHashes;
+
+      std::unique_ptr<Detail::WriteBackBuffer> m_WriteBack;
+
+      std::unique_ptr<ChangeSignal> m_ChangeSignal;
   };
 
   // transactions are non-copyable (incl. move assignment!) but support move construction 
@@ -313,6 +725,10 @@ namespace Configuration
       ~ReadOnlyTransaction() noexcept;
 
     private:
+      friend class Store;
+
+      explicit ReadOnlyTransaction(std::shared_ptr<SQLite::Transaction> transaction);
+
       std::shared_ptr<SQLite::Transaction> m_Transaction;      
   };
 
@@ -326,6 +742,7 @@ namespace Configuration
     void Commit();
 
   private:
+    Store&                               m_Store;
     bool                                 m_Commited;
     std::string                          m_SavepointName;
     std::shared_ptr<SQLite::Transaction> m_Transaction;
@@ -354,6 +771,8 @@ namespace Configuration
   struct NameAlreadyExists : RuntimeError {};
   struct HasChildEntry :     RuntimeError {};
   struct WrongValueType :    RuntimeError {};
+  struct ValueOutOfRange :   RuntimeError {};
+  struct InvalidJson :       RuntimeError {};
 
   struct DatabaseError :      RuntimeError {};
   struct InvalidQuery :       DatabaseError {};
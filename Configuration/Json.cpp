@@ -0,0 +1,1281 @@
+// Copyright (c) 2014 by Bertolt Mildner
+// All rights reserved.
+
+#include "Json.h"
+
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <sstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+#include "Utils.h"
+
+CONFIGURATION_BOOST_INCL_GUARD_BEGIN
+#include <boost/format.hpp>
+CONFIGURATION_BOOST_INCL_GUARD_END
+
+#include "WriteBatch.h"
+#include "Parallel.h"
+
+using namespace std;
+
+namespace
+{
+  using Configuration::Store;
+  using Configuration::ExceptionImpl;
+  using Configuration::InvalidJson;
+
+  const string BinaryPrefix = "base64:";
+  // exported in front of strings starting with one of the prefixes, removed on import
+  const string StringPrefix = "string:";
+
+  bool HasPrefix(const string& text, const string& prefix)
+  {
+    return text.compare(0, prefix.size(), prefix) == 0;
+  }
+
+  const char Base64Chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+  // deep nesting is a malformed input rather than a configuration, do not let it exhaust the stack
+  const size_t MaxDepth = 512;
+
+  string EncodeBase64(const Store::Binary& data)
+  {
+    string text;
+
+    text.reserve(((data.size() + 2) / 3) * 4);
+
+    for (size_t i = 0; i < data.size(); i += 3)
+    {
+      uint32_t block = static_cast<uint32_t>(data[i]) << 16;
+
+      if ((i + 1) < data.size())
+      {
+        block |= static_cast<uint32_t>(data[i + 1]) << 8;
+      }
+
+      if ((i + 2) < data.size())
+      {
+        block |= static_cast<uint32_t>(data[i + 2]);
+      }
+
+      text += Base64Chars[(block >> 18) & 0x3F];
+      text += Base64Chars[(block >> 12) & 0x3F];
+      text += ((i + 1) < data.size()) ? Base64Chars[(block >> 6) & 0x3F] : '=';
+      text += ((i + 2) < data.size()) ? Base64Chars[block & 0x3F] : '=';
+    }
+
+    return text;
+  }
+
+  // returns false if text (starting at first) is not valid base64
+  bool DecodeBase64(const string& text, size_t first, Store::Binary& data)
+  {
+    if (((text.size() - first) % 4) != 0)
+    {
+      return false;
+    }
+
+    data.clear();
+    data.reserve(((text.size() - first) / 4) * 3);
+
+    for (size_t i = first; i < text.size(); i += 4)
+    {
+      uint32_t block = 0;
+      size_t padding = 0;
+
+      for (size_t j = 0; j < 4; j++)
+      {
+        char c = text[i + j];
+        const char* pos = (c != '\0') ? strchr(Base64Chars, c) : nullptr;
+
+        // padding only at the end of the last block
+        if ((c == '=') && ((i + 4) == text.size()) && (j >= 2))
+        {
+          padding++;
+        }
+        else if ((pos == nullptr) || (padding > 0))
+        {
+          return false;
+        }
+
+        block = (block << 6) | ((pos != nullptr) ? static_cast<uint32_t>(pos - Base64Chars) : 0);
+      }
+
+      data.push_back(static_cast<uint8_t>(block >> 16));
+
+      if (padding < 2)
+      {
+        data.push_back(static_cast<uint8_t>(block >> 8));
+      }
+
+      if (padding < 1)
+      {
+        data.push_back(static_cast<uint8_t>(block));
+      }
+    }
+
+    return true;
+  }
+
+  void AppendUTF8(string& text, uint32_t codePoint)
+  {
+    if (codePoint < 0x80)
+    {
+      text += static_cast<char>(codePoint);
+    }
+    else if (codePoint < 0x800)
+    {
+      text += static_cast<char>(0xC0 | (codePoint >> 6));
+      text += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+    else if (codePoint < 0x10000)
+    {
+      text += static_cast<char>(0xE0 | (codePoint >> 12));
+      text += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+      text += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+    else
+    {
+      text += static_cast<char>(0xF0 | (codePoint >> 18));
+      text += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+      text += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+      text += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+  }
+
+  // SAX-style reader, reports each value to handler as soon as it has been read
+  // Handler: StartObject(), Key(), EndObject(), StartArray(), EndArray(), String(), Integer(), Null()
+  template <typename Handler>
+  class JsonReader : private boost::noncopyable
+  {
+    public:
+      JsonReader(istream& input, Handler& handler)
+      : m_Input(*input.rdbuf()), m_Handler(handler), m_Offset(0), m_Depth(0)
+      {
+      }
+
+      void Parse()
+      {
+        ParseValue();
+
+        SkipWhitespace();
+
+        if (Peek() != char_traits<char>::eof())
+        {
+          Fail("Unexpected data after value");
+        }
+      }
+
+    private:
+      int Peek()
+      {
+        return m_Input.sgetc();
+      }
+
+      int Next()
+      {
+        m_Offset++;
+
+        return m_Input.sbumpc();
+      }
+
+      void Expect(char expected)
+      {
+        if (Next() != static_cast<unsigned char>(expected))
+        {
+          Fail((boost::format("Expected '%1%'") % expected).str());
+        }
+      }
+
+      void ExpectLiteral(const char* literal)
+      {
+        for (; *literal != '\0'; literal++)
+        {
+          Expect(*literal);
+        }
+      }
+
+      void SkipWhitespace()
+      {
+        for (int c = Peek(); (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n'); c = Peek())
+        {
+          Next();
+        }
+      }
+
+      void Fail(const string& message)
+      {
+        throw ExceptionImpl<InvalidJson>((boost::wformat(L"%1% at offset %2%") % Configuration::UTF8ToWchar(message) % m_Offset).str());
+      }
+
+      void ParseValue()
+      {
+        SkipWhitespace();
+
+        switch (Peek())
+        {
+          case '{':
+            ParseObject();
+            break;
+
+          case '[':
+            ParseArray();
+            break;
+
+          case '"':
+            m_Handler.String(ParseString());
+            break;
+
+          case 't':
+            ExpectLiteral("true");
+            m_Handler.Integer(1);
+            break;
+
+          case 'f':
+            ExpectLiteral("false");
+            m_Handler.Integer(0);
+            break;
+
+          case 'n':
+            ExpectLiteral("null");
+            m_Handler.Null();
+            break;
+
+          default:
+            m_Handler.Integer(ParseInteger());
+        }
+      }
+
+      void ParseObject()
+      {
+        if (++m_Depth > MaxDepth)
+        {
+          Fail("Nesting too deep");
+        }
+
+        Expect('{');
+        m_Handler.StartObject();
+
+        SkipWhitespace();
+
+        if (Peek() == '}')
+        {
+          Next();
+        }
+        else
+        {
+          for (;;)
+          {
+            SkipWhitespace();
+
+            if (Peek() != '"')
+            {
+              Fail("Expected member name");
+            }
+
+            m_Handler.Key(ParseString());
+
+            SkipWhitespace();
+            Expect(':');
+
+            ParseValue();
+
+            SkipWhitespace();
+
+            int c = Next();
+
+            if (c == '}')
+            {
+              break;
+            }
+
+            if (c != ',')
+            {
+              Fail("Expected ',' or '}'");
+            }
+          }
+        }
+
+        m_Handler.EndObject();
+        m_Depth--;
+      }
+
+      void ParseArray()
+      {
+        if (++m_Depth > MaxDepth)
+        {
+          Fail("Nesting too deep");
+        }
+
+        Expect('[');
+        m_Handler.StartArray();
+
+        SkipWhitespace();
+
+        if (Peek() == ']')
+        {
+          Next();
+        }
+        else
+        {
+          for (;;)
+          {
+            ParseValue();
+
+            SkipWhitespace();
+
+            int c = Next();
+
+            if (c == ']')
+            {
+              break;
+            }
+
+            if (c != ',')
+            {
+              Fail("Expected ',' or ']'");
+            }
+          }
+        }
+
+        m_Handler.EndArray();
+        m_Depth--;
+      }
+
+      uint32_t ParseHex4()
+      {
+        uint32_t value = 0;
+
+        for (int i = 0; i < 4; i++)
+        {
+          int c = Next();
+
+          value <<= 4;
+
+          if ((c >= '0') && (c <= '9'))
+          {
+            value |= c - '0';
+          }
+          else if ((c >= 'a') && (c <= 'f'))
+          {
+            value |= c - 'a' + 10;
+          }
+          else if ((c >= 'A') && (c <= 'F'))
+          {
+            value |= c - 'A' + 10;
+          }
+          else
+          {
+            Fail("Invalid unicode escape");
+          }
+        }
+
+        return value;
+      }
+
+      // returns UTF-8, escapes are decoded
+      string ParseString()
+      {
+        Expect('"');
+
+        string text;
+
+        for (;;)
+        {
+          int c = Next();
+
+          if (c == char_traits<char>::eof())
+          {
+            Fail("Unterminated string");
+          }
+
+          if (c == '"')
+          {
+            return text;
+          }
+
+          if (c < 0x20)
+          {
+            Fail("Control character in string");
+          }
+
+          if (c != '\\')
+          {
+            text += static_cast<char>(c);
+            continue;
+          }
+
+          switch (Next())
+          {
+            case '"':  text += '"';  break;
+            case '\\': text += '\\'; break;
+            case '/':  text += '/';  break;
+            case 'b':  text += '\b'; break;
+            case 'f':  text += '\f'; break;
+            case 'n':  text += '\n'; break;
+            case 'r':  text += '\r'; break;
+            case 't':  text += '\t'; break;
+
+            case 'u':
+            {
+              uint32_t codePoint = ParseHex4();
+
+              // surrogate pair
+              if ((codePoint >= 0xD800) && (codePoint <= 0xDBFF))
+              {
+                Expect('\\');
+                Expect('u');
+
+                uint32_t low = ParseHex4();
+
+                if ((low < 0xDC00) || (low > 0xDFFF))
+                {
+                  Fail("Invalid surrogate pair");
+                }
+
+                codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+              }
+              else if ((codePoint >= 0xDC00) && (codePoint <= 0xDFFF))
+              {
+                Fail("Invalid surrogate pair");
+              }
+
+              AppendUTF8(text, codePoint);
+              break;
+            }
+
+            default:
+              Fail("Invalid escape sequence");
+          }
+        }
+      }
+
+      Store::Integer ParseInteger()
+      {
+        bool negative = false;
+
+        if (Peek() == '-')
+        {
+          Next();
+          negative = true;
+        }
+
+        int c = Peek();
+
+        if ((c < '0') || (c > '9'))
+        {
+          Fail("Unexpected character");
+        }
+
+        // accumulate negative, the range of negative values is larger by one
+        Store::Integer value = 0;
+
+        // JSON does not allow leading zeros (e.g. 012)
+        if (c == '0')
+        {
+          Next();
+
+          c = Peek();
+
+          if ((c >= '0') && (c <= '9'))
+          {
+            Fail("Leading zeros are not allowed");
+          }
+        }
+
+        for (; (c >= '0') && (c <= '9'); c = Peek())
+        {
+          Next();
+
+          int digit = c - '0';
+
+          if (value < ((numeric_limits<Store::Integer>::min() + digit) / 10))
+          {
+            Fail("Number out of range");
+          }
+
+          value = (value * 10) - digit;
+        }
+
+        if ((c == '.') || (c == 'e') || (c == 'E'))
+        {
+          Fail("Only integer numbers are supported");
+        }
+
+        if (!negative)
+        {
+          if (value == numeric_limits<Store::Integer>::min())
+          {
+            Fail("Number out of range");
+          }
+
+          value = -value;
+        }
+
+        return value;
+      }
+
+      streambuf& m_Input;
+      Handler&   m_Handler;
+      size_t     m_Offset;
+      size_t     m_Depth;
+  };
+
+  // a value read from JSON, name and value still UTF-8 encoded
+  struct JsonValue
+  {
+    string           m_Name;
+    Store::ValueType m_Type;
+    Store::Integer   m_Integer;
+    string           m_Text;  // String and Binary (base64 incl. prefix)
+  };
+
+  using JsonValues = vector<JsonValue>;
+
+  // a value ready to be added to a WriteBatch
+  struct PreparedValue
+  {
+    Store::String    m_Name;
+    Store::ValueType m_Type;
+    Store::Integer   m_Integer;
+    Store::String    m_String;
+    Store::Binary    m_Binary;
+  };
+
+  using PreparedValues = vector<PreparedValue>;
+
+  // maps the values reported by JsonReader to names of entries, hands them on in chunks of chunkSize values
+  class JsonCollector : private boost::noncopyable
+  {
+    public:
+      using ChunkCallback = function<void(JsonValues&& values)>;
+
+      JsonCollector(const Store::String& name, Store::String::value_type delimiter, size_t chunkSize, const ChunkCallback& callback)
+      : m_Name(Configuration::WcharToUTF8(name)), m_Delimiter(Configuration::WcharToUTF8(Store::String(1, delimiter))), m_ChunkSize(chunkSize),
+        m_Callback(callback), m_Levels(), m_Values(), m_Count(0)
+      {
+      }
+
+      void StartObject()
+      {
+        m_Levels.push_back(Level(NextName(), false));
+      }
+
+      void StartArray()
+      {
+        auto name = NextName();
+
+        CheckName(name);
+
+        m_Levels.push_back(Level(name, true));
+      }
+
+      void EndObject()
+      {
+        Leave();
+      }
+
+      void EndArray()
+      {
+        Leave();
+      }
+
+      void Key(const string& key)
+      {
+        assert(!m_Levels.empty() && !m_Levels.back().m_IsArray);
+
+        m_Levels.back().m_Key = key;
+      }
+
+      void String(const string& value)
+      {
+        auto name = NextName();
+
+        CheckName(name);
+
+        if (HasPrefix(value, StringPrefix))
+        {
+          Add(JsonValue{move(name), Store::ValueType::String, 0, value.substr(StringPrefix.size())});
+        }
+        else
+        {
+          Add(JsonValue{move(name), HasPrefix(value, BinaryPrefix) ? Store::ValueType::Binary : Store::ValueType::String, 0, value});
+        }
+      }
+
+      void Integer(Store::Integer value)
+      {
+        auto name = NextName();
+
+        CheckName(name);
+
+        Add(JsonValue{move(name), Store::ValueType::Integer, value, string()});
+      }
+
+      void Null()
+      {
+        Integer(0);
+      }
+
+      Store::Integer Finish()
+      {
+        Flush();
+
+        return m_Count;
+      }
+
+    private:
+      struct Level
+      {
+        Level(const string& name, bool isArray)
+        : m_Name(name), m_Key(), m_IsArray(isArray), m_Index(0), m_HasChildren(false)
+        {
+        }
+
+        string      m_Name;
+        string      m_Key;
+        bool        m_IsArray;
+        std::size_t m_Index;
+        bool        m_HasChildren;
+      };
+
+      // name of the value about to be reported
+      string NextName()
+      {
+        if (m_Levels.empty())
+        {
+          return m_Name;
+        }
+
+        auto& level = m_Levels.back();
+
+        level.m_HasChildren = true;
+
+        string child = level.m_IsArray ? to_string(level.m_Index++) : level.m_Key;
+
+        return level.m_Name.empty() ? child : (level.m_Name + m_Delimiter + child);
+      }
+
+      void CheckName(const string& name)
+      {
+        if (name.empty())
+        {
+          throw ExceptionImpl<InvalidJson>(L"JSON imported into the root entry has to be an object");
+        }
+      }
+
+      void Leave()
+      {
+        assert(!m_Levels.empty());
+
+        auto& level = m_Levels.back();
+
+        // entries with children are created implicitly as parents
+        if (!level.m_HasChildren && !level.m_Name.empty())
+        {
+          Add(JsonValue{move(level.m_Name), Store::ValueType::Integer, 0, string()});
+        }
+
+        m_Levels.pop_back();
+      }
+
+      void Add(JsonValue&& value)
+      {
+        m_Values.push_back(move(value));
+        m_Count++;
+
+        if (m_Values.size() >= m_ChunkSize)
+        {
+          Flush();
+        }
+      }
+
+      void Flush()
+      {
+        if (!m_Values.empty())
+        {
+          m_Callback(move(m_Values));
+          m_Values.clear();
+        }
+      }
+
+      string                      m_Name;
+      string                      m_Delimiter;
+      size_t                      m_ChunkSize;
+      ChunkCallback               m_Callback;
+      vector<Level>               m_Levels;
+      JsonValues                  m_Values;
+      Store::Integer              m_Count;
+  };
+
+  // transcodes and validates, the only part of an import not touching the store
+  PreparedValues Prepare(JsonValues&& values, Store::String::value_type delimiter)
+  {
+    PreparedValues prepared(values.size());
+
+    for (size_t i = 0; i < values.size(); i++)
+    {
+      auto& value = values[i];
+      auto& result = prepared[i];
+
+      result.m_Name = Configuration::UTF8ToWchar(value.m_Name);
+      result.m_Type = value.m_Type;
+      result.m_Integer = value.m_Integer;
+
+      if (!Store::IsValidName(result.m_Name, delimiter))
+      {
+        throw ExceptionImpl<Configuration::InvalidName>(L"Invalid name: " + result.m_Name);
+      }
+
+      if (value.m_Type == Store::ValueType::String)
+      {
+        result.m_String = Configuration::UTF8ToWchar(value.m_Text);
+      }
+      else if ((value.m_Type == Store::ValueType::Binary) && !DecodeBase64(value.m_Text, BinaryPrefix.size(), result.m_Binary))
+      {
+        throw ExceptionImpl<InvalidJson>(L"Invalid base64 value for entry: " + result.m_Name);
+      }
+
+      value = JsonValue();
+    }
+
+    return prepared;
+  }
+
+  // adds prepared values to a WriteBatch, applies it each time it reaches batchSize
+  // threads != 1 lets the batch split and transcode names in parallel, see WriteBatch
+  class JsonWriter : private boost::noncopyable
+  {
+    public:
+      JsonWriter(Store& store, const Store::String& name, size_t batchSize, size_t threads)
+      : m_Batch(store, threads), m_BatchSize(batchSize), m_Name(name)
+      {
+      }
+
+      void Write(PreparedValues&& values)
+      {
+        for (auto& value : values)
+        {
+          switch (value.m_Type)
+          {
+            case Store::ValueType::Integer:
+              m_Batch.SetOrCreate(value.m_Name, value.m_Integer);
+              break;
+
+            case Store::ValueType::String:
+              m_Batch.SetOrCreate(value.m_Name, value.m_String);
+              break;
+
+            case Store::ValueType::Binary:
+              m_Batch.SetOrCreate(value.m_Name, value.m_Binary);
+              break;
+          }
+
+          if (m_Batch.Size() >= m_BatchSize)
+          {
+            Apply();
+          }
+        }
+      }
+
+      void Finish()
+      {
+        Apply();
+      }
+
+    private:
+      void Apply()
+      {
+        if (!m_Batch.Apply())
+        {
+          throw ExceptionImpl<Configuration::InvalidInsert>(L"Failed to import entries below: " + m_Name);
+        }
+
+        m_Batch.Clear();
+      }
+
+      Configuration::WriteBatch   m_Batch;
+      size_t                      m_BatchSize;
+      Store::String               m_Name;
+  };
+
+  void WriteString(ostream& output, const string& text)
+  {
+    static const char HexChars[] = "0123456789abcdef";
+
+    output.put('"');
+
+    for (char c : text)
+    {
+      switch (c)
+      {
+        case '"':  output << "\\\""; break;
+        case '\\': output << "\\\\"; break;
+        case '\b': output << "\\b";  break;
+        case '\f': output << "\\f";  break;
+        case '\n': output << "\\n";  break;
+        case '\r': output << "\\r";  break;
+        case '\t': output << "\\t";  break;
+
+        default:
+          if (static_cast<unsigned char>(c) < 0x20)
+          {
+            output << "\\u00" << HexChars[(c >> 4) & 0x0F] << HexChars[c & 0x0F];
+          }
+          else
+          {
+            output.put(c);
+          }
+      }
+    }
+
+    output.put('"');
+  }
+
+  // byte-wise order of UTF-8 == order of code points, same on all platforms
+  vector<string> SortChildren(Store::Children&& children)
+  {
+    vector<string> names;
+
+    names.reserve(children.size());
+
+    for (const auto& child : children)
+    {
+      names.push_back(Configuration::WcharToUTF8(child));
+    }
+
+    children.clear();
+    sort(begin(names), end(names));
+
+    return names;
+  }
+
+  Store::String ChildName(const Store& store, const Store::String& name, const string& child)
+  {
+    auto childName = Configuration::UTF8ToWchar(child);
+
+    return name.empty() ? childName : (name + store.GetNameDelimiter() + childName);
+  }
+
+  void ExportEntry(const Store& store, const Store::String& name, ostream& output)
+  {
+    Store::Children children = store.GetChildren(name);
+
+    if (name.empty() || !children.empty())
+    {
+      auto names = SortChildren(move(children));
+
+      output.put('{');
+
+      for (size_t i = 0; i < names.size(); i++)
+      {
+        if (i > 0)
+        {
+          output.put(',');
+        }
+
+        WriteString(output, names[i]);
+        output.put(':');
+
+        ExportEntry(store, ChildName(store, name, names[i]), output);
+      }
+
+      output.put('}');
+      return;
+    }
+
+    switch (store.GetType(name))
+    {
+      case Store::ValueType::Integer:
+        output << store.GetInteger(name);
+        break;
+
+      case Store::ValueType::String:
+      {
+        auto text = Configuration::WcharToUTF8(store.GetString(name));
+
+        // must not be taken for a binary (or an escaped string) on import
+        WriteString(output, (HasPrefix(text, BinaryPrefix) || HasPrefix(text, StringPrefix)) ? StringPrefix + text : text);
+        break;
+      }
+
+      case Store::ValueType::Binary:
+        WriteString(output, BinaryPrefix + EncodeBase64(store.GetBinary(name)));
+        break;
+    }
+  }
+
+  // state shared by the threads of a parallel export or import, all members guarded by m_Mutex
+  struct Pipeline
+  {
+    Pipeline()
+    : m_Mutex(), m_Changed(), m_Failed(false)
+    {
+    }
+
+    // waits until condition is met or another thread failed, returns false in the latter case
+    template <typename Condition>
+    bool Wait(unique_lock<mutex>& lock, const Condition& condition)
+    {
+      m_Changed.wait(lock, [&]() { return m_Failed || condition(); });
+
+      return !m_Failed;
+    }
+
+    // runs func, lets the other threads give up if it throws
+    template <typename Func>
+    void Run(const Func& func)
+    {
+      try
+      {
+        func();
+      }
+      catch (...)
+      {
+        {
+          lock_guard<mutex> lock(m_Mutex);
+
+          m_Failed = true;
+        }
+
+        m_Changed.notify_all();
+        throw;
+      }
+    }
+
+    mutex              m_Mutex;
+    condition_variable m_Changed;
+    bool               m_Failed;
+  };
+
+  // thrown to unwind a thread after another thread failed, that one reports the error
+  struct PipelineAborted {};
+}
+
+namespace Configuration
+{
+  Store::Integer ImportJson(Store& store, const Store::String& name, istream& input, size_t batchSize)
+  {
+    batchSize = max<size_t>(batchSize, 1);
+
+    WriteableTransaction transaction(store);
+
+    JsonWriter writer(store, name, batchSize, 1);
+    JsonCollector collector(name, store.GetNameDelimiter(), batchSize, [&](JsonValues&& values) { writer.Write(Prepare(move(values), store.GetNameDelimiter())); });
+    JsonReader<JsonCollector> reader(input, collector);
+
+    reader.Parse();
+
+    Store::Integer count = collector.Finish();
+
+    writer.Finish();
+
+    transaction.Commit();
+
+    return count;
+  }
+
+  Store::Integer ImportJson(Store& store, const Store::String& name, istream& input, size_t batchSize, size_t threads)
+  {
+    batchSize = max<size_t>(batchSize, 1);
+    threads = Detail::GetThreadCount(threads);
+
+    auto delimiter = store.GetNameDelimiter();
+
+    // chunks in flight between the parser and the store, limits memory use if the store can not keep up
+    const size_t window = 2 * threads + 2;
+
+    Pipeline pipeline;
+
+    deque<pair<size_t, JsonValues>> parsed;    // waiting to be prepared
+    map<size_t, PreparedValues>     prepared;  // waiting to be written, by sequence number
+    size_t                          produced = 0;
+    size_t                          written = 0;
+    bool                            finished = false;
+    Store::Integer                  count = 0;
+
+    WriteableTransaction transaction(store);
+
+    // calling thread writes (the store must only be used by it), one thread parses, all others prepare
+    Detail::RunParallel(threads + 2, [&](size_t index)
+    {
+      if (index == 0)
+      {
+        pipeline.Run([&]()
+        {
+          JsonWriter writer(store, name, batchSize, threads);
+
+          for (;;)
+          {
+            PreparedValues values;
+
+            {
+              unique_lock<mutex> lock(pipeline.m_Mutex);
+
+              if (!pipeline.Wait(lock, [&]() { return (prepared.count(written) != 0) || (finished && (written == produced)); }))
+              {
+                return;
+              }
+
+              if (prepared.count(written) == 0)
+              {
+                break;
+              }
+
+              values = move(prepared[written]);
+              prepared.erase(written++);
+            }
+
+            pipeline.m_Changed.notify_all();
+
+            writer.Write(move(values));
+          }
+
+          writer.Finish();
+        });
+      }
+      else if (index == 1)
+      {
+        try
+        {
+          pipeline.Run([&]()
+          {
+            JsonCollector collector(name, delimiter, batchSize, [&](JsonValues&& values)
+            {
+              {
+                unique_lock<mutex> lock(pipeline.m_Mutex);
+
+                if (!pipeline.Wait(lock, [&]() { return (produced - written) < window; }))
+                {
+                  throw PipelineAborted();
+                }
+
+                parsed.push_back(make_pair(produced++, move(values)));
+              }
+
+              pipeline.m_Changed.notify_all();
+            });
+
+            JsonReader<JsonCollector> reader(input, collector);
+
+            reader.Parse();
+
+            auto total = collector.Finish();
+
+            {
+              lock_guard<mutex> lock(pipeline.m_Mutex);
+
+              finished = true;
+              count = total;
+            }
+
+            pipeline.m_Changed.notify_all();
+          });
+        }
+        catch (const PipelineAborted&)
+        {
+        }
+      }
+      else
+      {
+        pipeline.Run([&]()
+        {
+          for (;;)
+          {
+            pair<size_t, JsonValues> values;
+
+            {
+              unique_lock<mutex> lock(pipeline.m_Mutex);
+
+              if (!pipeline.Wait(lock, [&]() { return !parsed.empty() || finished; }) || parsed.empty())
+              {
+                return;
+              }
+
+              values = move(parsed.front());
+              parsed.pop_front();
+            }
+
+            auto result = Prepare(move(values.second), delimiter);
+
+            {
+              lock_guard<mutex> lock(pipeline.m_Mutex);
+
+              prepared[values.first] = move(result);
+            }
+
+            pipeline.m_Changed.notify_all();
+          }
+        });
+      }
+    });
+
+    transaction.Commit();
+
+    return count;
+  }
+
+  void ExportJson(const Store& store, const Store::String& name, ostream& output)
+  {
+    ReadOnlyTransaction transaction(store);
+
+    ExportEntry(store, name, output);
+  }
+
+  void ExportJson(const Store& store, const Store::String& name, ostream& output, size_t threads)
+  {
+    threads = Detail::GetThreadCount(threads);
+
+    auto fileName = store.GetFileName();
+
+    // Store objects of the threads would neither see uncommitted changes of a transaction of ours nor pending writes
+    if ((threads == 1) || (fileName == Store::InMemoryFileName) || store.IsInTransaction() || (store.GetPendingWrites() != 0))
+    {
+      ExportJson(store, name, output);
+      return;
+    }
+
+    // opening a store writes to it, has to be done before we hold the read lock
+    vector<unique_ptr<Store>> readers;
+
+    for (size_t i = 0; i < threads; i++)
+    {
+      readers.push_back(make_unique<Store>(fileName, false, store.GetNameDelimiter()));
+    }
+
+    // all Store objects hold their read locks before any of them is used, writers can not commit until all threads are done
+    // and so all of them see the same state
+    vector<unique_ptr<ReadOnlyTransaction>> transactions(threads + 1);
+
+    Detail::LockAll(threads + 1, [&](size_t index, bool wait)
+    {
+      const Store& locked = (index == 0) ? store : *readers[index - 1];
+
+      if (wait)
+      {
+        transactions[index] = make_unique<ReadOnlyTransaction>(locked);
+      }
+      else
+      {
+        transactions[index] = locked.TryReadOnlyTransaction();
+      }
+
+      return transactions[index] != nullptr;
+    },
+    [&](size_t index)
+    {
+      transactions[index].reset();
+    });
+
+    if (!name.empty() && !store.HasChild(name))
+    {
+      ExportEntry(store, name, output);
+      return;
+    }
+
+    auto names = SortChildren(store.GetChildren(name));
+
+    // children exported but not yet written, limits memory use if the output can not keep up
+    const size_t window = 2 * threads;
+
+    Pipeline pipeline;
+
+    vector<string> parts(names.size());
+    vector<char>   done(names.size(), 0);
+    size_t         next = 0;
+    size_t         written = 0;
+
+    // calling thread writes the children in order, all others export them into memory
+    Detail::RunParallel(threads + 1, [&](size_t index)
+    {
+      if (index == 0)
+      {
+        pipeline.Run([&]()
+        {
+          output.put('{');
+
+          while (written < names.size())
+          {
+            string part;
+
+            {
+              unique_lock<mutex> lock(pipeline.m_Mutex);
+
+              if (!pipeline.Wait(lock, [&]() { return done[written] != 0; }))
+              {
+                return;
+              }
+
+              part.swap(parts[written]);
+            }
+
+            if (written > 0)
+            {
+              output.put(',');
+            }
+
+            WriteString(output, names[written]);
+            output.put(':');
+            output.write(part.data(), part.size());
+
+            {
+              lock_guard<mutex> lock(pipeline.m_Mutex);
+
+              written++;
+            }
+
+            pipeline.m_Changed.notify_all();
+          }
+
+          output.put('}');
+        });
+      }
+      else
+      {
+        pipeline.Run([&]()
+        {
+          const Store& reader = *readers[index - 1];
+
+          for (;;)
+          {
+            size_t i;
+
+            {
+              unique_lock<mutex> lock(pipeline.m_Mutex);
+
+              if (!pipeline.Wait(lock, [&]() { return (next >= names.size()) || ((next - written) < window); }) || (next >= names.size()))
+              {
+                return;
+              }
+
+              i = next++;
+            }
+
+            ostringstream part;
+
+            ExportEntry(reader, ChildName(reader, name, names[i]), part);
+
+            {
+              lock_guard<mutex> lock(pipeline.m_Mutex);
+
+              parts[i] = part.str();
+              done[i] = 1;
+            }
+
+            pipeline.m_Changed.notify_all();
+          }
+        });
+      }
+    });
+  }
+}
@@ -0,0 +1,50 @@
+// Copyright (c) 2014 by Bertolt Mildner
+// All rights reserved.
+
+#ifndef CONFIGURATION_JSON_H
+#define CONFIGURATION_JSON_H
+
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+
+#include "Configuration.h"
+
+namespace Configuration
+{
+  // mapping between JSON and entries:
+  //   objects                    <-> entries with children, members become child entries named by their key
+  //   arrays                      -> entries with children named "0", "1", ... (exported as objects)
+  //   integer numbers, true/false <-> Integer (true == 1, false == 0)
+  //   strings                    <-> String
+  //   strings "base64:<data>"    <-> Binary
+  //   strings "string:<text>"    <-> String <text>, used for strings starting with "base64:" or "string:"
+  //   null, {}, []                -> entries with default value
+  // values of entries with children are not exported, keys containing the delimiter of the store create nested entries
+  // fractional numbers are not supported
+
+  // imports UTF-8 encoded JSON from input below name (empty name == root, the JSON value then has to be an object)
+  // parses input as a stream, memory use depends on the nesting depth and not on the size of input
+  // changes are applied in batches of batchSize entries within one transaction, existing entries are overwritten
+  // throws InvalidJson on malformed input, nothing is imported in that case
+  // returns number of imported values
+  Store::Integer ImportJson(Store& store, const Store::String& name, std::istream& input, std::size_t batchSize = 10000);
+
+  // same as above, but input is parsed by one thread while names and values are transcoded and validated by <threads> further
+  // threads (0 == one per core), the calling thread only applies the prepared batches in the order they have been read
+  Store::Integer ImportJson(Store& store, const Store::String& name, std::istream& input, std::size_t batchSize, std::size_t threads);
+
+  // exports name (empty name == root) and all its descendants as UTF-8 encoded JSON, children ordered by name
+  void ExportJson(const Store& store, const Store::String& name, std::ostream& output);
+
+  // same output as above, but the children of name are exported by <threads> threads (0 == one per core), each with its own
+  // Store object opened on GetFileName(), the calling thread writes them in order as soon as they are available
+  // all Store objects take their read locks before any of them is used, so all threads see the same state of the store
+  // private in-memory stores can not be opened a second time and are always exported by the calling thread, so are stores
+  // within a transaction or with pending writes of write-back mode (the other Store objects would not see the changes)
+  void ExportJson(const Store& store, const Store::String& name, std::ostream& output, std::size_t threads);
+}
+
+#endif
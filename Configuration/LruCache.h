@@ -0,0 +1,113 @@
+// Copyright (c) 2014 by Bertolt Mildner
+// All rights reserved.
+
+#ifndef CONFIGURATION_LRUCACHE_H
+#define CONFIGURATION_LRUCACHE_H
+
+#pragma once
+
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <cassert>
+
+
+namespace Configuration
+{
+  namespace Detail
+  {
+    // least recently used cache with a fixed capacity, capacity 0 disables the cache
+    template <typename Key, typename Value>
+    class LruCache
+    {
+      public:
+        explicit LruCache(std::size_t capacity)
+        : m_Capacity(capacity), m_Entries(), m_Index()
+        {
+        }
+
+        // returns nullptr if key is not in the cache, otherwise marks key as most recently used
+        // returned pointer is valid until the next non-const call
+        Value* Find(const Key& key)
+        {
+          auto iter = m_Index.find(key);
+
+          if (iter == m_Index.end())
+          {
+            return nullptr;
+          }
+
+          m_Entries.splice(m_Entries.begin(), m_Entries, iter->second);
+
+          return &iter->second->second;
+        }
+
+        // inserts or replaces key, evicts the least recently used entry if the cache is full
+        void Insert(const Key& key, Value value)
+        {
+          if (m_Capacity == 0)
+          {
+            return;
+          }
+
+          auto iter = m_Index.find(key);
+
+          if (iter != m_Index.end())
+          {
+            iter->second->second = std::move(value);
+            m_Entries.splice(m_Entries.begin(), m_Entries, iter->second);
+
+            return;
+          }
+
+          if (m_Index.size() >= m_Capacity)
+          {
+            m_Index.erase(m_Entries.back().first);
+            m_Entries.pop_back();
+          }
+
+          m_Entries.emplace_front(key, std::move(value));
+          m_Index.emplace(key, m_Entries.begin());
+
+          assert(m_Index.size() == m_Entries.size());
+        }
+
+        void Erase(const Key& key)
+        {
+          auto iter = m_Index.find(key);
+
+          if (iter != m_Index.end())
+          {
+            m_Entries.erase(iter->second);
+            m_Index.erase(iter);
+          }
+        }
+
+        void Clear() noexcept
+        {
+          m_Index.clear();
+          m_Entries.clear();
+        }
+
+        std::size_t Size() const noexcept
+        {
+          return m_Index.size();
+        }
+
+        std::size_t Capacity() const noexcept
+        {
+          return m_Capacity;
+        }
+
+      private:
+        using Entries = std::list<std::pair<Key, Value>>;
+        using Index   = std::unordered_map<Key, typename Entries::iterator>;
+
+        std::size_t m_Capacity;
+        Entries     m_Entries;
+        Index       m_Index;
+    };
+  }
+}
+
+#endif
@@ -0,0 +1,133 @@
+// Copyright (c) 2014 by Bertolt Mildner
+// All rights reserved.
+
+#include "Maintenance.h"
+
+#include <cassert>
+#include <memory>
+
+using namespace std;
+
+namespace Configuration
+{
+  MaintenancePolicy::MaintenancePolicy()
+  : FreePageRatio(0.25), MaxPagesPerStep(256), Interval(chrono::seconds(60)), OptimizeInterval(chrono::hours(1))
+  {
+  }
+
+  BackgroundMaintenance::BackgroundMaintenance(const wstring& fileName, const MaintenancePolicy& policy)
+  : m_FileName(fileName), m_Policy(policy), m_CompactedPages(0), m_OptimizeRuns(0), m_FailedRuns(0), m_Mutex(), m_Condition(),
+    m_Stop(false), m_LastOptimize(chrono::steady_clock::now()), m_Thread()
+  {
+    // start thread last, all members it uses have to be initialized
+    m_Thread = thread(&BackgroundMaintenance::Run, this);
+  }
+
+  BackgroundMaintenance::~BackgroundMaintenance() noexcept
+  {
+    {
+      lock_guard<mutex> lock(m_Mutex);
+      m_Stop = true;
+    }
+
+    m_Condition.notify_all();
+
+    m_Thread.join();
+  }
+
+  Store::Integer BackgroundMaintenance::GetCompactedPages() const noexcept
+  {
+    return m_CompactedPages;
+  }
+
+  Store::Integer BackgroundMaintenance::GetOptimizeRuns() const noexcept
+  {
+    return m_OptimizeRuns;
+  }
+
+  Store::Integer BackgroundMaintenance::GetFailedRuns() const noexcept
+  {
+    return m_FailedRuns;
+  }
+
+  bool BackgroundMaintenance::StopRequested()
+  {
+    lock_guard<mutex> lock(m_Mutex);
+
+    return m_Stop;
+  }
+
+  void BackgroundMaintenance::Run() noexcept
+  {
+    unique_ptr<Store> store;
+
+    for (;;)
+    {
+      try
+      {
+        // Store objects are not multi-thread safe, so we need our own, opened on this thread
+        if (!store)
+        {
+          store = make_unique<Store>(m_FileName);
+        }
+
+        RunOnce(*store);
+      }
+
+      catch (...)
+      {
+        // retry with a fresh Store object after the next interval
+        store.reset();
+        m_FailedRuns++;
+      }
+
+      unique_lock<mutex> lock(m_Mutex);
+
+      if (m_Condition.wait_for(lock, m_Policy.Interval, [this]() { return m_Stop; }))
+      {
+        break;
+      }
+    }
+  }
+
+  void BackgroundMaintenance::RunOnce(Store& store)
+  {
+    Compact(store);
+
+    if ((m_Policy.OptimizeInterval.count() > 0) && ((chrono::steady_clock::now() - m_LastOptimize) >= m_Policy.OptimizeInterval))
+    {
+      store.Optimize();
+
+      m_LastOptimize = chrono::steady_clock::now();
+      m_OptimizeRuns++;
+    }
+  }
+
+  void BackgroundMaintenance::Compact(Store& store)
+  {
+    if (store.GetFreePageRatio() <= m_Policy.FreePageRatio)
+    {
+      return;
+    }
+
+    const Store::Integer pagesPerStep = max<Store::Integer>(m_Policy.MaxPagesPerStep, 1);
+
+    // free all free pages in small steps, each in its own transaction, so other writers are only blocked for a short time
+    for (;;)
+    {
+      if (StopRequested())
+      {
+        return;
+      }
+
+      Store::Integer freed = store.Compact(pagesPerStep);
+
+      m_CompactedPages += freed;
+
+      if (freed < pagesPerStep)
+      {
+        return;
+      }
+    }
+  }
+}
@@ -0,0 +1,86 @@
+// Copyright (c) 2014 by Bertolt Mildner
+// All rights reserved.
+
+#ifndef CONFIGURATION_MAINTENANCE_H
+#define CONFIGURATION_MAINTENANCE_H
+
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include <boost\noncopyable.hpp>
+
+#include "Configuration.h"
+
+namespace Configuration
+{
+  struct MaintenancePolicy
+  {
+    MaintenancePolicy();
+
+    // compaction starts as soon as the ratio of free pages to all pages exceeds this value
+    // default: 0.25
+    double FreePageRatio;
+
+    // max. number of pages freed per compaction step, each step uses its own (short) write transaction
+    // default: 256
+    Store::Integer MaxPagesPerStep;
+
+    // time between two checks of the store
+    // default: 60 sec
+    std::chrono::milliseconds Interval;
+
+    // time between two runs of Store::Optimize(), 0 == never
+    // default: 1 h
+    std::chrono::milliseconds OptimizeInterval;
+  };
+
+  // runs maintenance (compaction, optimization) of a store on a separate thread, using its own Store object and so its own database connection
+  // private in-memory stores can not be opened a second time and so can not be maintained in the background
+  class BackgroundMaintenance : private boost::noncopyable
+  {
+    public:
+      explicit BackgroundMaintenance(const std::wstring& fileName, const MaintenancePolicy& policy = MaintenancePolicy());
+
+      // stops the maintenance thread, waits for a running step to finish
+      ~BackgroundMaintenance() noexcept;
+
+      // number of pages freed so far
+      Store::Integer GetCompactedPages() const noexcept;
+
+      // number of Store::Optimize() runs so far
+      Store::Integer GetOptimizeRuns() const noexcept;
+
+      // number of failed maintenance runs (e.g. store was busy for too long), failed runs are retried after the next interval
+      Store::Integer GetFailedRuns() const noexcept;
+
+    private:
+      void Run() noexcept;
+      void RunOnce(Store& store);
+      void Compact(Store& store);
+
+      bool StopRequested();
+
+      const std::wstring      m_FileName;
+      const MaintenancePolicy m_Policy;
+
+      std::atomic<Store::Integer> m_CompactedPages;
+      std::atomic<Store::Integer> m_OptimizeRuns;
+      std::atomic<Store::Integer> m_FailedRuns;
+
+      std::mutex              m_Mutex;
+      std::condition_variable m_Condition;
+      bool                    m_Stop;
+
+      std::chrono::steady_clock::time_point m_LastOptimize;
+
+      std::thread m_Thread;
+  };
+}
+
+#endif
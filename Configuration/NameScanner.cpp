@@ -0,0 +1,260 @@
+// Copyright (c) 2014 by Bertolt Mildner
+// All rights reserved.
+
+#include "NameScanner.h"
+
+#include <cassert>
+#include <cstdint>
+#include <string>
+
+#include "Utils.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define CONFIGURATION_NAMESCANNER_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define CONFIGURATION_NAMESCANNER_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+  using Configuration::Detail::DelimiterPositions;
+
+  inline unsigned int CountTrailingZeros(uint32_t mask)
+  {
+    assert(mask != 0);
+
+#if defined(_MSC_VER)
+    unsigned long index;
+
+    _BitScanForward(&index, mask);
+
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+  }
+
+  // checks each delimiter found against the rules of valid names
+  template <typename Char>
+  class Validator
+  {
+    public:
+      Validator(const Char* name, size_t size, const Char* delimiter, size_t delimiterSize, DelimiterPositions* delimiters)
+      : m_Name(name), m_Size(size), m_Delimiter(delimiter), m_DelimiterSize(delimiterSize), m_Delimiters(delimiters), m_SegmentStart(0)
+      {
+        if (m_Delimiters != nullptr)
+        {
+          m_Delimiters->clear();
+        }
+      }
+
+      // pos is a match of the first unit of the delimiter, returns false if the name is invalid
+      bool Found(size_t pos)
+      {
+        // a multi-byte UTF-8 delimiter has to match completely, its first byte never occurs within another character
+        for (size_t i = 1; i < m_DelimiterSize; i++)
+        {
+          if (((pos + i) >= m_Size) || (m_Name[pos + i] != m_Delimiter[i]))
+          {
+            return true;
+          }
+        }
+
+        // leading or consecutive delimiters -> empty segment
+        if (pos == m_SegmentStart)
+        {
+          return false;
+        }
+
+        if (m_Delimiters != nullptr)
+        {
+          m_Delimiters->push_back(pos);
+        }
+
+        m_SegmentStart = pos + m_DelimiterSize;
+
+        return true;
+      }
+
+      // trailing delimiter or empty name -> empty segment
+      bool Finish() const
+      {
+        return m_SegmentStart != m_Size;
+      }
+
+    private:
+      const Char*         m_Name;
+      size_t              m_Size;
+      const Char*         m_Delimiter;
+      size_t              m_DelimiterSize;
+      DelimiterPositions* m_Delimiters;
+      size_t              m_SegmentStart;
+  };
+
+  template <typename Char>
+  bool ScanScalar(const Char* name, size_t first, size_t size, Char delimiter, Validator<Char>& validator)
+  {
+    for (size_t i = first; i < size; i++)
+    {
+      if ((name[i] == delimiter) && !validator.Found(i))
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  // calls validator for each bit set in mask, each element of Char covers sizeof(Char) bits
+  template <typename Char>
+  inline bool ReportMatches(uint32_t mask, size_t offset, Validator<Char>& validator)
+  {
+    static const uint32_t ElementMask = (1u << sizeof(Char)) - 1;
+
+    while (mask != 0)
+    {
+      unsigned int bit = CountTrailingZeros(mask);
+
+      if (!validator.Found(offset + (bit / sizeof(Char))))
+      {
+        return false;
+      }
+
+      mask &= ~(ElementMask << bit);
+    }
+
+    return true;
+  }
+
+#ifdef CONFIGURATION_NAMESCANNER_SSE2
+  template <size_t Size> struct Sse2;
+
+  template <> struct Sse2<1>
+  {
+    static __m128i Set(uint32_t value)                { return _mm_set1_epi8(static_cast<char>(value)); }
+    static __m128i Equal(__m128i lhs, __m128i rhs)   { return _mm_cmpeq_epi8(lhs, rhs); }
+  };
+
+  template <> struct Sse2<2>
+  {
+    static __m128i Set(uint32_t value)                { return _mm_set1_epi16(static_cast<short>(value)); }
+    static __m128i Equal(__m128i lhs, __m128i rhs)   { return _mm_cmpeq_epi16(lhs, rhs); }
+  };
+
+  template <> struct Sse2<4>
+  {
+    static __m128i Set(uint32_t value)                { return _mm_set1_epi32(static_cast<int>(value)); }
+    static __m128i Equal(__m128i lhs, __m128i rhs)   { return _mm_cmpeq_epi32(lhs, rhs); }
+  };
+#endif
+
+#ifdef CONFIGURATION_NAMESCANNER_AVX2
+  template <size_t Size> struct Avx2;
+
+  template <> struct Avx2<1>
+  {
+    static __m256i Set(uint32_t value)                { return _mm256_set1_epi8(static_cast<char>(value)); }
+    static __m256i Equal(__m256i lhs, __m256i rhs)   { return _mm256_cmpeq_epi8(lhs, rhs); }
+  };
+
+  template <> struct Avx2<2>
+  {
+    static __m256i Set(uint32_t value)                { return _mm256_set1_epi16(static_cast<short>(value)); }
+    static __m256i Equal(__m256i lhs, __m256i rhs)   { return _mm256_cmpeq_epi16(lhs, rhs); }
+  };
+
+  template <> struct Avx2<4>
+  {
+    static __m256i Set(uint32_t value)                { return _mm256_set1_epi32(static_cast<int>(value)); }
+    static __m256i Equal(__m256i lhs, __m256i rhs)   { return _mm256_cmpeq_epi32(lhs, rhs); }
+  };
+#endif
+
+  template <typename Char>
+  bool Scan(const Char* name, size_t size, Char delimiter, Validator<Char>& validator)
+  {
+    size_t i = 0;
+
+    // unaligned loads, names are short and not aligned anyway
+#ifdef CONFIGURATION_NAMESCANNER_AVX2
+    {
+      static const size_t Step = sizeof(__m256i) / sizeof(Char);
+
+      const __m256i pattern = Avx2<sizeof(Char)>::Set(static_cast<uint32_t>(delimiter));
+
+      for (; (i + Step) <= size; i += Step)
+      {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(name + i));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(Avx2<sizeof(Char)>::Equal(block, pattern)));
+
+        if ((mask != 0) && !ReportMatches(mask, i, validator))
+        {
+          return false;
+        }
+      }
+    }
+#endif
+
+#ifdef CONFIGURATION_NAMESCANNER_SSE2
+    {
+      static const size_t Step = sizeof(__m128i) / sizeof(Char);
+
+      const __m128i pattern = Sse2<sizeof(Char)>::Set(static_cast<uint32_t>(delimiter));
+
+      for (; (i + Step) <= size; i += Step)
+      {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(name + i));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(Sse2<sizeof(Char)>::Equal(block, pattern)));
+
+        if ((mask != 0) && !ReportMatches(mask, i, validator))
+        {
+          return false;
+        }
+      }
+    }
+#endif
+
+    return ScanScalar(name, i, size, delimiter, validator) && validator.Finish();
+  }
+}
+
+namespace Configuration
+{
+  namespace Detail
+  {
+    bool ScanName(const wchar_t* name, size_t size, wchar_t delimiter, DelimiterPositions* delimiters)
+    {
+      Validator<wchar_t> validator(name, size, &delimiter, 1, delimiters);
+
+      return Scan(name, size, delimiter, validator);
+    }
+
+    bool ScanName(const char* name, size_t size, wchar_t delimiter, DelimiterPositions* delimiters)
+    {
+      // delimiters are almost always ASCII
+      char   ascii = static_cast<char>(delimiter);
+      string encoded = (static_cast<uint32_t>(delimiter) < 0x80) ? string(1, ascii) : WcharToUTF8(wstring(1, delimiter));
+
+      Validator<char> validator(name, size, encoded.data(), encoded.size(), delimiters);
+
+      return Scan(name, size, encoded[0], validator);
+    }
+
+    bool ScanNameScalar(const wchar_t* name, size_t size, wchar_t delimiter, DelimiterPositions* delimiters)
+    {
+      Validator<wchar_t> validator(name, size, &delimiter, 1, delimiters);
+
+      return ScanScalar(name, 0, size, delimiter, validator) && validator.Finish();
+    }
+  }
+}
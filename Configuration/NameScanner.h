@@ -0,0 +1,32 @@
+// Copyright (c) 2014 by Bertolt Mildner
+// All rights reserved.
+
+#ifndef CONFIGURATION_NAMESCANNER_H
+#define CONFIGURATION_NAMESCANNER_H
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace Configuration
+{
+  namespace Detail
+  {
+    // positions of the delimiters found in a name, the segments of the name are the ranges between them
+    using DelimiterPositions = std::vector<std::size_t>;
+
+    // validates name in a single pass (same rules as Store::IsValidName()) and, if delimiters != nullptr, records the
+    // positions of all delimiters found, delimiters is undefined if false is returned
+    // uses SSE2 (AVX2 if enabled at compile time) to search for the delimiter
+    bool ScanName(const wchar_t* name, std::size_t size, wchar_t delimiter, DelimiterPositions* delimiters = nullptr);
+
+    // same for UTF-8 encoded names, positions are byte offsets of the first byte of the (possibly multi-byte) delimiter
+    bool ScanName(const char* name, std::size_t size, wchar_t delimiter, DelimiterPositions* delimiters = nullptr);
+
+    // reference implementation without SIMD, used for the tail of a name and on other platforms
+    bool ScanNameScalar(const wchar_t* name, std::size_t size, wchar_t delimiter, DelimiterPositions* delimiters = nullptr);
+  }
+}
+
+#endif
@@ -0,0 +1,108 @@
+// Copyright (c) 2014 by Bertolt Mildner
+// All rights reserved.
+
+#ifndef CONFIGURATION_PARALLEL_H
+#define CONFIGURATION_PARALLEL_H
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <thread>
+#include <exception>
+#include <algorithm>
+
+namespace Configuration
+{
+  namespace Detail
+  {
+    // number of threads to use, threads == 0 -> one per core
+    inline std::size_t GetThreadCount(std::size_t threads)
+    {
+      return (threads != 0) ? threads : std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    }
+
+    // runs func(0) ... func(count - 1) each on its own thread, func(0) on the calling thread
+    // waits for all of them, afterwards the exception of the lowest index that failed (if any) is rethrown
+    template <typename Func>
+    void RunParallel(std::size_t count, const Func& func)
+    {
+      std::vector<std::exception_ptr> errors(count);
+      std::vector<std::thread>        threads;
+
+      auto run = [&func, &errors](std::size_t index)
+      {
+        try
+        {
+          func(index);
+        }
+        catch (...)
+        {
+          errors[index] = std::current_exception();
+        }
+      };
+
+      threads.reserve((count > 0) ? (count - 1) : 0);
+
+      try
+      {
+        for (std::size_t i = 1; i < count; i++)
+        {
+          threads.emplace_back(run, i);
+        }
+      }
+      catch (...)
+      {
+        // failed to start a thread, the running ones still reference our locals
+        for (auto& thread : threads)
+        {
+          thread.join();
+        }
+
+        throw;
+      }
+
+      if (count > 0)
+      {
+        run(0);
+      }
+
+      for (auto& thread : threads)
+      {
+        thread.join();
+      }
+
+      for (const auto& error : errors)
+      {
+        if (error)
+        {
+          std::rethrow_exception(error);
+        }
+      }
+    }
+
+    // takes locks 0 ... count - 1 by calling lock(index, wait), which returns false if the lock is not available right away
+    // only lock 0 is waited for: a writer that has been waiting for the locks already taken blocks all further ones, waiting
+    // for them would deadlock, so all locks taken so far are released by unlock(index) and we start over
+    template <typename Lock, typename Unlock>
+    void LockAll(std::size_t count, const Lock& lock, const Unlock& unlock)
+    {
+      for (std::size_t locked = 0; locked < count; )
+      {
+        if (lock(locked, locked == 0))
+        {
+          locked++;
+        }
+        else
+        {
+          while (locked > 0)
+          {
+            unlock(--locked);
+          }
+        }
+      }
+    }
+  }
+}
+
+#endif
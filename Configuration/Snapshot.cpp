@@ -0,0 +1,809 @@
+// Copyright (c) 2014 by Bertolt Mildner
+// All rights reserved.
+
+#include "Snapshot.h"
+
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "Utils.h"
+
+CONFIGURATION_BOOST_INCL_GUARD_BEGIN
+#include <boost/format.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/exceptions.hpp>
+CONFIGURATION_BOOST_INCL_GUARD_END
+
+using namespace std;
+
+namespace
+{
+  const string SharedMemoryKind = "Snapshot";
+
+  // has to change with the layout of the segment
+  const uint32_t SegmentMagic = 0x434E5302;
+
+  // buffers start at a cache line
+  const size_t HeaderAlignment = 64;
+
+  const int64_t NeverExpires = numeric_limits<int64_t>::max();
+
+  // a reader overtaken this often by the publisher asks its Store object instead
+  const size_t MaxReadAttempts = 64;
+
+  // longest a reader serves a snapshot the publisher has not confirmed to be current
+  const chrono::milliseconds MaxConfirmationAge(2000);
+
+  int64_t ToMilliseconds(const Configuration::Store::TimePoint& time)
+  {
+    return chrono::duration_cast<chrono::milliseconds>(time.time_since_epoch()).count();
+  }
+}
+
+namespace Configuration
+{
+  namespace Detail
+  {
+    // entries in breadth-first order, the children of an entry are stored one after the other sorted by their UTF-8 names
+    // offsets refer to the strings following the entries
+    struct SnapshotNode
+    {
+      int64_t  IntegerValue;
+      int64_t  Expires;     // ms since epoch of std::chrono::system_clock, NeverExpires if it does not expire
+      uint32_t Name;
+      uint32_t NameSize;
+      uint32_t Value;       // UTF-8 strings and binaries
+      uint32_t ValueSize;
+      uint32_t FirstChild;
+      uint32_t Children;
+      uint32_t Type;        // Store::ValueType, 0 for the root entry
+      uint32_t Reserved;
+    };
+
+    struct SnapshotBuffer
+    {
+      atomic<uint64_t> Version;  // odd while being written, 0 if never written
+
+      ChangeSignal::Sequence Sequence;  // of the change signal before the snapshot has been taken
+      Store::Revision        Root;
+      uint64_t               Nodes;
+      uint64_t               Size;      // bytes of entries and strings
+      uint32_t               Delimiter;
+    };
+
+    struct SnapshotHeader
+    {
+      atomic<uint32_t> Magic;   // set once the header has been initialized
+      atomic<uint32_t> Active;  // buffer readers read from
+      atomic<int64_t>  Confirmed;  // ms since epoch of std::chrono::system_clock the publisher found the store unchanged
+      uint64_t         Capacity;
+
+      SnapshotBuffer Buffers[2];
+    };
+
+    const size_t SnapshotHeaderSize = ((sizeof(SnapshotHeader) + HeaderAlignment - 1) / HeaderAlignment) * HeaderAlignment;
+
+    struct SnapshotSegment
+    {
+      // opens or creates the segment for publishing
+      SnapshotSegment(const string& name, size_t capacity)
+      : Memory(boost::interprocess::open_or_create, name.c_str(), boost::interprocess::read_write), Region(), Header(nullptr)
+      {
+        boost::interprocess::offset_t size = 0;
+
+        if (!Memory.get_size(size) || (size == 0))
+        {
+          Memory.truncate(static_cast<boost::interprocess::offset_t>(SnapshotHeaderSize + 2 * capacity));
+        }
+
+        Region = boost::interprocess::mapped_region(Memory, boost::interprocess::read_write);
+        Header = static_cast<SnapshotHeader*>(Region.get_address());
+
+        // new segments are filled with zeros, others may have been left behind by an older layout
+        if (Header->Magic.load() != SegmentMagic)
+        {
+          Header->Active = 0;
+          Header->Confirmed = 0;
+          Header->Capacity = (Region.get_size() - SnapshotHeaderSize) / 2;
+          Header->Buffers[0].Version = 0;
+          Header->Buffers[1].Version = 0;
+
+          Header->Magic.store(SegmentMagic, memory_order_release);
+        }
+      }
+
+      // opens an existing segment for reading, throws boost::interprocess::interprocess_exception if there is none
+      explicit SnapshotSegment(const string& name)
+      : Memory(boost::interprocess::open_only, name.c_str(), boost::interprocess::read_only),
+        Region(Memory, boost::interprocess::read_only), Header(static_cast<SnapshotHeader*>(Region.get_address()))
+      {
+      }
+
+      bool IsValid() const
+      {
+        return (Region.get_size() >= SnapshotHeaderSize) && (Header->Magic.load(memory_order_acquire) == SegmentMagic) &&
+               (Header->Capacity <= ((Region.get_size() - SnapshotHeaderSize) / 2));
+      }
+
+      char* GetData(uint32_t buffer) const
+      {
+        return static_cast<char*>(Region.get_address()) + SnapshotHeaderSize + buffer * Header->Capacity;
+      }
+
+      // writes the parts of a snapshot one after the other into the buffer readers do not read from and makes it the active one
+      // readers may still read from it as it has been the active one before, they see the version change and retry
+      // only called by the publisher, parts may be the content of the active buffer
+      void Write(const vector<pair<const char*, size_t>>& parts, ChangeSignal::Sequence sequence, const Store::Revision& root, uint64_t nodes,
+                 uint32_t delimiter)
+      {
+        auto next    = (Header->Active.load() + 1) & 1;
+        auto& buffer = Header->Buffers[next];
+        auto version = buffer.Version.load(memory_order_relaxed);
+        auto data    = GetData(next);
+
+        buffer.Version.store(version + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+
+        uint64_t size = 0;
+
+        for (const auto& part : parts)
+        {
+          memcpy(data + size, part.first, part.second);
+          size += part.second;
+        }
+
+        buffer.Sequence  = sequence;
+        buffer.Root      = root;
+        buffer.Nodes     = nodes;
+        buffer.Size      = size;
+        buffer.Delimiter = delimiter;
+
+        buffer.Version.store(version + 2, memory_order_release);
+        Header->Active.store(next, memory_order_release);
+      }
+
+      boost::interprocess::shared_memory_object Memory;
+      boost::interprocess::mapped_region        Region;
+      SnapshotHeader*                           Header;
+    };
+
+    // lookups within a buffer that may get overwritten meanwhile, every offset is checked before it is used and nodes are
+    // copied before they are checked, results are only valid if the version of the buffer is unchanged afterwards
+    class SnapshotView
+    {
+      public:
+        SnapshotView(const SnapshotBuffer& buffer, const char* data, uint64_t capacity, int64_t now)
+        : m_Data(data), m_Nodes(buffer.Nodes), m_Size(buffer.Size), m_Strings(0), m_Sequence(buffer.Sequence),
+          m_Delimiter(static_cast<Store::String::value_type>(buffer.Delimiter)), m_Utf8Delimiter(), m_Now(now), m_Valid(false)
+        {
+          m_Valid = (m_Nodes > 0) && (m_Size <= capacity) && (m_Nodes <= (m_Size / sizeof(SnapshotNode)));
+
+          if (m_Valid)
+          {
+            m_Strings = m_Nodes * sizeof(SnapshotNode);
+            m_Utf8Delimiter = WcharToUTF8(Store::String(1, m_Delimiter));
+          }
+        }
+
+        bool IsValid() const noexcept
+        {
+          return m_Valid;
+        }
+
+        ChangeSignal::Sequence GetSequence() const noexcept
+        {
+          return m_Sequence;
+        }
+
+        bool IsValidName(const Store::String& name) const
+        {
+          return Store::IsValidName(name, m_Delimiter);
+        }
+
+        // empty name == root, returns false if name does not exist or has expired
+        bool Find(const string& name, SnapshotNode& node) const
+        {
+          if (!GetNode(0, node))
+          {
+            return false;
+          }
+
+          for (size_t begin = 0; begin < name.size();)
+          {
+            auto end = min(name.find(m_Utf8Delimiter, begin), name.size());
+
+            auto parent = node;
+
+            if (!FindChild(parent, name.data() + begin, end - begin, node) || (node.Expires <= m_Now))
+            {
+              return false;
+            }
+
+            begin = end + m_Utf8Delimiter.size();
+          }
+
+          return true;
+        }
+
+        // calls func(child) for all children of node that have not expired, stops as soon as func returns false
+        // returns false if node is corrupt
+        template <typename Func>
+        bool ForEachChild(const SnapshotNode& node, const Func& func) const
+        {
+          SnapshotNode child;
+
+          for (uint32_t i = 0; i < node.Children; i++)
+          {
+            if (!GetNode(static_cast<uint64_t>(node.FirstChild) + i, child))
+            {
+              return false;
+            }
+
+            if ((child.Expires > m_Now) && !func(child))
+            {
+              break;
+            }
+          }
+
+          return true;
+        }
+
+        bool GetName(const SnapshotNode& node, string& name) const
+        {
+          return GetString(node.Name, node.NameSize, name);
+        }
+
+        bool GetValue(const SnapshotNode& node, string& value) const
+        {
+          return GetString(node.Value, node.ValueSize, value);
+        }
+
+      private:
+        bool GetNode(uint64_t index, SnapshotNode& node) const
+        {
+          if (index >= m_Nodes)
+          {
+            return false;
+          }
+
+          memcpy(&node, m_Data + index * sizeof(SnapshotNode), sizeof(SnapshotNode));
+
+          return true;
+        }
+
+        bool IsInStrings(uint64_t offset, uint64_t size) const
+        {
+          return (offset <= (m_Size - m_Strings)) && (size <= (m_Size - m_Strings - offset));
+        }
+
+        bool GetString(uint32_t offset, uint32_t size, string& value) const
+        {
+          if (!IsInStrings(offset, size))
+          {
+            return false;
+          }
+
+          value.assign(m_Data + m_Strings + offset, size);
+
+          return true;
+        }
+
+        // binary search within the children of parent
+        bool FindChild(const SnapshotNode& parent, const char* name, size_t size, SnapshotNode& child) const
+        {
+          uint64_t first = parent.FirstChild;
+          uint64_t last  = first + parent.Children;
+
+          while (first < last)
+          {
+            auto middle = first + (last - first) / 2;
+
+            if (!GetNode(middle, child) || !IsInStrings(child.Name, child.NameSize))
+            {
+              return false;
+            }
+
+            auto result = memcmp(m_Data + m_Strings + child.Name, name, min<size_t>(child.NameSize, size));
+
+            if (result == 0)
+            {
+              if (child.NameSize == size)
+              {
+                return true;
+              }
+
+              result = (child.NameSize < size) ? -1 : 1;
+            }
+
+            if (result < 0)
+            {
+              first = middle + 1;
+            }
+            else
+            {
+              last = middle;
+            }
+          }
+
+          return false;
+        }
+
+        const char* m_Data;
+        uint64_t    m_Nodes;
+        uint64_t    m_Size;
+        uint64_t    m_Strings;  // offset of the strings
+
+        ChangeSignal::Sequence m_Sequence;
+
+        Store::String::value_type m_Delimiter;
+        string                    m_Utf8Delimiter;
+
+        int64_t m_Now;
+        bool    m_Valid;
+    };
+
+    void CollectEntries(const Store& store, vector<SnapshotNode>& nodes, string& strings)
+    {
+      // full names of the entries in nodes
+      vector<Store::String> names(1);
+
+      SnapshotNode root = {};
+
+      root.Expires = NeverExpires;
+      nodes.push_back(root);
+
+      for (size_t i = 0; i < nodes.size(); i++)
+      {
+        vector<pair<string, Store::String>> children;
+
+        for (auto& child : store.GetChildren(names[i]))
+        {
+          children.emplace_back(WcharToUTF8(child), move(child));
+        }
+
+        sort(begin(children), end(children));
+
+        nodes[i].FirstChild = static_cast<uint32_t>(nodes.size());
+        nodes[i].Children   = static_cast<uint32_t>(children.size());
+
+        for (const auto& child : children)
+        {
+          auto name = names[i].empty() ? child.second : (names[i] + store.GetNameDelimiter() + child.second);
+          auto type = store.GetType(name);
+
+          SnapshotNode node = {};
+
+          node.Name     = static_cast<uint32_t>(strings.size());
+          node.NameSize = static_cast<uint32_t>(child.first.size());
+          node.Type     = static_cast<uint32_t>(type);
+
+          strings += child.first;
+
+          switch (type)
+          {
+            case Store::ValueType::Integer:
+              node.IntegerValue = store.GetInteger(name);
+              break;
+
+            case Store::ValueType::String:
+            {
+              auto value = WcharToUTF8(store.GetString(name));
+
+              node.Value     = static_cast<uint32_t>(strings.size());
+              node.ValueSize = static_cast<uint32_t>(value.size());
+
+              strings += value;
+              break;
+            }
+
+            case Store::ValueType::Binary:
+            {
+              auto value = store.GetBinary(name);
+
+              node.Value     = static_cast<uint32_t>(strings.size());
+              node.ValueSize = static_cast<uint32_t>(value.size());
+
+              strings.append(value.begin(), value.end());
+              break;
+            }
+          }
+
+          Store::TimePoint expires;
+
+          node.Expires = store.GetExpiry(name, expires) ? ToMilliseconds(expires) : NeverExpires;
+
+          nodes.push_back(node);
+          names.push_back(move(name));
+        }
+      }
+    }
+  }
+
+  const size_t SnapshotPublisher::DefaultCapacity = 64 * 1024 * 1024;
+
+  SnapshotPublisher::SnapshotPublisher(const Store& store, size_t capacity)
+  : m_Store(store), m_Signal(store.GetFileName()), m_Segment(), m_Published(false), m_Revision(), m_Sequence(0)
+  {
+    // offsets within a buffer are 32 bit wide
+    if ((capacity == 0) || (static_cast<uint64_t>(capacity) > numeric_limits<uint32_t>::max()))
+    {
+      throw ExceptionImpl<ValueOutOfRange>((boost::wformat(L"Invalid snapshot capacity (%1%)") % capacity).str());
+    }
+
+    m_Segment = make_unique<Detail::SnapshotSegment>(Detail::GetSharedMemoryName(SharedMemoryKind, store.GetFileName()), capacity);
+  }
+
+  SnapshotPublisher::~SnapshotPublisher() noexcept
+  {
+  }
+
+  bool SnapshotPublisher::Publish()
+  {
+    auto& header = *m_Segment->Header;
+
+    // changes signalled from now on make the snapshot stale, even if it turns out to contain them
+    auto sequence = m_Signal.GetSequence();
+    // commits from now on are not part of it, whether they are signalled or not
+    auto confirmed = ToMilliseconds(chrono::system_clock::now());
+
+    vector<Detail::SnapshotNode> nodes;
+    string                       strings;
+    Store::Revision              root;
+
+    {
+      ReadOnlyTransaction transaction(m_Store);
+
+      root = m_Store.GetRevision();
+
+      if (m_Published && (root == m_Revision))
+      {
+        // nothing changed, but readers have seen the signal, the snapshot is copied over with the new sequence
+        // readers may be reading from the active buffer, it is never written in place
+        if (sequence != m_Sequence)
+        {
+          auto  active  = header.Active.load() & 1;
+          auto& current = header.Buffers[active];
+
+          m_Segment->Write({ make_pair(m_Segment->GetData(active), static_cast<size_t>(current.Size)) }, sequence, current.Root, current.Nodes,
+                           current.Delimiter);
+
+          m_Sequence = sequence;
+        }
+
+        header.Confirmed.store(confirmed, memory_order_release);
+
+        return false;
+      }
+
+      Detail::CollectEntries(m_Store, nodes, strings);
+    }
+
+    auto entries = nodes.size() * sizeof(Detail::SnapshotNode);
+
+    if ((entries + strings.size()) > header.Capacity)
+    {
+      throw ExceptionImpl<ValueOutOfRange>((boost::wformat(L"Snapshot of %1% bytes exceeds capacity of %2% bytes") % (entries + strings.size()) %
+                                                                                                                    header.Capacity).str());
+    }
+
+    m_Segment->Write({ make_pair(reinterpret_cast<const char*>(nodes.data()), entries), make_pair(strings.data(), strings.size()) }, sequence, root,
+                     nodes.size(), static_cast<uint32_t>(m_Store.GetNameDelimiter()));
+
+    header.Confirmed.store(confirmed, memory_order_release);
+
+    m_Published = true;
+    m_Revision  = root;
+    m_Sequence  = sequence;
+
+    return true;
+  }
+
+  bool SnapshotPublisher::WaitAndPublish(chrono::milliseconds timeout)
+  {
+    // changes of writers that do not signal them are published once the timeout has elapsed
+    if (m_Published)
+    {
+      auto sequence = m_Sequence;
+
+      m_Signal.Wait(sequence, timeout);
+    }
+
+    return Publish();
+  }
+
+  Store::Revision SnapshotPublisher::GetPublishedRevision() const noexcept
+  {
+    return m_Revision;
+  }
+
+  void SnapshotPublisher::Remove(const wstring& fileName)
+  {
+    boost::interprocess::shared_memory_object::remove(Detail::GetSharedMemoryName(SharedMemoryKind, fileName).c_str());
+  }
+
+  SnapshotReader::SnapshotReader(const wstring& fileName, const Store::Options& options)
+  : m_FileName(fileName), m_Options(options), m_Signal(fileName), m_Segment(), m_NextOpen(), m_Store()
+  {
+  }
+
+  SnapshotReader::~SnapshotReader() noexcept
+  {
+  }
+
+  template <typename Lookup>
+  bool SnapshotReader::Read(const Lookup& lookup) const
+  {
+    if (!OpenSegment())
+    {
+      return false;
+    }
+
+    const auto& header = *m_Segment->Header;
+
+    // lock-free, see ChangeSignal
+    auto sequence = m_Signal.GetSequence();
+    auto now      = ToMilliseconds(chrono::system_clock::now());
+    auto stale    = false;
+    auto found    = false;
+
+    for (size_t attempt = 0;; attempt++)
+    {
+      if (attempt == MaxReadAttempts)
+      {
+        return false;
+      }
+
+      auto active  = header.Active.load(memory_order_acquire) & 1;
+      auto& buffer = header.Buffers[active];
+      auto version = buffer.Version.load(memory_order_acquire);
+
+      if (version == 0)
+      {
+        // nothing published yet
+        stale = true;
+        break;
+      }
+
+      if ((version & 1) == 0)
+      {
+        Detail::SnapshotView view(buffer, m_Segment->GetData(active), header.Capacity, now);
+
+        // commits of Store objects without Options::SignalChanges do not move the signal, only the publisher sees them
+        stale = (view.GetSequence() != sequence) || (header.Confirmed.load(memory_order_acquire) < (now - MaxConfirmationAge.count()));
+        found = !stale && view.IsValid() && lookup(view);
+
+        atomic_thread_fence(memory_order_acquire);
+
+        if (buffer.Version.load(memory_order_relaxed) == version)
+        {
+          break;
+        }
+      }
+
+      this_thread::yield();
+    }
+
+    // the publisher may have been replaced by one using a new segment (see SnapshotPublisher::Remove()) or have gone away
+    if (stale && (chrono::steady_clock::now() >= m_NextOpen))
+    {
+      m_Segment.reset();
+    }
+
+    return found;
+  }
+
+  bool SnapshotReader::IsCurrent() const
+  {
+    return Read([](const Detail::SnapshotView&) { return true; });
+  }
+
+  bool SnapshotReader::Exists(const Store::String& name) const
+  {
+    auto utf8Name = WcharToUTF8(name);
+    auto exists   = false;
+
+    auto lookup = [&](const Detail::SnapshotView& view)
+    {
+      Detail::SnapshotNode node;
+
+      if (!view.IsValidName(name))
+      {
+        return false;
+      }
+
+      exists = view.Find(utf8Name, node);
+
+      return true;
+    };
+
+    return Read(lookup) ? exists : GetStore().Exists(name);
+  }
+
+  Store::ValueType SnapshotReader::GetType(const Store::String& name) const
+  {
+    auto utf8Name = WcharToUTF8(name);
+    auto type     = Store::ValueType::Integer;
+
+    auto lookup = [&](const Detail::SnapshotView& view)
+    {
+      Detail::SnapshotNode node;
+
+      if (!view.IsValidName(name) || !view.Find(utf8Name, node))
+      {
+        return false;
+      }
+
+      type = static_cast<Store::ValueType>(node.Type);
+
+      return true;
+    };
+
+    return Read(lookup) ? type : GetStore().GetType(name);
+  }
+
+  Store::String SnapshotReader::GetString(const Store::String& name) const
+  {
+    auto   utf8Name = WcharToUTF8(name);
+    string value;
+
+    auto lookup = [&](const Detail::SnapshotView& view)
+    {
+      Detail::SnapshotNode node;
+
+      return view.IsValidName(name) && view.Find(utf8Name, node) && (node.Type == static_cast<uint32_t>(Store::ValueType::String)) &&
+             view.GetValue(node, value);
+    };
+
+    return Read(lookup) ? UTF8ToWchar(value) : GetStore().GetString(name);
+  }
+
+  Store::Integer SnapshotReader::GetInteger(const Store::String& name) const
+  {
+    auto           utf8Name = WcharToUTF8(name);
+    Store::Integer value    = 0;
+
+    auto lookup = [&](const Detail::SnapshotView& view)
+    {
+      Detail::SnapshotNode node;
+
+      if (!view.IsValidName(name) || !view.Find(utf8Name, node) || (node.Type != static_cast<uint32_t>(Store::ValueType::Integer)))
+      {
+        return false;
+      }
+
+      value = node.IntegerValue;
+
+      return true;
+    };
+
+    return Read(lookup) ? value : GetStore().GetInteger(name);
+  }
+
+  Store::Binary SnapshotReader::GetBinary(const Store::String& name) const
+  {
+    auto   utf8Name = WcharToUTF8(name);
+    string value;
+
+    auto lookup = [&](const Detail::SnapshotView& view)
+    {
+      Detail::SnapshotNode node;
+
+      return view.IsValidName(name) && view.Find(utf8Name, node) && (node.Type == static_cast<uint32_t>(Store::ValueType::Binary)) &&
+             view.GetValue(node, value);
+    };
+
+    return Read(lookup) ? Store::Binary(value.begin(), value.end()) : GetStore().GetBinary(name);
+  }
+
+  bool SnapshotReader::HasChild(const Store::String& name) const
+  {
+    auto utf8Name = WcharToUTF8(name);
+    auto hasChild = false;
+
+    auto lookup = [&](const Detail::SnapshotView& view)
+    {
+      Detail::SnapshotNode node;
+
+      hasChild = false;
+
+      return (name.empty() || view.IsValidName(name)) && view.Find(utf8Name, node) &&
+             view.ForEachChild(node, [&](const Detail::SnapshotNode&) { hasChild = true; return false; });
+    };
+
+    return Read(lookup) ? hasChild : GetStore().HasChild(name);
+  }
+
+  Store::Children SnapshotReader::GetChildren(const Store::String& name) const
+  {
+    auto           utf8Name = WcharToUTF8(name);
+    vector<string> names;
+
+    auto lookup = [&](const Detail::SnapshotView& view)
+    {
+      Detail::SnapshotNode node;
+      string               child;
+
+      names.clear();
+
+      auto collect = [&](const Detail::SnapshotNode& childNode)
+      {
+        if (!view.GetName(childNode, child))
+        {
+          return false;
+        }
+
+        names.push_back(child);
+
+        return true;
+      };
+
+      return (name.empty() || view.IsValidName(name)) && view.Find(utf8Name, node) && view.ForEachChild(node, collect);
+    };
+
+    if (!Read(lookup))
+    {
+      return GetStore().GetChildren(name);
+    }
+
+    Store::Children children;
+
+    children.reserve(names.size());
+
+    for (const auto& child : names)
+    {
+      children.push_back(UTF8ToWchar(child));
+    }
+
+    return children;
+  }
+
+  bool SnapshotReader::OpenSegment() const
+  {
+    if (m_Segment)
+    {
+      return true;
+    }
+
+    auto now = chrono::steady_clock::now();
+
+    if (now < m_NextOpen)
+    {
+      return false;
+    }
+
+    m_NextOpen = now + chrono::seconds(1);
+
+    try
+    {
+      auto segment = make_unique<Detail::SnapshotSegment>(Detail::GetSharedMemoryName(SharedMemoryKind, m_FileName));
+
+      if (segment->IsValid())
+      {
+        m_Segment = move(segment);
+      }
+    }
+    catch (const boost::interprocess::interprocess_exception&)
+    {
+      // nothing published yet
+    }
+
+    return static_cast<bool>(m_Segment);
+  }
+
+  Store& SnapshotReader::GetStore() const
+  {
+    if (!m_Store)
+    {
+      m_Store = make_unique<Store>(m_FileName, false, Store::DefaultNameDelimiter, m_Options);
+    }
+
+    return *m_Store;
+  }
+}
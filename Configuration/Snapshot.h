@@ -0,0 +1,127 @@
+// Copyright (c) 2014 by Bertolt Mildner
+// All rights reserved.
+
+#ifndef CONFIGURATION_SNAPSHOT_H
+#define CONFIGURATION_SNAPSHOT_H
+
+#pragma once
+
+#include <string>
+#include <memory>
+#include <cstddef>
+#include <chrono>
+
+#include <boost\noncopyable.hpp>
+
+#include "Configuration.h"
+#include "ChangeSignal.h"
+
+namespace Configuration
+{
+  namespace Detail
+  {
+    struct SnapshotSegment;
+  }
+
+  // published snapshots: one process exports the content of a store into a named shared memory segment belonging to the
+  // store file, any number of processes on the host read it by SnapshotReader without SQLite and without a page cache each
+  // the segment holds two buffers, a new snapshot is written into the one not read from and then made the current one,
+  // readers detect a buffer being overwritten meanwhile by its version and retry a limited number of times
+  // a snapshot is current until the change signal of the store (see ChangeSignal) is bumped, readers fall back to a Store
+  // object of their own while it is stale
+  // commits of Store objects opened without Options::SignalChanges are not signalled: only the publisher sees them, each
+  // Publish() confirms the snapshot to be current (or replaces it), readers fall back once it has not been confirmed for
+  // two seconds, so the publisher has to call Publish() (or WaitAndPublish()) more often than that
+
+  // only one publisher per store at a time, not multi-thread safe (just like Store)
+  class SnapshotPublisher : private boost::noncopyable
+  {
+    public:
+      // default size of each of the two buffers
+      static const std::size_t DefaultCapacity;
+
+      // capacity (max. 4 GB) is only used if the segment gets created, otherwise the capacity of the existing one is used
+      // store must not be a private in-memory store
+      explicit SnapshotPublisher(const Store& store, std::size_t capacity = DefaultCapacity);
+
+      ~SnapshotPublisher() noexcept;
+
+      // publishes the current content of the store unless it has not changed since the last snapshot, which is then
+      // confirmed to be current
+      // throws ValueOutOfRange if the content does not fit into a buffer, readers keep using the previous snapshot until
+      // they see the change signal and fall back to their Store objects
+      // returns false if there was nothing to publish
+      bool Publish();
+
+      // waits up to timeout for a change to be signalled, then Publish() (also if nothing has been signalled)
+      bool WaitAndPublish(std::chrono::milliseconds timeout);
+
+      // revision of the root entry the current snapshot has been taken at
+      Store::Revision GetPublishedRevision() const noexcept;
+
+      // removes the segment of fileName, readers that mapped it keep reading it until they fall back to their Store objects
+      static void Remove(const std::wstring& fileName);
+
+    private:
+      const Store& m_Store;
+
+      ChangeSignal m_Signal;
+
+      std::unique_ptr<Detail::SnapshotSegment> m_Segment;
+
+      bool                   m_Published;
+      Store::Revision        m_Revision;
+      ChangeSignal::Sequence m_Sequence;
+  };
+
+  // read-only access to published snapshots, falls back to a Store object opened on fileName if there is no current snapshot
+  // lookup semantics are the ones of Store incl. the exceptions thrown, errors are reported by the fallback Store object,
+  // entries expired since the snapshot has been taken are treated as not existing
+  // not multi-thread safe (just like Store)
+  class SnapshotReader : private boost::noncopyable
+  {
+    public:
+      // the fallback Store object is only opened once needed, using options
+      explicit SnapshotReader(const std::wstring& fileName, const Store::Options& options = Store::Options());
+
+      ~SnapshotReader() noexcept;
+
+      // true if lookups are served by a snapshot
+      bool IsCurrent() const;
+
+      bool Exists(const Store::String& name) const;
+
+      Store::ValueType GetType(const Store::String& name) const;
+
+      Store::String GetString(const Store::String& name) const;
+      Store::Integer GetInteger(const Store::String& name) const;
+      Store::Binary GetBinary(const Store::String& name) const;
+
+      // empty name == root
+      bool HasChild(const Store::String& name) const;
+      // empty name == root, children ordered by their UTF-8 encoded names
+      Store::Children GetChildren(const Store::String& name) const;
+
+    private:
+      // runs lookup on the current snapshot, returns false if there is none or lookup fails (-> ask the fallback Store object)
+      template <typename Lookup>
+      bool Read(const Lookup& lookup) const;
+
+      // the segment is (re-)opened at most once per second while there is no current snapshot
+      bool OpenSegment() const;
+
+      Store& GetStore() const;
+
+      const std::wstring   m_FileName;
+      const Store::Options m_Options;
+
+      ChangeSignal m_Signal;
+
+      mutable std::unique_ptr<Detail::SnapshotSegment> m_Segment;
+      mutable std::chrono::steady_clock::time_point    m_NextOpen;
+
+      mutable std::unique_ptr<Store> m_Store;
+  };
+}
+
+#endif
@@ -0,0 +1,347 @@
+// Copyright (c) 2014 by Bertolt Mildner
+// All rights reserved.
+
+#include "WriteBatch.h"
+
+#include <cassert>
+#include <algorithm>
+#include <numeric>
+
+#include "SQLiteCpp\SQLiteCpp.h"
+
+#include "NameScanner.h"
+#include "Parallel.h"
+
+using namespace std;
+
+namespace Configuration
+{
+  WriteBatch::WriteBatch(Store& store, size_t threads)
+  : m_Store(store), m_Threads(threads), m_Operations(), m_Parsed(0)
+  {
+  }
+
+  size_t WriteBatch::Add(Type type, const Store::String& name, Store::ValueType valueType, const Store::ValueBinder& bindValue, bool recursive)
+  {
+    Operation operation{type, Store::String(), Segments(), valueType, bindValue, recursive, Result::Pending};
+
+    if (m_Threads != 1)
+    {
+      operation.m_Name = name;  // parsed by Apply()
+    }
+    else if (!ParseName(name, m_Store.GetNameDelimiter(), operation.m_Path))
+    {
+      throw ExceptionImpl<InvalidName>(L"Invalid name: " + name);
+    }
+
+    m_Operations.push_back(move(operation));
+
+    if (m_Threads == 1)
+    {
+      m_Parsed = m_Operations.size();
+    }
+
+    return m_Operations.size() - 1;
+  }
+
+  bool WriteBatch::ParseName(const Store::String& name, Store::String::value_type delimiter, Segments& path)
+  {
+    Detail::DelimiterPositions delimiters;
+
+    if (!Detail::ScanName(name.data(), name.size(), delimiter, &delimiters))
+    {
+      return false;
+    }
+
+    size_t first = 0;
+
+    path.clear();
+    path.reserve(delimiters.size() + 1);
+
+    for (auto pos : delimiters)
+    {
+      path.push_back(WcharToUTF8(name.substr(first, pos - first)));
+      first = pos + 1;
+    }
+
+    path.push_back(WcharToUTF8(name.substr(first)));
+
+    return true;
+  }
+
+  void WriteBatch::ParseNames()
+  {
+    // too little work per thread is not worth starting it
+    static const size_t MinOperationsPerThread = 1024;
+
+    size_t first = m_Parsed;
+    size_t count = m_Operations.size() - first;
+
+    if (count == 0)
+    {
+      return;
+    }
+
+    size_t threads = min(Detail::GetThreadCount(m_Threads), (count + MinOperationsPerThread - 1) / MinOperationsPerThread);
+    auto   delimiter = m_Store.GetNameDelimiter();
+
+    Detail::RunParallel(threads, [&](size_t index)
+    {
+      for (size_t i = first + index; i < m_Operations.size(); i += threads)
+      {
+        auto& operation = m_Operations[i];
+
+        // already parsed by a previous call that failed on another operation
+        if (!operation.m_Path.empty())
+        {
+          continue;
+        }
+
+        if (!ParseName(operation.m_Name, delimiter, operation.m_Path))
+        {
+          throw ExceptionImpl<InvalidName>(L"Invalid name: " + operation.m_Name);
+        }
+
+        Store::String().swap(operation.m_Name);
+      }
+    });
+
+    m_Parsed = m_Operations.size();
+  }
+
+  // values are copied into the binders, the batch does not depend on the lifetime of the arguments
+  size_t WriteBatch::Create(const Store::String& name, const Store::String& value)
+  {
+    return Add(Type::Create, name, Store::ValueType::String, [value](int index, SQLite::Statement& stm) { stm.bind(index, WcharToUTF8(value)); });
+  }
+
+  size_t WriteBatch::Create(const Store::String& name, Store::Integer value)
+  {
+    return Add(Type::Create, name, Store::ValueType::Integer, [value](int index, SQLite::Statement& stm) { stm.bind(index, value); });
+  }
+
+  size_t WriteBatch::Create(const Store::String& name, const Store::Binary& value)
+  {
+    return Add(Type::Create, name, Store::ValueType::Binary, [value](int index, SQLite::Statement& stm) { stm.bind(index, value.data(), value.size()); });
+  }
+
+  size_t WriteBatch::Set(const Store::String& name, const Store::String& value)
+  {
+    return Add(Type::Set, name, Store::ValueType::String, [value](int index, SQLite::Statement& stm) { stm.bind(index, WcharToUTF8(value)); });
+  }
+
+  size_t WriteBatch::Set(const Store::String& name, Store::Integer value)
+  {
+    return Add(Type::Set, name, Store::ValueType::Integer, [value](int index, SQLite::Statement& stm) { stm.bind(index, value); });
+  }
+
+  size_t WriteBatch::Set(const Store::String& name, const Store::Binary& value)
+  {
+    return Add(Type::Set, name, Store::ValueType::Binary, [value](int index, SQLite::Statement& stm) { stm.bind(index, value.data(), value.size()); });
+  }
+
+  size_t WriteBatch::SetOrCreate(const Store::String& name, const Store::String& value)
+  {
+    return Add(Type::SetOrCreate, name, Store::ValueType::String, [value](int index, SQLite::Statement& stm) { stm.bind(index, WcharToUTF8(value)); });
+  }
+
+  size_t WriteBatch::SetOrCreate(const Store::String& name, Store::Integer value)
+  {
+    return Add(Type::SetOrCreate, name, Store::ValueType::Integer, [value](int index, SQLite::Statement& stm) { stm.bind(index, value); });
+  }
+
+  size_t WriteBatch::SetOrCreate(const Store::String& name, const Store::Binary& value)
+  {
+    return Add(Type::SetOrCreate, name, Store::ValueType::Binary, [value](int index, SQLite::Statement& stm) { stm.bind(index, value.data(), value.size()); });
+  }
+
+  size_t WriteBatch::Delete(const Store::String& name, bool recursive)
+  {
+    return Add(Type::Delete, name, Store::DefaultEntryValueType, Store::ValueBinder(), recursive);
+  }
+
+  size_t WriteBatch::Size() const noexcept
+  {
+    return m_Operations.size();
+  }
+
+  bool WriteBatch::Empty() const noexcept
+  {
+    return m_Operations.empty();
+  }
+
+  void WriteBatch::Clear() noexcept
+  {
+    m_Operations.clear();
+    m_Parsed = 0;
+  }
+
+  WriteBatch::Result WriteBatch::GetResult(size_t index) const
+  {
+    return m_Operations.at(index).m_Result;
+  }
+
+  bool WriteBatch::Apply()
+  {
+    for (auto& operation : m_Operations)
+    {
+      operation.m_Result = Result::Pending;
+    }
+
+    try
+    {
+      ParseNames();
+
+      WriteableTransaction transaction(m_Store);
+
+      vector<size_t> order(m_Operations.size());
+
+      iota(begin(order), end(order), 0);
+
+      // stable, keep the order of operations on the same entry
+      stable_sort(begin(order), end(order), [this](size_t lhs, size_t rhs) { return m_Operations[lhs].m_Path < m_Operations[rhs].m_Path; });
+
+      Segments      resolved;  // names of the entries in idPath
+      Store::IdList idPath;
+      Store::IdList touched;
+      bool          succeeded = true;
+
+      for (auto index : order)
+      {
+        auto& operation = m_Operations[index];
+        const auto& path = operation.m_Path;
+
+        // the previous operation already resolved the common prefix
+        size_t common = 0;
+
+        while ((common < resolved.size()) && (common < path.size()) && (resolved[common] == path[common]))
+        {
+          common++;
+        }
+
+        idPath.resize(common);
+
+        // resolve as much as exists from the remaining part of the path
+        while ((idPath.size() < path.size()) && m_Store.GetEntryId(idPath, path[idPath.size()], !idPath.empty() ? idPath.back() : 0))
+        {
+        }
+
+        operation.m_Result = Apply(operation, idPath, touched);
+
+        succeeded &= (operation.m_Result == Result::Succeeded);
+
+        resolved.assign(begin(path), begin(path) + idPath.size());
+      }
+
+      if (!touched.empty())
+      {
+        m_Store.UpdateRevisions(touched);
+      }
+
+      transaction.Commit();
+
+      return succeeded;
+    }
+    catch (...)
+    {
+      for (auto& operation : m_Operations)
+      {
+        operation.m_Result = Result::Pending;
+      }
+
+      throw;
+    }
+  }
+
+  WriteBatch::Result WriteBatch::Apply(const Operation& operation, Store::IdList& idPath, Store::IdList& touched)
+  {
+    bool exists = (idPath.size() == operation.m_Path.size());
+
+    switch (operation.m_Type)
+    {
+      case Type::Create:
+        if (exists)
+        {
+          return Result::NameAlreadyExists;
+        }
+
+        CreateEntries(operation, idPath, touched);
+        break;
+
+      case Type::Set:
+        if (!exists)
+        {
+          return Result::EntryNotFound;
+        }
+
+        m_Store.SetEntryValue(idPath.back(), operation.m_ValueType, operation.m_BindValue);
+        touched.insert(end(touched), begin(idPath), end(idPath));
+        break;
+
+      case Type::SetOrCreate:
+        if (!exists)
+        {
+          CreateEntries(operation, idPath, touched);
+        }
+        else
+        {
+          m_Store.SetEntryValue(idPath.back(), operation.m_ValueType, operation.m_BindValue);
+          touched.insert(end(touched), begin(idPath), end(idPath));
+        }
+        break;
+
+      case Type::Delete:
+        if (!exists)
+        {
+          return Result::EntryNotFound;
+        }
+
+        // revisions of the parents get bumped with all others at the end of Apply()
+        if (!m_Store.TryDeleteEntryImpl(idPath.back(), operation.m_Recursive))
+        {
+          return Result::HasChildEntry;
+        }
+
+        idPath.pop_back();
+        touched.insert(end(touched), begin(idPath), end(idPath));
+        break;
+
+      default:
+        assert(false);
+    }
+
+    return Result::Succeeded;
+  }
+
+  void WriteBatch::CreateEntries(const Operation& operation, Store::IdList& idPath, Store::IdList& touched)
+  {
+    const auto& path = operation.m_Path;
+
+    assert(idPath.size() < path.size());
+
+    // existing parents get a new revision, new entries start with a random one
+    touched.insert(end(touched), begin(idPath), end(idPath));
+
+    while (idPath.size() < path.size())
+    {
+      Store::Integer parent = !idPath.empty() ? idPath.back() : 0;
+      const auto& name = path[idPath.size()];
+
+      if ((idPath.size() + 1) == path.size())
+      {
+        m_Store.CreateEntry(parent, name, operation.m_ValueType, operation.m_BindValue);
+      }
+      else
+      {
+        // intermediate entry with default value
+        m_Store.CreateEntry(parent, name, Store::DefaultEntryValueType,
+                            [](int index, SQLite::Statement& stm) { stm.bind(index, Store::DefaultEntryValue); });
+      }
+
+      if (!m_Store.GetEntryId(idPath, name, parent))
+      {
+        throw ExceptionImpl<InvalidInsert>(L"Failed to insert new entry: " + UTF8ToWchar(name));
+      }
+    }
+  }
+}
@@ -0,0 +1,103 @@
+// Copyright (c) 2014 by Bertolt Mildner
+// All rights reserved.
+
+#ifndef CONFIGURATION_WRITEBATCH_H
+#define CONFIGURATION_WRITEBATCH_H
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <boost\noncopyable.hpp>
+
+#include "Configuration.h"
+
+namespace Configuration
+{
+  // collects changes to multiple entries and applies them within one transaction
+  // names are validated when a change is added (unless deferred, see constructor), entries are not accessed before Apply()
+  // operations are applied ordered by path, operations on the same entry in the order they were added
+  //   -> e.g. a delete of an entry is always applied before operations on its descendants
+  // not multi-thread safe, has to be used by the same thread as the Store object
+  class WriteBatch : private boost::noncopyable
+  {
+    public:
+      enum class Result { Pending, Succeeded, EntryNotFound, NameAlreadyExists, HasChildEntry };
+
+      // threads != 1 (0 == one per core) defers validating, splitting and transcoding of names to Apply(), which then does it
+      // for all added changes in parallel -> InvalidName is thrown by Apply() instead, before anything is applied
+      // pays off for batches of many thousands of changes
+      explicit WriteBatch(Store& store, std::size_t threads = 1);
+
+      // all functions adding an operation return its index, see GetResult()
+      // same semantic as the corresponding functions in Store
+      std::size_t Create(const Store::String& name, const Store::String& value);
+      std::size_t Create(const Store::String& name, Store::Integer       value);
+      std::size_t Create(const Store::String& name, const Store::Binary& value);
+
+      std::size_t Set(const Store::String& name, const Store::String& value);
+      std::size_t Set(const Store::String& name, Store::Integer       value);
+      std::size_t Set(const Store::String& name, const Store::Binary& value);
+
+      std::size_t SetOrCreate(const Store::String& name, const Store::String& value);
+      std::size_t SetOrCreate(const Store::String& name, Store::Integer       value);
+      std::size_t SetOrCreate(const Store::String& name, const Store::Binary& value);
+
+      std::size_t Delete(const Store::String& name, bool recursive = true);
+
+      std::size_t Size() const noexcept;
+      bool Empty() const noexcept;
+
+      // removes all operations
+      void Clear() noexcept;
+
+      // applies all operations within one transaction, failing operations do not prevent the others from being applied
+      // revisions of all touched entries and their parents are bumped once per Apply()
+      // returns true if all operations succeeded, see GetResult() for the result of each operation
+      // to get all-or-nothing semantics call Apply() within a WriteableTransaction and only commit if it returns true
+      bool Apply();
+
+      // Pending until Apply() has been called successfully
+      Result GetResult(std::size_t index) const;
+
+    private:
+      enum class Type { Create, Set, SetOrCreate, Delete };
+
+      // UTF-8 encoded names of the entries along the path, as bound to the statements
+      using Segments = std::vector<std::string>;
+
+      struct Operation
+      {
+        Type                   m_Type;
+        Store::String          m_Name;  // only until parsed into m_Path
+        Segments               m_Path;
+        Store::ValueType       m_ValueType;
+        Store::ValueBinder     m_BindValue;
+        bool                   m_Recursive;
+        Result                 m_Result;
+      };
+
+      std::size_t Add(Type type, const Store::String& name, Store::ValueType valueType, const Store::ValueBinder& bindValue, bool recursive = false);
+
+      // returns false if name is not valid
+      static bool ParseName(const Store::String& name, Store::String::value_type delimiter, Segments& path);
+
+      // parses names of all operations added since the last call
+      void ParseNames();
+
+      // idPath contains the ids of the existing part of the path of operation and is updated to reflect the changes
+      // touched collects all ids that need a revision bump
+      Result Apply(const Operation& operation, Store::IdList& idPath, Store::IdList& touched);
+
+      void CreateEntries(const Operation& operation, Store::IdList& idPath, Store::IdList& touched);
+
+      Store&                 m_Store;
+      std::size_t            m_Threads;
+      std::vector<Operation> m_Operations;
+      std::size_t            m_Parsed;  // number of operations with parsed names
+  };
+}
+
+#endif
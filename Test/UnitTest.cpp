@@ -8,6 +8,9 @@
 #include <memory>
 #include <functional>
 #include <set>
+#include <thread>
+#include <chrono>
+#include <sstream>
 
 #include "Configuration/Utils.h"
 
@@ -17,10 +20,19 @@ CONFIGURATION_BOOST_INCL_GUARD_BEGIN
 #include <boost/timer/timer.hpp>
 #include <boost/random/mersenne_twister.hpp>
 #include <boost/random/uniform_int_distribution.hpp>
+#include <boost/tokenizer.hpp>
 CONFIGURATION_BOOST_INCL_GUARD_END
 
 #define CONFIGURATION_UNITTEST_ENABLE_PRIVATEACCESS
 #include "Configuration/Configuration.h"
+#include "Configuration/Maintenance.h"
+#include "Configuration/WriteBatch.h"
+#include "Configuration/Json.h"
+#include "Configuration/NameScanner.h"
+#include "Configuration/ChangeSignal.h"
+#include "Configuration/Snapshot.h"
+
+#include "SQLiteCpp\SQLiteCpp.h"
 
 using namespace std;
 using namespace Configuration;
@@ -44,6 +56,90 @@ namespace Configuration
         {
           store.SetNewDelimiter(delimiter);
         }
+
+        // turns store into a database of the given minor version, only removes what newer versions added
+        static void DowngradeDatabase(Store& store, Store::Integer minorVersion)
+        {
+          if (minorVersion < 6)
+          {
+            // store can not be written anymore afterwards
+            store.m_Database->exec("DROP TRIGGER temp.TriggerStats_Insert");
+            store.m_Database->exec("DROP TRIGGER temp.TriggerStats_Update");
+            store.m_Database->exec("DROP TRIGGER temp.TriggerStats_Delete");
+            store.m_Database->exec("ALTER TABLE Entries DROP COLUMN SubtreeSize");
+            store.m_Database->exec("ALTER TABLE Entries DROP COLUMN Descendants");
+          }
+
+          if (minorVersion < 5)
+          {
+            store.m_Database->exec("DROP INDEX TableEntries_FullPath");
+            store.m_Database->exec("ALTER TABLE Entries DROP COLUMN FullPath");
+          }
+
+          if (minorVersion < 4)
+          {
+            store.m_Database->exec("DROP INDEX TableEntries_NameHash");
+            store.m_Database->exec("ALTER TABLE Entries DROP COLUMN NameHash");
+          }
+
+          if (minorVersion < 3)
+          {
+            store.m_Database->exec("ALTER TABLE Entries DROP COLUMN Hash");
+            store.m_Database->exec("ALTER TABLE Entries DROP COLUMN HashRevision");
+          }
+
+          if (minorVersion < 2)
+          {
+            store.m_Database->exec("DROP TABLE History");
+          }
+
+          if (minorVersion < 1)
+          {
+            store.m_Database->exec("DROP INDEX TableEntries_Expires");
+            store.m_Database->exec("ALTER TABLE Entries DROP COLUMN Expires");
+          }
+
+          WriteableTransaction transaction(store);
+
+          store.SetSetting("MinorVersion", minorVersion);
+
+          transaction.Commit();
+        }
+
+        static void ExecuteSql(Store& store, const std::string& sql)
+        {
+          store.m_Database->exec(sql);
+        }
+
+        static Store::Integer GetDatabaseMinorVersion(const Store& store)
+        {
+          return store.m_DatabaseVersionMinor;
+        }
+
+        static Store::Integer GetEntryRevision(const Store& store, const Store::String& name)
+        {
+          ReadOnlyTransaction transaction(store);
+
+          return store.GetEntryRevision(store.GetEntryId(store.ParseName(name)).back());
+        }
+
+        static bool HasStoredHash(const Store& store, const Store::String& name)
+        {
+          ReadOnlyTransaction transaction(store);
+
+          auto stm = store.GetStatement("SELECT HashRevision IS Revision FROM Entries WHERE Id = ?1");
+
+          stm->bind(1, name.empty() ? 0 : store.GetTargetEntryId(store.ParseName(name)));
+
+          return stm->executeStep() && (stm->getColumn(0).getInt() != 0);
+        }
+
+        static bool HasMissingFullPaths(const Store& store)
+        {
+          ReadOnlyTransaction transaction(store);
+
+          return store.HasMissingFullPaths();
+        }
       };
     }
   }
@@ -198,15 +294,18 @@ namespace
   using UniqueStorePtrDeleter = function<void(Store* ptr)>;
   using UniqueStorePtr        = unique_ptr<Store, UniqueStorePtrDeleter>;
 
-  UniqueStorePtr CreateEmptyStore(const wstring& fileName = DefaultDatabaseFileName, Store::String::value_type delimiter = Store::DefaultNameDelimiter)
+  UniqueStorePtr CreateEmptyStore(const wstring& fileName = DefaultDatabaseFileName, Store::String::value_type delimiter = Store::DefaultNameDelimiter,
+                                  const Store::Options& options = Store::Options())
   {
     // make sure we really create a empty database by deleting the file if it exists
-    boost::filesystem::remove(fileName);
+    // in-memory file names are no valid paths on all platforms, so we ignore any error
+    boost::system::error_code ignored;
+    boost::filesystem::remove(fileName, ignored);
 
     // instantiate function as local variable to avoid memory leak in case ctor throws!
     UniqueStorePtrDeleter func = [](Store* ptr) { ptr->CheckDataConsistency(); delete ptr; };
 
-    return UniqueStorePtr(new Store(fileName, true, delimiter), move(func));
+    return UniqueStorePtr(new Store(fileName, true, delimiter, options), move(func));
   }
 
 
@@ -1159,84 +1258,2984 @@ namespace
     }
   }
 
-  void Benchmark()
+  void TestInMemory()
   {
-    static const size_t count = 10000;
+    // private in-memory stores are independent of each other
+    {
+      auto store1 = CreateEmptyStore(Store::InMemoryFileName);
+      auto store2 = CreateEmptyStore(Store::InMemoryFileName);
 
-    set<Store::String>     names;
-    vector<Store::String>  stringValues;
-    vector<Store::Integer> intValues;
+      UNITTEST_ASSERT(store1->IsInMemory());
+      UNITTEST_ASSERT(store2->IsInMemory());
 
-    stringValues.reserve(count);
-    intValues.resize(count);
+      store1->Create(L"name", 1);
 
-    for (size_t i = 0; i < count; i++)
+      UNITTEST_ASSERT(store1->Exists(L"name"));
+      UNITTEST_ASSERT(!store2->Exists(L"name"));
+    }
+
+    // shared in-memory stores share their content as long as one Store object is alive
     {
-      while (!names.insert(GenerateRandomName()).second);  // names have to be unique
-      stringValues.push_back(GenerateRandomString(35, 5));
-      intValues[i] = GetRandomNumber();
+      const wstring fileName = Store::GetSharedInMemoryFileName(L"unittest shared/memory?store");
+
+      UNITTEST_ASSERT(fileName != Store::GetSharedInMemoryFileName(L"unittest"));
+
+      auto store1 = CreateEmptyStore(fileName);
+
+      UNITTEST_ASSERT(store1->IsInMemory());
+
+      store1->Create(L"name", L"value");
+
+      {
+        Store store2(fileName);
+
+        UNITTEST_ASSERT(store2.IsInMemory());
+        UNITTEST_ASSERT(store2.GetString(L"name") == L"value");
+        UNITTEST_ASSERT(store2.GetRevision() == store1->GetRevision());
+
+        store2.Set(L"name", L"new value");
+      }
+
+      UNITTEST_ASSERT(store1->GetString(L"name") == L"new value");
     }
 
-    cout << "Creating " << count << " entries:\n";
+    {
+      Store store(Store::GetSharedInMemoryFileName(L"unittest shared/memory?store"));
 
-    auto store = CreateEmptyStore();
-    WriteableTransaction transaction(*store);
+      UNITTEST_ASSERT(!store.Exists(L"name"));
+    }
 
-    {      
-      boost::timer::auto_cpu_timer timer;
+    // save in-memory store to file and load it back again
+    {
+      auto fileStore = CreateEmptyStore(DefaultDatabaseFileName);
 
-      assert(names.size() == count);
-      assert(names.size() == stringValues.size());
-      assert(intValues.size() == stringValues.size());
+      UNITTEST_ASSERT(!fileStore->IsInMemory());
 
-      // TODO: is there a better way to iterate over multiple containers at once?
-      size_t index = 0;
+      fileStore.reset();
 
-      for (const auto& name : names)
+      auto store = CreateEmptyStore(Store::InMemoryFileName, L'/');
+
+      store->Create(L"name1/name2", 4711);
+      store->Create(L"name1/name3", L"value");
+      store->Create(L"name4", Store::Binary(16, 0xcd));
+
+      // no ATTACH within a transaction
       {
-        if (GetRandomNumber(0, 1) == 0)
-        {
-          store->Create(name, intValues[index]);
-        }
-        else
-        {
-          store->Create(name, stringValues[index]);
-        }
+        ReadOnlyTransaction transaction(*store);
 
-        index++;
+        UNITTEST_ASSERT_THROWS(store->SaveTo(DefaultDatabaseFileName), InvalidTransaction);
+      }
+
+      UNITTEST_ASSERT_NO_EXCEPTION(store->SaveTo(DefaultDatabaseFileName));
+
+      {
+        Store saved(DefaultDatabaseFileName);
+
+        UNITTEST_ASSERT(saved.GetNameDelimiter() == L'/');
+        UNITTEST_ASSERT(saved.GetInteger(L"name1/name2") == 4711);
+        UNITTEST_ASSERT(saved.GetString(L"name1/name3") == L"value");
+        UNITTEST_ASSERT(saved.GetBinary(L"name4") == Store::Binary(16, 0xcd));
+        UNITTEST_ASSERT(saved.GetRevision() == store->GetRevision());
+        UNITTEST_ASSERT_NO_EXCEPTION(saved.CheckDataConsistency());
+      }
+
+      auto loaded = CreateEmptyStore(Store::InMemoryFileName);
+
+      loaded->Create(L"other", 0);
+
+      UNITTEST_ASSERT_NO_EXCEPTION(loaded->LoadFrom(DefaultDatabaseFileName));
+
+      UNITTEST_ASSERT(loaded->GetNameDelimiter() == L'/');
+      UNITTEST_ASSERT(!loaded->Exists(L"other"));
+      UNITTEST_ASSERT(loaded->GetInteger(L"name1/name2") == 4711);
+      UNITTEST_ASSERT(loaded->GetString(L"name1/name3") == L"value");
+      UNITTEST_ASSERT(loaded->GetBinary(L"name4") == Store::Binary(16, 0xcd));
+      UNITTEST_ASSERT(loaded->GetRevision() == store->GetRevision());
+
+      // loading from a non-existing store fails (SQLite exception) and leaves the store untouched
+      bool failed = false;
+
+      try
+      {
+        loaded->LoadFrom(L"does_not_exist.db");
+      }
+
+      catch (...)
+      {
+        failed = true;
+      }
+
+      UNITTEST_ASSERT(failed);
+      UNITTEST_ASSERT(loaded->GetInteger(L"name1/name2") == 4711);
+    }
+  }
+
+  void TestCompact()
+  {
+    Store::Options options;
+
+    options.SecureDelete = true;
+
+    auto store = CreateEmptyStore(DefaultDatabaseFileName, Store::DefaultNameDelimiter, options);
+
+    auto fillAndClear = [&store]()
+    {
+      WriteableTransaction transaction(*store);
+
+      for (int i = 0; i < 100; i++)
+      {
+        store->Create((boost::wformat(L"Compact.Value%1%") % i).str(), Store::Binary(4096, 0xcd));
+      }
+
+      store->Delete(L"Compact");
+
+      transaction.Commit();
+    };
+
+    fillAndClear();
+
+    UNITTEST_ASSERT(store->GetFreePageRatio() > 0.5);
+
+    // check for writeable transaction in implementation
+    {
+      ReadOnlyTransaction transaction(*store);
+
+      UNITTEST_ASSERT_THROWS(store->Compact(), InvalidTransaction);
+    }
+
+    UNITTEST_ASSERT(store->Compact(1) == 1);
+    UNITTEST_ASSERT(store->Compact() > 0);
+    UNITTEST_ASSERT(store->GetFreePageRatio() == 0.0);
+    UNITTEST_ASSERT(store->Compact() == 0);
+
+    // background compaction
+    fillAndClear();
+
+    UNITTEST_ASSERT(store->GetFreePageRatio() > 0.5);
+
+    MaintenancePolicy policy;
+
+    policy.FreePageRatio   = 0.1;
+    policy.MaxPagesPerStep = 8;
+    policy.Interval        = chrono::milliseconds(10);
+
+    {
+      BackgroundMaintenance maintenance(DefaultDatabaseFileName, policy);
+
+      for (int i = 0; (i < 1000) && (store->GetFreePageRatio() > 0.0); i++)
+      {
+        this_thread::sleep_for(chrono::milliseconds(10));
+      }
+
+      UNITTEST_ASSERT(store->GetFreePageRatio() == 0.0);
+      UNITTEST_ASSERT(maintenance.GetCompactedPages() > 0);
+      UNITTEST_ASSERT(maintenance.GetFailedRuns() == 0);
+    }
+  }
+
+  void TestOptimize()
+  {
+    Store::Options options;
+
+    options.PrepareStatements = true;
+
+    auto store = CreateEmptyStore(Store::InMemoryFileName, Store::DefaultNameDelimiter, options);
+
+    for (int i = 0; i < 100; i++)
+    {
+      store->Create((boost::wformat(L"Optimize.Value%1%") % i).str(), i);
+    }
+
+    // check for writeable transaction in implementation
+    {
+      ReadOnlyTransaction transaction(*store);
+
+      UNITTEST_ASSERT_THROWS(store->Optimize(), InvalidTransaction);
+    }
+
+    // first run analyzes, all later ones optimize
+    UNITTEST_ASSERT_NO_EXCEPTION(store->Optimize());
+    UNITTEST_ASSERT_NO_EXCEPTION(store->Optimize());
+
+    UNITTEST_ASSERT(store->GetInteger(L"Optimize.Value42") == 42);
+    UNITTEST_ASSERT(store->GetChildren(L"Optimize").size() == 100);
+
+    // background optimization
+    {
+      auto fileStore = CreateEmptyStore(DefaultDatabaseFileName);
+
+      MaintenancePolicy policy;
+
+      policy.Interval         = chrono::milliseconds(10);
+      policy.OptimizeInterval = chrono::milliseconds(10);
+
+      BackgroundMaintenance maintenance(DefaultDatabaseFileName, policy);
+
+      for (int i = 0; (i < 1000) && (maintenance.GetOptimizeRuns() < 2); i++)
+      {
+        this_thread::sleep_for(chrono::milliseconds(10));
       }
 
+      UNITTEST_ASSERT(maintenance.GetOptimizeRuns() >= 2);
+      UNITTEST_ASSERT(maintenance.GetFailedRuns() == 0);
+    }
+  }
+
+  void TestChildrenCache()
+  {
+    Store::Options options;
+
+    options.ChildrenCacheSize = 2;
+
+    auto store = CreateEmptyStore(Store::InMemoryFileName, Store::DefaultNameDelimiter, options);
+
+    store->Create(L"Cache.A.Value1", 1);
+    store->Create(L"Cache.B.Value1", 1);
+    store->Create(L"Cache.C.Value1", 1);
+
+    // repeated calls share the same list
+    auto children = store->GetSharedChildren(L"Cache");
+
+    UNITTEST_ASSERT(children->size() == 3);
+    UNITTEST_ASSERT(store->GetSharedChildren(L"Cache") == children);
+    UNITTEST_ASSERT(store->GetChildren(L"Cache") == *children);
+
+    UNITTEST_ASSERT_THROWS(store->GetSharedChildren(L"Cache.X"), EntryNotFound);
+    UNITTEST_ASSERT_THROWS(store->GetSharedChildren(L"Cache..A"), InvalidName);
+
+    // creating and deleting children invalidates the list
+    store->Create(L"Cache.D", 1);
+
+    auto changed = store->GetSharedChildren(L"Cache");
+
+    UNITTEST_ASSERT(changed != children);
+    UNITTEST_ASSERT(changed->size() == 4);
+    UNITTEST_ASSERT(children->size() == 3);
+
+    store->Delete(L"Cache.D");
+
+    UNITTEST_ASSERT(store->GetSharedChildren(L"Cache")->size() == 3);
+
+    // changing a value below bumps the revision of all parents, the list gets read again
+    children = store->GetSharedChildren(L"Cache");
+
+    store->Set(L"Cache.A.Value1", 2);
+
+    UNITTEST_ASSERT(store->GetSharedChildren(L"Cache") != children);
+    children = store->GetSharedChildren(L"Cache");
+    UNITTEST_ASSERT(store->GetSharedChildren(L"Cache") == children);
+
+    // rollback must not leave stale lists behind
+    {
+      WriteableTransaction transaction(*store);
+
+      store->Create(L"Cache.E", 1);
+
+      UNITTEST_ASSERT(store->GetSharedChildren(L"Cache")->size() == 4);
+    }
+
+    UNITTEST_ASSERT(store->GetSharedChildren(L"Cache")->size() == 3);
+
+    {
+      WriteableTransaction transaction(*store);
+
+      store->Create(L"Cache.F", 1);
+
       transaction.Commit();
     }
 
-    cout << "\nTotal:\n";
+    UNITTEST_ASSERT(store->GetSharedChildren(L"Cache")->size() == 4);
+
+    // least recently used lists get evicted, results stay correct
+    UNITTEST_ASSERT(store->GetSharedChildren(L"")->size() == 1);
+    UNITTEST_ASSERT(store->GetSharedChildren(L"Cache.A")->size() == 1);
+    UNITTEST_ASSERT(store->GetSharedChildren(L"Cache.B")->size() == 1);
+    UNITTEST_ASSERT(store->GetSharedChildren(L"Cache")->size() == 4);
+
+    // disabled cache
+    auto uncached = CreateEmptyStore(Store::InMemoryFileName);
+
+    uncached->Create(L"Cache.A", 1);
+
+    UNITTEST_ASSERT(uncached->GetSharedChildren(L"Cache") != uncached->GetSharedChildren(L"Cache"));
+    UNITTEST_ASSERT(uncached->GetChildren(L"Cache").size() == 1);
   }
-}  // anonymous namespace
 
-namespace Configuration
-{
-  namespace UnitTest
+  void TestConditionalWrite()
   {
-    bool Run()
+    auto store = CreateEmptyStore(Store::InMemoryFileName);
+
+    store->Create(L"Cond.Value1", 1);
+    store->Create(L"Cond.Value2", L"text");
+    store->Create(L"Cond.Tree.Child", 1);
+
+    // set
+    auto revision = store->GetRevision(L"Cond.Value1");
+    auto parentRevision = store->GetRevision(L"Cond");
+    auto rootRevision = store->GetRevision();
+
+    UNITTEST_ASSERT(store->SetIf(L"Cond.Value1", 2, revision));
+    UNITTEST_ASSERT(store->GetInteger(L"Cond.Value1") == 2);
+    UNITTEST_ASSERT(store->GetRevision(L"Cond.Value1") != revision);
+    UNITTEST_ASSERT(store->GetRevision(L"Cond") != parentRevision);
+    UNITTEST_ASSERT(store->GetRevision() != rootRevision);
+
+    // stale revision
+    UNITTEST_ASSERT(!store->SetIf(L"Cond.Value1", 3, revision));
+    UNITTEST_ASSERT(store->GetInteger(L"Cond.Value1") == 2);
+
+    revision = store->GetRevision(L"Cond.Value1");
+
+    UNITTEST_ASSERT(store->SetIf(L"Cond.Value1", L"text", revision));
+    UNITTEST_ASSERT(store->GetString(L"Cond.Value1") == L"text");
+
+    revision = store->GetRevision(L"Cond.Value1");
+
+    UNITTEST_ASSERT(store->SetIf(L"Cond.Value1", Store::Binary{1, 2, 3}, revision));
+    UNITTEST_ASSERT((store->GetBinary(L"Cond.Value1") == Store::Binary{1, 2, 3}));
+
+    // revision of another entry
+    UNITTEST_ASSERT(!store->SetIf(L"Cond.Value2", L"other", store->GetRevision(L"Cond.Value1")));
+    UNITTEST_ASSERT(store->GetString(L"Cond.Value2") == L"text");
+
+    // deleted and re-created entry
+    revision = store->GetRevision(L"Cond.Value2");
+    store->Delete(L"Cond.Value2");
+
+    UNITTEST_ASSERT(!store->SetIf(L"Cond.Value2", L"other", revision));
+
+    store->Create(L"Cond.Value2", L"new");
+
+    UNITTEST_ASSERT(!store->SetIf(L"Cond.Value2", L"other", revision));
+    UNITTEST_ASSERT(store->GetString(L"Cond.Value2") == L"new");
+
+    UNITTEST_ASSERT_THROWS(store->SetIf(L"Cond..Value2", 1, revision), InvalidName);
+
+    // delete
+    revision = store->GetRevision(L"Cond.Value2");
+    store->Set(L"Cond.Value2", L"changed");
+
+    UNITTEST_ASSERT(!store->DeleteIf(L"Cond.Value2", revision));
+    UNITTEST_ASSERT(store->Exists(L"Cond.Value2"));
+
+    revision = store->GetRevision(L"Cond.Value2");
+
+    UNITTEST_ASSERT(store->DeleteIf(L"Cond.Value2", revision));
+    UNITTEST_ASSERT(!store->Exists(L"Cond.Value2"));
+    UNITTEST_ASSERT(!store->DeleteIf(L"Cond.Value2", revision));
+
+    revision = store->GetRevision(L"Cond.Tree");
+
+    UNITTEST_ASSERT(!store->DeleteIf(L"Cond.Tree", revision, false));
+    UNITTEST_ASSERT(store->DeleteIf(L"Cond.Tree", revision, true));
+    UNITTEST_ASSERT(!store->Exists(L"Cond.Tree.Child"));
+
+    // competing writers on the same store file
     {
-      boost::timer::auto_cpu_timer timer;
-      bool result = true;
-      vector<pair<function<void()>, string>>     tests;
+      auto fileStore = CreateEmptyStore(DefaultDatabaseFileName);
 
-#define REGISTER_UNIT_TEST(x) tests.emplace_back(make_pair(x, #x))
+      fileStore->Create(L"Cond.Counter", 0);
 
-      REGISTER_UNIT_TEST(TestIsValidName);
-      REGISTER_UNIT_TEST(TestExists);
-      REGISTER_UNIT_TEST(TestGetType);
-      REGISTER_UNIT_TEST(TestHasChild);
-      REGISTER_UNIT_TEST(TestGetRevision);
-      REGISTER_UNIT_TEST(TestCreate);
-      REGISTER_UNIT_TEST(TestSet);
+      Store other(DefaultDatabaseFileName);
 
-      REGISTER_UNIT_TEST(TestWriteableTransaction);
+      auto first = fileStore->GetRevision(L"Cond.Counter");
+      auto second = other.GetRevision(L"Cond.Counter");
+
+      UNITTEST_ASSERT(first == second);
+      UNITTEST_ASSERT(other.SetIf(L"Cond.Counter", 1, second));
+      UNITTEST_ASSERT(!fileStore->SetIf(L"Cond.Counter", 1, first));
+      UNITTEST_ASSERT(fileStore->GetInteger(L"Cond.Counter") == 1);
+    }
+  }
+
+  void TestAtomicOperations()
+  {
+    auto store = CreateEmptyStore(Store::InMemoryFileName);
+
+    store->Create(L"Atomic.Counter", 0);
+    store->Create(L"Atomic.String", L"first");
+    store->Create(L"Atomic.Binary", Store::Binary());
+
+    // increment
+    auto revision = store->GetRevision(L"Atomic.Counter");
+    auto rootRevision = store->GetRevision();
+
+    UNITTEST_ASSERT(store->Increment(L"Atomic.Counter") == 1);
+    UNITTEST_ASSERT(store->Increment(L"Atomic.Counter", 41) == 42);
+    UNITTEST_ASSERT(store->Increment(L"Atomic.Counter", -50) == -8);
+    UNITTEST_ASSERT(store->GetInteger(L"Atomic.Counter") == -8);
+    UNITTEST_ASSERT(store->GetRevision(L"Atomic.Counter") != revision);
+    UNITTEST_ASSERT(store->GetRevision() != rootRevision);
+
+    store->Set(L"Atomic.Counter", numeric_limits<Store::Integer>::max() - 1);
+
+    UNITTEST_ASSERT(store->Increment(L"Atomic.Counter") == numeric_limits<Store::Integer>::max());
+    UNITTEST_ASSERT_THROWS(store->Increment(L"Atomic.Counter"), ValueOutOfRange);
+    UNITTEST_ASSERT(store->GetInteger(L"Atomic.Counter") == numeric_limits<Store::Integer>::max());
+
+    store->Set(L"Atomic.Counter", numeric_limits<Store::Integer>::min() + 1);
+
+    UNITTEST_ASSERT(store->Increment(L"Atomic.Counter", -1) == numeric_limits<Store::Integer>::min());
+    UNITTEST_ASSERT_THROWS(store->Increment(L"Atomic.Counter", -1), ValueOutOfRange);
+
+    UNITTEST_ASSERT_THROWS(store->Increment(L"Atomic.String"), WrongValueType);
+    UNITTEST_ASSERT_THROWS(store->Increment(L"Atomic.Missing"), EntryNotFound);
+
+    // NULL values are read and incremented as 0
+    store->Create(L"Atomic.Null", 5);
+
+    Configuration::UnitTest::Detail::PrivateAccess::ExecuteSql(*store, "UPDATE Entries SET Value = NULL WHERE Name = 'Null'");
+
+    UNITTEST_ASSERT(store->GetInteger(L"Atomic.Null") == 0);
+    UNITTEST_ASSERT(store->Increment(L"Atomic.Null", 3) == 3);
+    UNITTEST_ASSERT(store->GetInteger(L"Atomic.Null") == 3);
+
+    store->Delete(L"Atomic.Null");
+
+    // append
+    UNITTEST_ASSERT(store->AppendBinary(L"Atomic.Binary", Store::Binary{0, 1}) == 2);
+    UNITTEST_ASSERT(store->AppendBinary(L"Atomic.Binary", Store::Binary()) == 2);
+    UNITTEST_ASSERT(store->AppendBinary(L"Atomic.Binary", Store::Binary{0, 255}) == 4);
+    UNITTEST_ASSERT((store->GetBinary(L"Atomic.Binary") == Store::Binary{0, 1, 0, 255}));
+    UNITTEST_ASSERT(store->IsBinary(L"Atomic.Binary"));
+
+    UNITTEST_ASSERT_THROWS(store->AppendBinary(L"Atomic.String", Store::Binary{1}), WrongValueType);
+
+    // compare and swap
+    UNITTEST_ASSERT(store->CompareAndSwap(L"Atomic.String", L"first", L"second"));
+    UNITTEST_ASSERT(!store->CompareAndSwap(L"Atomic.String", L"first", L"third"));
+    UNITTEST_ASSERT(store->GetString(L"Atomic.String") == L"second");
+
+    store->Set(L"Atomic.Counter", 1);
+
+    UNITTEST_ASSERT(store->CompareAndSwap(L"Atomic.Counter", 1, 2));
+    UNITTEST_ASSERT(!store->CompareAndSwap(L"Atomic.Counter", 1, 3));
+    UNITTEST_ASSERT(store->GetInteger(L"Atomic.Counter") == 2);
+
+    UNITTEST_ASSERT(store->CompareAndSwap(L"Atomic.Binary", Store::Binary{0, 1, 0, 255}, Store::Binary{2}));
+    UNITTEST_ASSERT(!store->CompareAndSwap(L"Atomic.Binary", Store::Binary{0, 1, 0, 255}, Store::Binary{3}));
+    UNITTEST_ASSERT((store->GetBinary(L"Atomic.Binary") == Store::Binary{2}));
+
+    UNITTEST_ASSERT_THROWS(store->CompareAndSwap(L"Atomic.Counter", L"2", L"3"), WrongValueType);
+
+    // empty and NULL values compare like they are read
+    store->Create(L"Atomic.Empty", Store::Binary{1});
+
+    UNITTEST_ASSERT(store->CompareAndSwap(L"Atomic.Empty", Store::Binary{1}, Store::Binary()));
+    UNITTEST_ASSERT(store->CompareAndSwap(L"Atomic.Empty", Store::Binary(), Store::Binary{2}));
+    UNITTEST_ASSERT(store->AppendBinary(L"Atomic.Empty", Store::Binary()) == 1);
+
+    Configuration::UnitTest::Detail::PrivateAccess::ExecuteSql(*store, "UPDATE Entries SET Value = X'' WHERE Name = 'Empty'");
+
+    UNITTEST_ASSERT(store->CompareAndSwap(L"Atomic.Empty", Store::Binary(), Store::Binary{3}));
+    UNITTEST_ASSERT(!store->CompareAndSwap(L"Atomic.Empty", Store::Binary(), Store::Binary{4}));
+    UNITTEST_ASSERT((store->GetBinary(L"Atomic.Empty") == Store::Binary{3}));
+
+    store->Create(L"Atomic.Null", 5);
+    store->Create(L"Atomic.NullString", L"text");
+
+    Configuration::UnitTest::Detail::PrivateAccess::ExecuteSql(*store, "UPDATE Entries SET Value = NULL WHERE Name IN ('Null', 'NullString')");
+
+    UNITTEST_ASSERT(!store->CompareAndSwap(L"Atomic.Null", 1, 2));
+    UNITTEST_ASSERT(store->CompareAndSwap(L"Atomic.Null", 0, 2));
+    UNITTEST_ASSERT(store->GetInteger(L"Atomic.Null") == 2);
+    UNITTEST_ASSERT(store->CompareAndSwap(L"Atomic.NullString", L"", L"set"));
+    UNITTEST_ASSERT(store->GetString(L"Atomic.NullString") == L"set");
+
+    // within an outer transaction
+    {
+      WriteableTransaction transaction(*store);
+
+      UNITTEST_ASSERT(store->Increment(L"Atomic.Counter") == 3);
+    }
+
+    UNITTEST_ASSERT(store->GetInteger(L"Atomic.Counter") == 2);
+  }
+
+  void TestWriteBatch()
+  {
+    auto store = CreateEmptyStore(Store::InMemoryFileName);
+
+    store->Create(L"Batch.Existing", 1);
+    store->Create(L"Batch.Tree.Child", 1);
+    store->Create(L"Batch.Removed.Child", 1);
+
+    auto existingRevision = store->GetRevision(L"Batch.Existing");
+    auto rootRevision = store->GetRevision();
+
+    WriteBatch batch(*store);
+
+    UNITTEST_ASSERT(batch.Empty());
+    UNITTEST_ASSERT_THROWS(batch.Set(L"Batch..Invalid", 1), InvalidName);
+    UNITTEST_ASSERT(batch.Empty());
+
+    auto create = batch.Create(L"Batch.New.Deep.Value", L"text");
+    auto createExisting = batch.Create(L"Batch.Existing", 2);
+    auto set = batch.Set(L"Batch.Existing", Store::Binary{1, 2});
+    auto setMissing = batch.Set(L"Batch.Missing", 1);
+    auto setOrCreate = batch.SetOrCreate(L"Batch.New.Other", 3);
+    auto deleteNonRecursive = batch.Delete(L"Batch.Tree", false);
+    auto deleteRecursive = batch.Delete(L"Batch.Removed");
+    auto createBelowDeleted = batch.Create(L"Batch.Removed.Child", 2);  // applied after the delete
+    auto deleteMissing = batch.Delete(L"Batch.Missing");
+
+    UNITTEST_ASSERT(batch.Size() == 9);
+    UNITTEST_ASSERT(batch.GetResult(create) == WriteBatch::Result::Pending);
+
+    UNITTEST_ASSERT(!batch.Apply());
+
+    UNITTEST_ASSERT(batch.GetResult(create) == WriteBatch::Result::Succeeded);
+    UNITTEST_ASSERT(batch.GetResult(createExisting) == WriteBatch::Result::NameAlreadyExists);
+    UNITTEST_ASSERT(batch.GetResult(set) == WriteBatch::Result::Succeeded);
+    UNITTEST_ASSERT(batch.GetResult(setMissing) == WriteBatch::Result::EntryNotFound);
+    UNITTEST_ASSERT(batch.GetResult(setOrCreate) == WriteBatch::Result::Succeeded);
+    UNITTEST_ASSERT(batch.GetResult(deleteNonRecursive) == WriteBatch::Result::HasChildEntry);
+    UNITTEST_ASSERT(batch.GetResult(deleteRecursive) == WriteBatch::Result::Succeeded);
+    UNITTEST_ASSERT(batch.GetResult(createBelowDeleted) == WriteBatch::Result::Succeeded);
+    UNITTEST_ASSERT(batch.GetResult(deleteMissing) == WriteBatch::Result::EntryNotFound);
+
+    UNITTEST_ASSERT(store->GetString(L"Batch.New.Deep.Value") == L"text");
+    UNITTEST_ASSERT(store->GetInteger(L"Batch.New.Deep") == 0);
+    UNITTEST_ASSERT(store->GetInteger(L"Batch.New.Other") == 3);
+    UNITTEST_ASSERT((store->GetBinary(L"Batch.Existing") == Store::Binary{1, 2}));
+    UNITTEST_ASSERT(store->Exists(L"Batch.Tree.Child"));
+    UNITTEST_ASSERT(store->GetInteger(L"Batch.Removed.Child") == 2);
+    UNITTEST_ASSERT(store->GetChildren(L"Batch.Removed").size() == 1);
+    UNITTEST_ASSERT(!store->Exists(L"Batch.Missing"));
+
+    UNITTEST_ASSERT(store->GetRevision(L"Batch.Existing") != existingRevision);
+    UNITTEST_ASSERT(store->GetRevision() != rootRevision);
+
+    store->CheckDataConsistency();
+
+    // revisions are bumped once per batch
+    {
+      auto revision = Configuration::UnitTest::Detail::PrivateAccess::GetEntryRevision(*store, L"Batch.Existing");
+      auto parentRevision = Configuration::UnitTest::Detail::PrivateAccess::GetEntryRevision(*store, L"Batch");
+
+      WriteBatch twice(*store);
+
+      twice.Set(L"Batch.Existing", 1);
+      twice.Set(L"Batch.Existing", 2);
+      twice.Create(L"Batch.Another", 1);
+
+      UNITTEST_ASSERT(twice.Apply());
+      UNITTEST_ASSERT(store->GetInteger(L"Batch.Existing") == 2);
+
+      UNITTEST_ASSERT(Configuration::UnitTest::Detail::PrivateAccess::GetEntryRevision(*store, L"Batch.Existing") == revision + 1);
+      UNITTEST_ASSERT(Configuration::UnitTest::Detail::PrivateAccess::GetEntryRevision(*store, L"Batch") == parentRevision + 1);
+    }
+
+    // all-or-nothing
+    {
+      WriteBatch failing(*store);
+
+      failing.Set(L"Batch.Existing", 3);
+      failing.Set(L"Batch.Missing", 3);
+
+      WriteableTransaction transaction(*store);
+
+      if (failing.Apply())
+      {
+        transaction.Commit();
+      }
+    }
+
+    UNITTEST_ASSERT(store->GetInteger(L"Batch.Existing") == 2);
+
+    // names parsed in parallel by Apply()
+    {
+      WriteBatch parallel(*store, 4);
+
+      for (int i = 0; i < 10000; i++)
+      {
+        parallel.SetOrCreate((boost::wformat(L"Parallel.Node%1%.Value") % (i % 100)).str(), static_cast<Store::Integer>(i));
+      }
+
+      auto invalid = parallel.Set(L"Parallel..Invalid", 1);
+
+      UNITTEST_ASSERT(parallel.Size() == 10001);
+      UNITTEST_ASSERT_THROWS(parallel.Apply(), InvalidName);
+      UNITTEST_ASSERT(!store->Exists(L"Parallel"));
+      UNITTEST_ASSERT(parallel.GetResult(invalid) == WriteBatch::Result::Pending);
+
+      parallel.Clear();
+
+      for (int i = 0; i < 10000; i++)
+      {
+        parallel.SetOrCreate((boost::wformat(L"Parallel.Node%1%.Value") % (i % 100)).str(), static_cast<Store::Integer>(i));
+      }
+
+      UNITTEST_ASSERT(parallel.Apply());
+      UNITTEST_ASSERT(store->GetChildren(L"Parallel").size() == 100);
+      UNITTEST_ASSERT(store->GetInteger(L"Parallel.Node42.Value") == 9942);
+    }
+
+    store->CheckDataConsistency();
+
+    // empty batch
+    batch.Clear();
+
+    UNITTEST_ASSERT(batch.Empty());
+    UNITTEST_ASSERT(batch.Apply());
+  }
+
+  void TestWriteBack()
+  {
+    auto store = CreateEmptyStore(DefaultDatabaseFileName);
+
+    store->Create(L"Status.Value1", 0);
+    store->Create(L"Status.Value2", L"idle");
+    store->Create(L"Other.Value", 0);
+
+    Store reader(DefaultDatabaseFileName);
+
+    Store::WriteBackPolicy policy;
+
+    policy.MaxPendingEntries = 3;
+    policy.MaxPendingTime = chrono::hours(1);
+
+    UNITTEST_ASSERT_THROWS(store->EnableWriteBack(L"Status..", policy), InvalidName);
+    UNITTEST_ASSERT(!store->IsWriteBackEnabled());
+
+    store->EnableWriteBack(L"Status", policy);
+
+    UNITTEST_ASSERT(store->IsWriteBackEnabled());
+
+    // buffered writes are only visible to the writing store
+    auto revision = store->GetRevision(L"Status.Value1");
+
+    store->Set(L"Status.Value1", 1);
+    store->Set(L"Status.Value1", 2);
+    store->SetOrCreate(L"Status.Value2", Store::Binary{1});
+
+    UNITTEST_ASSERT(store->GetPendingWrites() == 2);
+    UNITTEST_ASSERT(store->GetInteger(L"Status.Value1") == 2);
+    UNITTEST_ASSERT(store->IsBinary(L"Status.Value2"));
+    UNITTEST_ASSERT((store->GetBinary(L"Status.Value2") == Store::Binary{1}));
+    UNITTEST_ASSERT_THROWS(store->GetString(L"Status.Value2"), WrongValueType);
+    UNITTEST_ASSERT(store->GetRevision(L"Status.Value1") == revision);
+
+    UNITTEST_ASSERT(reader.GetInteger(L"Status.Value1") == 0);
+    UNITTEST_ASSERT(reader.GetString(L"Status.Value2") == L"idle");
+
+    // explicit flush
+    {
+      ReadOnlyTransaction transaction(*store);
+
+      UNITTEST_ASSERT_THROWS(store->Flush(), InvalidTransaction);
+    }
+
+    store->Flush();
+
+    UNITTEST_ASSERT(store->GetPendingWrites() == 0);
+    UNITTEST_ASSERT(reader.GetInteger(L"Status.Value1") == 2);
+    UNITTEST_ASSERT((reader.GetBinary(L"Status.Value2") == Store::Binary{1}));
+    UNITTEST_ASSERT(store->GetRevision(L"Status.Value1") != revision);
+
+    // only existing entries below the subtree are buffered
+    UNITTEST_ASSERT_THROWS(store->Set(L"Status.Missing", 1), EntryNotFound);
+
+    store->SetOrCreate(L"Status.New", 1);
+    store->Set(L"Other.Value", 1);
+
+    UNITTEST_ASSERT(store->GetPendingWrites() == 0);
+    UNITTEST_ASSERT(reader.GetInteger(L"Status.New") == 1);
+    UNITTEST_ASSERT(reader.GetInteger(L"Other.Value") == 1);
+
+    // flush on size limit
+    store->Set(L"Status.Value1", 3);
+    store->Set(L"Status.Value2", L"busy");
+    store->Set(L"Status.New", 2);
+
+    UNITTEST_ASSERT(store->GetPendingWrites() == 0);
+    UNITTEST_ASSERT(reader.GetInteger(L"Status.Value1") == 3);
+
+    // flush before other writes
+    store->Set(L"Status.Value1", 4);
+    store->Create(L"Status.Created", 1);
+
+    UNITTEST_ASSERT(store->GetPendingWrites() == 0);
+    UNITTEST_ASSERT(reader.GetInteger(L"Status.Value1") == 4);
+
+    // writes within a transaction are not buffered
+    {
+      WriteableTransaction transaction(*store);
+
+      store->Set(L"Status.Value1", 5);
+
+      UNITTEST_ASSERT(store->GetPendingWrites() == 0);
+    }
+
+    UNITTEST_ASSERT(store->GetInteger(L"Status.Value1") == 4);
+
+    // writes to entries deleted in the meantime are dropped
+    store->Set(L"Status.New", 3);
+    reader.Delete(L"Status.New");
+
+    UNITTEST_ASSERT_NO_EXCEPTION(store->Flush());
+    UNITTEST_ASSERT(!reader.Exists(L"Status.New"));
+
+    // flush on time limit
+    policy.MaxPendingEntries = 1000;
+    policy.MaxPendingTime = chrono::milliseconds(10);
+
+    store->EnableWriteBack(L"", policy);
+
+    store->Set(L"Status.Value1", 6);
+    this_thread::sleep_for(chrono::milliseconds(20));
+    store->Set(L"Other.Value", 2);
+
+    UNITTEST_ASSERT(store->GetPendingWrites() == 0);
+    UNITTEST_ASSERT(reader.GetInteger(L"Other.Value") == 2);
+
+    // periodic flush while no writes come
+    store->Set(L"Status.Value1", 6);
+
+    UNITTEST_ASSERT(!store->FlushDue());
+    UNITTEST_ASSERT(store->GetPendingWrites() == 1);
+
+    this_thread::sleep_for(chrono::milliseconds(20));
+
+    UNITTEST_ASSERT(store->FlushDue());
+    UNITTEST_ASSERT(store->GetPendingWrites() == 0);
+    UNITTEST_ASSERT(!store->FlushDue());
+
+    // pending writes are dropped by loading other content
+    {
+      auto other = CreateEmptyStore(Store::InMemoryFileName);
+
+      other->Create(L"Status.Value1", 100);
+      other->SaveTo(DefaultDatabaseFileName + L".load");
+
+      store->Set(L"Status.Value1", 50);
+
+      UNITTEST_ASSERT(store->GetPendingWrites() == 1);
+
+      store->LoadFrom(DefaultDatabaseFileName + L".load");
+
+      UNITTEST_ASSERT(store->GetPendingWrites() == 0);
+      UNITTEST_ASSERT(store->GetInteger(L"Status.Value1") == 100);
+
+      boost::filesystem::remove(DefaultDatabaseFileName + L".load");
+    }
+
+    // destructor flushes
+    store->Set(L"Status.Value1", 7);
+    store->DisableWriteBack();
+
+    UNITTEST_ASSERT(reader.GetInteger(L"Status.Value1") == 7);
+
+    store->EnableWriteBack(L"Status", policy);
+    store->Set(L"Status.Value1", 8);
+    store.reset();
+
+    UNITTEST_ASSERT(reader.GetInteger(L"Status.Value1") == 8);
+  }
+
+  void TestExpiry()
+  {
+    auto store = CreateEmptyStore(Store::InMemoryFileName, Store::DefaultNameDelimiter, Store::Options());
+
+    store->Create(L"Lease.Expired.Child", 1);
+    store->Create(L"Lease.Later", 2);
+    store->Create(L"Lease.Never", 3);
+
+    Store::TimePoint expires;
+
+    UNITTEST_ASSERT(!store->GetExpiry(L"Lease.Later", expires));
+
+    auto revision = store->GetRevision(L"Lease.Expired");
+    auto later = chrono::system_clock::now() + chrono::hours(1);
+
+    store->SetExpiry(L"Lease.Expired", chrono::system_clock::now() - chrono::seconds(1));
+    store->SetExpiry(L"Lease.Later", later);
+
+    UNITTEST_ASSERT(store->GetExpiry(L"Lease.Later", expires));
+    UNITTEST_ASSERT(chrono::duration_cast<chrono::milliseconds>(expires - later).count() == 0);
+
+    // lazy expiry on read
+    UNITTEST_ASSERT(!store->Exists(L"Lease.Expired"));
+    UNITTEST_ASSERT(!store->Exists(L"Lease.Expired.Child"));
+    UNITTEST_ASSERT_THROWS(store->GetInteger(L"Lease.Expired.Child"), EntryNotFound);
+    UNITTEST_ASSERT_THROWS(store->GetRevision(L"Lease.Expired"), EntryNotFound);
+    UNITTEST_ASSERT(store->GetChildren(L"Lease").size() == 2);
+    UNITTEST_ASSERT(store->GetInteger(L"Lease.Later") == 2);
+
+    // the name of an expired entry can be reused right away
+    store->Create(L"Lease.Expired", 4);
+
+    UNITTEST_ASSERT(store->GetInteger(L"Lease.Expired") == 4);
+    UNITTEST_ASSERT(!store->HasChild(L"Lease.Expired"));
+    UNITTEST_ASSERT(!store->GetExpiry(L"Lease.Expired", expires));
+    UNITTEST_ASSERT(store->GetRevision(L"Lease.Expired") != revision);
+
+    store->CheckDataConsistency();
+
+    // expired children do not prevent a non-recursive delete
+    store->Create(L"Lease.Parent.Child", 1);
+    store->SetTimeToLive(L"Lease.Parent.Child", chrono::milliseconds(-1));
+
+    UNITTEST_ASSERT(!store->HasChild(L"Lease.Parent"));
+    UNITTEST_ASSERT_NO_EXCEPTION(store->Delete(L"Lease.Parent", false));
+
+    store->CheckDataConsistency();
+
+    // clear expiry
+    store->SetTimeToLive(L"Lease.Never", chrono::milliseconds(10));
+    store->ClearExpiry(L"Lease.Never");
+
+    this_thread::sleep_for(chrono::milliseconds(20));
+
+    UNITTEST_ASSERT(store->Exists(L"Lease.Never"));
+
+    // sweeper
+    UNITTEST_ASSERT(store->ExpireDue() == 0);
+
+    store->Create(L"Lease.Sweep.Value9.Child", 1);
+    store->SetExpiry(L"Lease.Sweep.Value9.Child", chrono::system_clock::now() - chrono::milliseconds(100));
+
+    for (int i = 0; i < 10; i++)
+    {
+      auto name = (boost::wformat(L"Lease.Sweep.Value%1%") % i).str();
+
+      store->SetOrCreate(name, i);
+      store->SetExpiry(name, chrono::system_clock::now() - chrono::seconds(10 - i));
+    }
+
+    auto parentRevision = store->GetRevision(L"Lease.Sweep");
+
+    UNITTEST_ASSERT(store->ExpireDue(2) == 2);
+    UNITTEST_ASSERT(store->GetRevision(L"Lease.Sweep") != parentRevision);
+    UNITTEST_ASSERT(store->ExpireDue(3) == 3);
+    UNITTEST_ASSERT(store->ExpireDue() == 5);  // the child expired last and is gone with its parent already
+    UNITTEST_ASSERT(store->ExpireDue() == 0);
+    UNITTEST_ASSERT(!store->HasChild(L"Lease.Sweep"));
+    UNITTEST_ASSERT(store->Exists(L"Lease.Later"));
+
+    store->CheckDataConsistency();
+
+    // children cache notices expiring children
+    {
+      Store::Options options;
+
+      options.ChildrenCacheSize = 10;
+
+      auto cached = CreateEmptyStore(Store::InMemoryFileName, Store::DefaultNameDelimiter, options);
+
+      cached->Create(L"Lease.Short", 1);
+      cached->Create(L"Lease.Long", 1);
+      cached->SetTimeToLive(L"Lease.Short", chrono::milliseconds(50));
+
+      UNITTEST_ASSERT(cached->GetSharedChildren(L"Lease")->size() == 2);
+
+      this_thread::sleep_for(chrono::milliseconds(100));
+
+      UNITTEST_ASSERT(cached->GetSharedChildren(L"Lease")->size() == 1);
+    }
+
+    // upgrade of a version 1.0 database
+    {
+      auto fileStore = CreateEmptyStore(DefaultDatabaseFileName);
+
+      fileStore->Create(L"Upgrade.Value", 1);
+
+      Configuration::UnitTest::Detail::PrivateAccess::DowngradeDatabase(*fileStore, 0);
+    }
+
+    // loading it upgrades the copy only, the source file is not written
+    {
+      auto loaded = CreateEmptyStore(Store::InMemoryFileName);
+
+      loaded->LoadFrom(DefaultDatabaseFileName);
+
+      UNITTEST_ASSERT(Configuration::UnitTest::Detail::PrivateAccess::GetDatabaseMinorVersion(*loaded) == 6);
+      UNITTEST_ASSERT(loaded->GetInteger(L"Upgrade.Value") == 1);
+      UNITTEST_ASSERT_NO_EXCEPTION(loaded->CheckDataConsistency());
+
+      SQLite::Database source(WcharToUTF8(DefaultDatabaseFileName), SQLITE_OPEN_READONLY);
+      SQLite::Statement version(source, "SELECT Value FROM Settings WHERE Name = 'MinorVersion'");
+
+      UNITTEST_ASSERT(version.executeStep() && (version.getColumn(0).getInt64() == 0));
+    }
+
+    Store upgraded(DefaultDatabaseFileName);
+
+    UNITTEST_ASSERT(Configuration::UnitTest::Detail::PrivateAccess::GetDatabaseMinorVersion(upgraded) == 6);
+    UNITTEST_ASSERT(upgraded.GetInteger(L"Upgrade.Value") == 1);
+
+    upgraded.SetTimeToLive(L"Upgrade.Value", chrono::milliseconds(-1));
+
+    UNITTEST_ASSERT(!upgraded.Exists(L"Upgrade.Value"));
+    UNITTEST_ASSERT(upgraded.ExpireDue() == 1);
+  }
+
+  void TestHistory()
+  {
+    auto store = CreateEmptyStore(Store::InMemoryFileName, Store::DefaultNameDelimiter, Store::Options());
+
+    store->Create(L"Settings.Name", L"first");
+    store->Create(L"Settings.Size", 1);
+    store->Create(L"Other", 1);
+
+    // no history recorded yet
+    store->Set(L"Settings.Name", L"unrecorded");
+
+    auto initial = chrono::system_clock::now();
+
+    UNITTEST_ASSERT_THROWS(store->GetStringAt(L"Settings.Name", initial), EntryNotFound);
+
+    this_thread::sleep_for(chrono::milliseconds(20));
+
+    store->SetHistoryRetention(3);
+
+    auto nameRevision = store->GetRevision(L"Settings.Name");
+
+    this_thread::sleep_for(chrono::milliseconds(20));
+
+    auto before = chrono::system_clock::now();
+
+    this_thread::sleep_for(chrono::milliseconds(20));
+
+    store->Set(L"Settings.Name", L"second");
+    store->Set(L"Settings.Size", 2);
+    store->Set(L"Other", 2);
+
+    this_thread::sleep_for(chrono::milliseconds(20));
+
+    auto after = chrono::system_clock::now();
+
+    UNITTEST_ASSERT(store->GetStringAt(L"Settings.Name", before) == L"unrecorded");
+    UNITTEST_ASSERT(store->GetStringAt(L"Settings.Name", after) == L"second");
+    UNITTEST_ASSERT(store->GetIntegerAt(L"Settings.Size", before) == 1);
+    UNITTEST_ASSERT(store->GetStringAt(L"Settings.Name", nameRevision) == L"unrecorded");
+    UNITTEST_ASSERT(store->GetStringAt(L"Settings.Name", store->GetRevision(L"Settings.Name")) == L"second");
+    UNITTEST_ASSERT_THROWS(store->GetIntegerAt(L"Settings.Name", before), WrongValueType);
+    UNITTEST_ASSERT_THROWS(store->GetStringAt(L"Settings.Name", store->GetRevision(L"Settings")), EntryNotFound);
+
+    // rollback of a subtree
+    auto revision = store->GetRevision(L"Settings");
+
+    UNITTEST_ASSERT(store->RollbackSubtree(L"Settings", before) == 2);
+    UNITTEST_ASSERT(store->GetString(L"Settings.Name") == L"unrecorded");
+    UNITTEST_ASSERT(store->GetInteger(L"Settings.Size") == 1);
+    UNITTEST_ASSERT(store->GetInteger(L"Other") == 2);
+    UNITTEST_ASSERT(store->GetRevision(L"Settings") != revision);
+
+    // the rollback is recorded as well
+    UNITTEST_ASSERT(store->RollbackSubtree(L"", after) == 2);
+    UNITTEST_ASSERT(store->GetString(L"Settings.Name") == L"second");
+    UNITTEST_ASSERT(store->GetInteger(L"Settings.Size") == 2);
+    UNITTEST_ASSERT(store->RollbackSubtree(L"", chrono::system_clock::now()) == 0);
+
+    // values older than the retained ones are no longer available
+    for (Store::Integer i = 3; i < 8; i++)
+    {
+      store->Set(L"Settings.Size", i);
+    }
+
+    UNITTEST_ASSERT_THROWS(store->GetIntegerAt(L"Settings.Size", before), EntryNotFound);
+    UNITTEST_ASSERT(store->GetIntegerAt(L"Settings.Size", chrono::system_clock::now()) == 7);
+
+    // history is dropped with the entry
+    store->Delete(L"Settings.Size");
+    store->Create(L"Settings.Size", 1);
+
+    UNITTEST_ASSERT(store->GetIntegerAt(L"Settings.Size", before) == 1);
+
+    // the retention is copied along with the content, copies keep recording changes
+    store->SaveTo(DefaultDatabaseFileName);
+
+    {
+      Store saved(DefaultDatabaseFileName);
+
+      saved.Set(L"Other", 3);
+
+      UNITTEST_ASSERT(saved.GetIntegerAt(L"Other", after) == 2);
+    }
+
+    {
+      auto loaded = CreateEmptyStore(Store::InMemoryFileName);
+
+      loaded->LoadFrom(DefaultDatabaseFileName);
+      loaded->Set(L"Other", 4);
+
+      UNITTEST_ASSERT(loaded->GetIntegerAt(L"Other", after) == 2);
+      UNITTEST_ASSERT_THROWS(loaded->GetIntegerAt(L"Other", initial), EntryNotFound);
+    }
+
+    store->SetHistoryRetention(0);
+    store->Set(L"Settings.Name", L"third");
+
+    UNITTEST_ASSERT_THROWS(store->GetStringAt(L"Settings.Name", before), EntryNotFound);
+  }
+
+  void TestContentHash()
+  {
+    auto store = CreateEmptyStore(Store::InMemoryFileName, Store::DefaultNameDelimiter, Store::Options());
+    auto other = CreateEmptyStore(Store::InMemoryFileName, L'/', Store::Options());
+
+    UNITTEST_ASSERT(store->GetContentHash(L"") == other->GetContentHash(L""));
+
+    // order of creation does not matter
+    store->Create(L"App.Name", L"name");
+    store->Create(L"App.Size", 1);
+    store->Create(L"App.Data", Store::Binary({1, 2, 3}));
+    store->Create(L"Removed.Child", 1);
+
+    other->Create(L"App/Data", Store::Binary({1, 2, 3}));
+    other->Create(L"App/Size", 1);
+    other->Create(L"App/Name", L"name");
+    other->Create(L"Added/Child", 1);
+
+    UNITTEST_ASSERT(store->GetContentHash(L"App") == other->GetContentHash(L"App"));
+    UNITTEST_ASSERT(store->GetContentHash(L"") != other->GetContentHash(L""));
+
+    // cached hashes get recomputed after a change
+    auto hash = store->GetContentHash(L"App");
+
+    store->Set(L"App.Size", 2);
+
+    UNITTEST_ASSERT(store->GetContentHash(L"App") != hash);
+    UNITTEST_ASSERT(store->GetContentHash(L"App") != other->GetContentHash(L"App"));
+
+    store->Set(L"App.Size", 1);
+
+    UNITTEST_ASSERT(store->GetContentHash(L"App") == hash);
+
+    // type is part of the hash
+    store->Set(L"App.Size", L"1");
+
+    UNITTEST_ASSERT(store->GetContentHash(L"App") != hash);
+
+    vector<pair<Store::DiffType, Store::String>> differences;
+
+    store->Diff(*other, L"", [&differences](const Store::Difference& difference) { differences.emplace_back(difference.Type, difference.Name); });
+
+    UNITTEST_ASSERT(differences.size() == 5);
+    UNITTEST_ASSERT((differences[0] == make_pair(Store::DiffType::Added, Store::String(L"Added"))));
+    UNITTEST_ASSERT((differences[1] == make_pair(Store::DiffType::Added, Store::String(L"Added.Child"))));
+    UNITTEST_ASSERT((differences[2] == make_pair(Store::DiffType::Changed, Store::String(L"App.Size"))));
+    UNITTEST_ASSERT((differences[3] == make_pair(Store::DiffType::Removed, Store::String(L"Removed"))));
+    UNITTEST_ASSERT((differences[4] == make_pair(Store::DiffType::Removed, Store::String(L"Removed.Child"))));
+
+    differences.clear();
+
+    store->Set(L"App.Size", 1);
+    store->Delete(L"Removed");
+    store->Create(L"Added.Child", 1);
+
+    store->Diff(*other, L"", [&differences](const Store::Difference& difference) { differences.emplace_back(difference.Type, difference.Name); });
+
+    UNITTEST_ASSERT(differences.empty());
+    UNITTEST_ASSERT(store->GetContentHash(L"") == other->GetContentHash(L""));
+
+    // hashes are computed within read-only transactions as well
+    store->Set(L"App.Size", 3);
+
+    {
+      ReadOnlyTransaction transaction(*store);
+
+      UNITTEST_ASSERT(store->GetContentHash(L"") != other->GetContentHash(L""));
+    }
+
+    store->Set(L"App.Size", 1);
+
+    UNITTEST_ASSERT(store->GetContentHash(L"") == other->GetContentHash(L""));
+
+    // expiry times are part of the hash, entries expired in one store only are found by Diff()
+    store->Create(L"Lease.Value", 1);
+    other->Create(L"Lease/Value", 1);
+
+    UNITTEST_ASSERT(store->GetContentHash(L"") == other->GetContentHash(L""));
+
+    store->SetExpiry(L"Lease", chrono::system_clock::now() - chrono::seconds(1));
+
+    UNITTEST_ASSERT(store->GetContentHash(L"") != other->GetContentHash(L""));
+
+    differences.clear();
+
+    store->Diff(*other, L"", [&differences](const Store::Difference& difference) { differences.emplace_back(difference.Type, difference.Name); });
+
+    UNITTEST_ASSERT(differences.size() == 2);
+    UNITTEST_ASSERT((differences[0] == make_pair(Store::DiffType::Added, Store::String(L"Lease"))));
+    UNITTEST_ASSERT((differences[1] == make_pair(Store::DiffType::Added, Store::String(L"Lease.Value"))));
+
+    // hashes computed outside of transactions are stored and survive reopening the store
+    {
+      auto fileStore = CreateEmptyStore(DefaultDatabaseFileName);
+
+      fileStore->Create(L"App.Name", L"name");
+      fileStore->Create(L"App.Size", 1);
+
+      hash = fileStore->GetContentHash(L"");
+
+      UNITTEST_ASSERT(Configuration::UnitTest::Detail::PrivateAccess::HasStoredHash(*fileStore, L""));
+      UNITTEST_ASSERT(Configuration::UnitTest::Detail::PrivateAccess::HasStoredHash(*fileStore, L"App.Size"));
+    }
+
+    Store reopened(DefaultDatabaseFileName);
+
+    UNITTEST_ASSERT(Configuration::UnitTest::Detail::PrivateAccess::HasStoredHash(reopened, L""));
+    UNITTEST_ASSERT(reopened.GetContentHash(L"") == hash);
+
+    reopened.Set(L"App.Size", 2);
+
+    UNITTEST_ASSERT(!Configuration::UnitTest::Detail::PrivateAccess::HasStoredHash(reopened, L""));
+    UNITTEST_ASSERT(Configuration::UnitTest::Detail::PrivateAccess::HasStoredHash(reopened, L"App.Name"));
+  }
+
+  void TestApplyDiff()
+  {
+    auto staging = CreateEmptyStore(Store::InMemoryFileName, L'/', Store::Options());
+    auto production = CreateEmptyStore(Store::InMemoryFileName, Store::DefaultNameDelimiter, Store::Options());
+
+    staging->Create(L"App/Name", L"new");
+    staging->Create(L"App/Size", 1);
+    staging->Create(L"App/Added/Data", Store::Binary({1, 2, 3}));
+    staging->Create(L"App/Type", L"1");
+    staging->Create(L"Other", 1);
+
+    production->Create(L"App.Name", L"old");
+    production->Create(L"App.Size", 1);
+    production->Create(L"App.Removed.Child", 1);
+    production->Create(L"App.Type", 1);
+    production->Create(L"Other", 2);
+
+    vector<Store::Difference> differences;
+
+    production->Diff(*staging, L"App", [&differences](const Store::Difference& difference) { differences.push_back(difference); });
+
+    UNITTEST_ASSERT(differences.size() == 6);
+    UNITTEST_ASSERT((differences[0].Type == Store::DiffType::Added) && (differences[0].Name == L"App.Added"));
+    UNITTEST_ASSERT((differences[1].Type == Store::DiffType::Added) && (differences[1].Name == L"App.Added.Data"));
+    UNITTEST_ASSERT(differences[1].BinaryValue == Store::Binary({1, 2, 3}));
+    UNITTEST_ASSERT((differences[2].Type == Store::DiffType::Changed) && (differences[2].Name == L"App.Name"));
+    UNITTEST_ASSERT(differences[2].StringValue == L"new");
+    UNITTEST_ASSERT((differences[3].Type == Store::DiffType::Removed) && (differences[3].Name == L"App.Removed"));
+    UNITTEST_ASSERT((differences[4].Type == Store::DiffType::Removed) && (differences[4].Name == L"App.Removed.Child"));
+    UNITTEST_ASSERT((differences[5].Type == Store::DiffType::Changed) && (differences[5].Name == L"App.Type"));
+    UNITTEST_ASSERT(differences[5].EntryType == Store::ValueType::String);
+
+    UNITTEST_ASSERT(production->ApplyDiff(differences));
+    UNITTEST_ASSERT(production->GetContentHash(L"App") == staging->GetContentHash(L"App"));
+    UNITTEST_ASSERT(production->GetInteger(L"Other") == 2);
+
+    // whole store
+    differences.clear();
+
+    production->Diff(*staging, L"", [&differences](const Store::Difference& difference) { differences.push_back(difference); });
+
+    UNITTEST_ASSERT(differences.size() == 1);
+    UNITTEST_ASSERT((differences[0].Type == Store::DiffType::Changed) && (differences[0].Name == L"Other"));
+    UNITTEST_ASSERT(production->ApplyDiff(differences));
+    UNITTEST_ASSERT(production->GetContentHash(L"") == staging->GetContentHash(L""));
+
+    // subtree is a name of this store, also if the other store uses another delimiter
+    staging->Set(L"App/Added/Data", Store::Binary({4}));
+    differences.clear();
+
+    production->Diff(*staging, L"App.Added", [&differences](const Store::Difference& difference) { differences.push_back(difference); });
+
+    UNITTEST_ASSERT(differences.size() == 1);
+    UNITTEST_ASSERT((differences[0].Type == Store::DiffType::Changed) && (differences[0].Name == L"App.Added.Data"));
+
+    UNITTEST_ASSERT_THROWS(production->Diff(*staging, L"Missing", [](const Store::Difference&) {}), EntryNotFound);
+  }
+
+  void TestJson()
+  {
+    auto store = CreateEmptyStore(Store::InMemoryFileName, Store::DefaultNameDelimiter, Store::Options());
+
+    {
+      istringstream input("{ \"App\": { \"Name\": \"name \\\"\\u00e4\\ud83d\\ude00\\\"\", \"Size\": -42, \"Enabled\": true, \"Data\": \"base64:AQID\",\n"
+                          "           \"List\": [1, \"two\", {}], \"Empty\": {}, \"Null\": null },\n"
+                          "  \"Top\": 9223372036854775807 }");
+
+      UNITTEST_ASSERT(ImportJson(*store, L"", input, 2) == 10);
+    }
+
+    // UTF-8 of "name \"<a umlaut><grinning face>\""
+    static const string name = "name \\\"\xC3\xA4\xF0\x9F\x98\x80\\\"";
+
+    UNITTEST_ASSERT(store->GetString(L"App.Name") == UTF8ToWchar("name \"\xC3\xA4\xF0\x9F\x98\x80\""));
+    UNITTEST_ASSERT(store->GetInteger(L"App.Size") == -42);
+    UNITTEST_ASSERT(store->GetInteger(L"App.Enabled") == 1);
+    UNITTEST_ASSERT(store->GetBinary(L"App.Data") == Store::Binary({1, 2, 3}));
+    UNITTEST_ASSERT(store->GetInteger(L"App.List.0") == 1);
+    UNITTEST_ASSERT(store->GetString(L"App.List.1") == L"two");
+    UNITTEST_ASSERT(store->GetInteger(L"App.List.2") == 0);
+    UNITTEST_ASSERT(store->Exists(L"App.Empty") && !store->HasChild(L"App.Empty"));
+    UNITTEST_ASSERT(store->GetInteger(L"App.Null") == 0);
+    UNITTEST_ASSERT(store->GetInteger(L"Top") == numeric_limits<Store::Integer>::max());
+
+    // export and import again into another subtree
+    ostringstream output;
+
+    ExportJson(*store, L"App", output);
+
+    UNITTEST_ASSERT(output.str() == "{\"Data\":\"base64:AQID\",\"Empty\":0,\"Enabled\":1,\"List\":{\"0\":1,\"1\":\"two\",\"2\":0},\"Name\":\"" + name + "\",\"Null\":0,\"Size\":-42}");
+
+    {
+      istringstream input(output.str());
+
+      UNITTEST_ASSERT(ImportJson(*store, L"Copy", input) == 9);
+    }
+
+    UNITTEST_ASSERT(store->GetString(L"Copy.Name") == store->GetString(L"App.Name"));
+    UNITTEST_ASSERT(store->GetBinary(L"Copy.Data") == Store::Binary({1, 2, 3}));
+
+    // strings looking like binaries are escaped
+    store->Create(L"Strings.Binary", L"base64:AQID");
+    store->Create(L"Strings.Escaped", L"string:text");
+
+    output.str("");
+
+    ExportJson(*store, L"Strings", output);
+
+    UNITTEST_ASSERT(output.str() == "{\"Binary\":\"string:base64:AQID\",\"Escaped\":\"string:string:text\"}");
+
+    {
+      istringstream input(output.str());
+
+      UNITTEST_ASSERT(ImportJson(*store, L"Strings", input) == 2);
+    }
+
+    UNITTEST_ASSERT(store->GetString(L"Strings.Binary") == L"base64:AQID");
+    UNITTEST_ASSERT(store->GetString(L"Strings.Escaped") == L"string:text");
+
+    // malformed input imports nothing
+    for (const auto& json : { "{\"Bad\": 1, }", "{\"Bad\": 1.5}", "{\"Bad\": 9223372036854775808}", "{\"Bad\": \"base64:A\"}", "{\"Bad\": 012}", "{\"Bad\": -00}",
+                              "[1]", "{} 1" })
+    {
+      istringstream input(json);
+
+      UNITTEST_ASSERT_THROWS(ImportJson(*store, L"", input), InvalidJson);
+      UNITTEST_ASSERT(!store->Exists(L"Bad"));
+    }
+  }
+
+  void TestParallelJson()
+  {
+    auto store = CreateEmptyStore(DefaultDatabaseFileName);
+
+    string json = "{";
+
+    for (int i = 0; i < 50; i++)
+    {
+      json += (boost::format("%1%\"Node%2%\": { \"Name\": \"node %2%\", \"Data\": \"base64:AQID\", \"List\": [") % ((i > 0) ? "," : "") % i).str();
+
+      for (int j = 0; j < 20; j++)
+      {
+        json += (boost::format("%1%%2%") % ((j > 0) ? "," : "") % (i * j)).str();
+      }
+
+      json += "] }";
+    }
+
+    json += "}";
+
+    {
+      istringstream input(json);
+
+      UNITTEST_ASSERT(ImportJson(*store, L"", input, 7, 3) == 50 * 22);
+    }
+
+    UNITTEST_ASSERT(store->GetString(L"Node42.Name") == L"node 42");
+    UNITTEST_ASSERT(store->GetBinary(L"Node42.Data") == Store::Binary({1, 2, 3}));
+    UNITTEST_ASSERT(store->GetInteger(L"Node42.List.19") == 42 * 19);
+
+    // same output as the sequential export
+    ostringstream expected;
+
+    ExportJson(*store, L"", expected);
+
+    for (size_t threads : { 2, 4, 0 })
+    {
+      ostringstream output;
+
+      ExportJson(*store, L"", output, threads);
+      UNITTEST_ASSERT(output.str() == expected.str());
+    }
+
+    {
+      ostringstream output;
+
+      ExportJson(*store, L"Node7.Name", output, 4);
+      UNITTEST_ASSERT(output.str() == "\"node 7\"");
+    }
+
+    // a writer waiting to commit neither deadlocks with the export nor makes its threads see different states: every commit
+    // adds a value to both children, which are exported by different threads
+    {
+      store->Create(L"Pair1.Value0", 0);
+      store->Create(L"Pair2.Value0", 0);
+
+      atomic<bool> stop(false);
+      atomic<bool> failed(false);
+      atomic<int>  commits(0);
+
+      thread committer([&]()
+      {
+        try
+        {
+          Store other(DefaultDatabaseFileName);
+
+          for (int i = 1; !stop; i++)
+          {
+            WriteableTransaction transaction(other);
+
+            other.Create((boost::wformat(L"Pair1.Value%1%") % i).str(), static_cast<Store::Integer>(i));
+            other.Create((boost::wformat(L"Pair2.Value%1%") % i).str(), static_cast<Store::Integer>(i));
+
+            transaction.Commit();
+            commits++;
+
+            this_thread::sleep_for(chrono::milliseconds(1));
+          }
+        }
+        catch (...)
+        {
+          failed = true;
+        }
+      });
+
+      // failed assertions throw, the committer must not outlive its locals
+      auto finish = [&]()
+      {
+        stop = true;
+        committer.join();
+      };
+
+      try
+      {
+        for (int i = 0; i < 20; i++)
+        {
+          ostringstream output;
+
+          UNITTEST_ASSERT_NO_EXCEPTION(ExportJson(*store, L"", output, 4));
+
+          auto text = output.str();
+          auto pair1 = text.find("\"Pair1\":");
+          auto pair2 = text.find("\"Pair2\":");
+
+          UNITTEST_ASSERT((pair1 != string::npos) && (pair2 != string::npos));
+
+          auto count = [&](size_t from, size_t to)
+          {
+            size_t values = 0;
+
+            for (auto pos = text.find("\"Value", from); pos < to; pos = text.find("\"Value", pos + 1))
+            {
+              values++;
+            }
+
+            return values;
+          };
+
+          UNITTEST_ASSERT(count(pair1, pair2) == count(pair2, text.size()));
+        }
+      }
+      catch (...)
+      {
+        finish();
+        throw;
+      }
+
+      finish();
+
+      UNITTEST_ASSERT(!failed);
+      UNITTEST_ASSERT(commits > 0);
+
+      store->Delete(L"Pair1");
+      store->Delete(L"Pair2");
+    }
+
+    // uncommitted changes and pending writes are exported by the calling thread, the other Store objects would not see them
+    {
+      WriteableTransaction transaction(*store);
+
+      store->Set(L"Node7.Name", L"uncommitted");
+
+      ostringstream output;
+
+      ExportJson(*store, L"Node7", output, 4);
+      UNITTEST_ASSERT(output.str().find("uncommitted") != string::npos);
+    }
+
+    {
+      Store::WriteBackPolicy policy;
+
+      policy.MaxPendingTime = chrono::hours(1);
+
+      store->EnableWriteBack(L"Node7", policy);
+      store->Set(L"Node7.Name", L"pending");
+
+      ostringstream output;
+
+      ExportJson(*store, L"Node7", output, 4);
+      UNITTEST_ASSERT(output.str().find("pending") != string::npos);
+
+      store->DisableWriteBack();
+      store->Set(L"Node7.Name", L"node 7");
+    }
+
+    // malformed input and invalid names import nothing
+    for (const auto& bad : { "{\"Bad\": 1, \"More\": [1, 2, }", "{\"Bad\": \"base64:A\"}" })
+    {
+      istringstream input(bad);
+
+      UNITTEST_ASSERT_THROWS(ImportJson(*store, L"", input, 1, 2), InvalidJson);
+      UNITTEST_ASSERT(!store->Exists(L"Bad"));
+    }
+
+    {
+      istringstream input("{\"Bad\": 1, \"Invalid..Name\": 2}");
+
+      UNITTEST_ASSERT_THROWS(ImportJson(*store, L"", input, 1, 2), InvalidName);
+      UNITTEST_ASSERT(!store->Exists(L"Bad"));
+    }
+
+    // private in-memory stores are exported by the calling thread
+    auto memory = CreateEmptyStore(Store::InMemoryFileName, Store::DefaultNameDelimiter, Store::Options());
+
+    {
+      istringstream input(json);
+
+      UNITTEST_ASSERT(ImportJson(*memory, L"", input, 10000, 0) == 50 * 22);
+    }
+
+    ostringstream output;
+
+    ExportJson(*memory, L"", output, 4);
+    UNITTEST_ASSERT(output.str() == expected.str());
+  }
+
+  void TestParallelCheck()
+  {
+    auto store = CreateEmptyStore(DefaultDatabaseFileName);
+
+    {
+      WriteableTransaction transaction(*store);
+
+      for (int i = 0; i < 100; i++)
+      {
+        for (int j = 0; j < 10; j++)
+        {
+          store->Create((boost::wformat(L"Node%1%.Leaf%2%") % i % j).str(), static_cast<Store::Integer>(j));
+        }
+      }
+
+      transaction.Commit();
+    }
+
+    UNITTEST_ASSERT_NO_EXCEPTION(store->CheckDataConsistency(4));
+    UNITTEST_ASSERT_NO_EXCEPTION(store->CheckDataConsistency(0));
+    UNITTEST_ASSERT_NO_EXCEPTION(store->CheckDataConsistency(1000));
+
+    // uncommitted changes are not visible to other connections, the check runs on the calling thread
+    {
+      WriteableTransaction transaction(*store);
+
+      store->Create(L"Uncommitted.Leaf", 1);
+
+      UNITTEST_ASSERT_NO_EXCEPTION(store->CheckDataConsistency(4));
+    }
+
+    // corrupt the store behind its back, both the sequential and the parallel check find it
+    Configuration::UnitTest::Detail::PrivateAccess::ExecuteSql(*store, "UPDATE Entries SET Name = 'Bad.Name' WHERE Id = (SELECT MAX(Id) FROM Entries)");
+    UNITTEST_ASSERT_THROWS(store->CheckDataConsistency(4), InvalidEntryNameFound);
+    UNITTEST_ASSERT_THROWS(store->CheckDataConsistency(1), InvalidEntryNameFound);
+    Configuration::UnitTest::Detail::PrivateAccess::ExecuteSql(*store, "UPDATE Entries SET Name = '' WHERE Name = 'Bad.Name'");
+    UNITTEST_ASSERT_THROWS(store->CheckDataConsistency(4), InvalidEntryNameFound);
+    UNITTEST_ASSERT_THROWS(store->CheckDataConsistency(1), InvalidEntryNameFound);
+    Configuration::UnitTest::Detail::PrivateAccess::ExecuteSql(*store, "UPDATE Entries SET Name = 'Leaf9' WHERE Id = (SELECT MAX(Id) FROM Entries)");
+
+    Configuration::UnitTest::Detail::PrivateAccess::ExecuteSql(*store, "UPDATE Entries SET Type = 7 WHERE Id = (SELECT MAX(Id) FROM Entries)");
+    UNITTEST_ASSERT_THROWS(store->CheckDataConsistency(4), UnknownEntryType);
+    UNITTEST_ASSERT_THROWS(store->CheckDataConsistency(1), UnknownEntryType);
+    Configuration::UnitTest::Detail::PrivateAccess::ExecuteSql(*store, "UPDATE Entries SET Type = 1 WHERE Id = (SELECT MAX(Id) FROM Entries)");
+
+    Configuration::UnitTest::Detail::PrivateAccess::ExecuteSql(*store, "UPDATE Entries SET Parent = -1 WHERE Id = (SELECT MAX(Id) FROM Entries)");
+    UNITTEST_ASSERT_THROWS(store->CheckDataConsistency(4), AbandonedEntry);
+    UNITTEST_ASSERT_THROWS(store->CheckDataConsistency(1), AbandonedEntry);
+    Configuration::UnitTest::Detail::PrivateAccess::ExecuteSql(*store, "UPDATE Entries SET Parent = (SELECT Id FROM Entries WHERE Name = 'Node99' AND Parent = 0) WHERE Id = (SELECT MAX(Id) FROM Entries)");
+
+    UNITTEST_ASSERT_NO_EXCEPTION(store->CheckDataConsistency(4));
+
+    // a writer waiting to commit neither deadlocks with the check nor makes its threads see different states
+    atomic<bool> stop(false);
+    atomic<bool> failed(false);
+    atomic<int>  commits(0);
+
+    thread committer([&]()
+    {
+      try
+      {
+        Store other(DefaultDatabaseFileName);
+
+        for (int i = 0; !stop; i++)
+        {
+          other.Create((boost::wformat(L"Node%1%.Committed%2%") % (i % 100) % i).str(), static_cast<Store::Integer>(i));
+          commits++;
+
+          this_thread::sleep_for(chrono::milliseconds(1));
+        }
+      }
+      catch (...)
+      {
+        failed = true;
+      }
+    });
+
+    // failed assertions throw, the committer must not outlive its locals
+    auto finish = [&]()
+    {
+      stop = true;
+      committer.join();
+    };
+
+    try
+    {
+      for (int i = 0; i < 20; i++)
+      {
+        UNITTEST_ASSERT_NO_EXCEPTION(store->CheckDataConsistency(4));
+      }
+    }
+    catch (...)
+    {
+      finish();
+      throw;
+    }
+
+    finish();
+
+    UNITTEST_ASSERT(!failed);
+    UNITTEST_ASSERT(commits > 0);
+  }
+
+  void TestHashNameLookup()
+  {
+    Store::Options options;
+
+    options.HashNameLookup = true;
+
+    // entries created without hash lookup are found with it and vice versa
+    {
+      auto fileStore = CreateEmptyStore(DefaultDatabaseFileName);
+
+      fileStore->Create(L"Plain.Deep.Path.Value", 1);
+      fileStore->Create(L"Plain.Other", L"text");
+    }
+
+    {
+      Store store(DefaultDatabaseFileName, false, Store::DefaultNameDelimiter, options);
+
+      UNITTEST_ASSERT(store.GetInteger(L"Plain.Deep.Path.Value") == 1);
+      UNITTEST_ASSERT(store.GetString(L"Plain.Other") == L"text");
+      UNITTEST_ASSERT(!store.Exists(L"Plain.Missing"));
+      UNITTEST_ASSERT(!store.Exists(L"Deep"));
+
+      store.Create(L"Hashed.Value", 2);
+      store.SetOrCreate(L"Plain.Deep.Path.Value", 3);
+
+      WriteBatch batch(store);
+
+      batch.SetOrCreate(L"Hashed.Batch.Value", 4);
+      batch.Set(L"Plain.Other", L"changed");
+
+      UNITTEST_ASSERT(batch.Apply());
+
+      store.CheckDataConsistency();
+    }
+
+    {
+      Store store(DefaultDatabaseFileName);
+
+      UNITTEST_ASSERT(store.GetInteger(L"Hashed.Value") == 2);
+      UNITTEST_ASSERT(store.GetInteger(L"Hashed.Batch.Value") == 4);
+      UNITTEST_ASSERT(store.GetInteger(L"Plain.Deep.Path.Value") == 3);
+      UNITTEST_ASSERT(store.GetString(L"Plain.Other") == L"changed");
+
+      // entries of a version 1.3 database get their hashes on upgrade
+      Configuration::UnitTest::Detail::PrivateAccess::DowngradeDatabase(store, 3);
+    }
+
+    Store upgraded(DefaultDatabaseFileName, false, Store::DefaultNameDelimiter, options);
+
+    UNITTEST_ASSERT(Configuration::UnitTest::Detail::PrivateAccess::GetDatabaseMinorVersion(upgraded) == 6);
+    UNITTEST_ASSERT(upgraded.GetInteger(L"Plain.Deep.Path.Value") == 3);
+    UNITTEST_ASSERT(upgraded.GetInteger(L"Hashed.Batch.Value") == 4);
+
+    // same name below different parents
+    upgraded.Create(L"A.Name", 1);
+    upgraded.Create(L"B.Name", 2);
+
+    UNITTEST_ASSERT(upgraded.GetInteger(L"A.Name") == 1);
+    UNITTEST_ASSERT(upgraded.GetInteger(L"B.Name") == 2);
+  }
+
+  void TestFullPaths()
+  {
+    {
+      auto store = CreateEmptyStore(DefaultDatabaseFileName);
+
+      store->Create(L"Plain.Deep.Path.Value", 1);
+      store->Create(L"Plain.Other", L"text");
+
+      UNITTEST_ASSERT(!store->IsFullPathMode());
+
+      store->SetFullPathMode(true);
+
+      UNITTEST_ASSERT(store->IsFullPathMode());
+      UNITTEST_ASSERT(store->GetInteger(L"Plain.Deep.Path.Value") == 1);
+      UNITTEST_ASSERT(store->GetString(L"Plain.Other") == L"text");
+      UNITTEST_ASSERT(!store->Exists(L"Plain.Deep.Missing"));
+      UNITTEST_ASSERT(!store->Exists(L"Deep.Path"));
+
+      // entries created in full path mode, incl. missing parents
+      store->Create(L"Plain.Deep.New.Value", 2);
+      store->SetOrCreate(L"Other.Value", 3);
+
+      WriteBatch batch(*store);
+
+      batch.SetOrCreate(L"Batch.Deep.Value", 4);
+      batch.Set(L"Plain.Other", L"changed");
+
+      UNITTEST_ASSERT(batch.Apply());
+
+      UNITTEST_ASSERT(store->GetInteger(L"Plain.Deep.New.Value") == 2);
+      UNITTEST_ASSERT(store->GetInteger(L"Other.Value") == 3);
+      UNITTEST_ASSERT(store->GetInteger(L"Batch.Deep.Value") == 4);
+      UNITTEST_ASSERT(store->GetString(L"Plain.Other") == L"changed");
+      UNITTEST_ASSERT_THROWS(store->Create(L"Plain.Deep.New.Value", 5), NameAlreadyExists);
+
+      // an expired ancestor hides the whole path
+      store->Create(L"Lease.Value", 5);
+      store->SetExpiry(L"Lease", chrono::system_clock::now() - chrono::seconds(1));
+
+      UNITTEST_ASSERT(!store->Exists(L"Lease.Value"));
+      UNITTEST_ASSERT_THROWS(store->GetInteger(L"Lease.Value"), EntryNotFound);
+
+      store->ExpireDue();
+      store->Create(L"Lease.Value", 6);
+
+      UNITTEST_ASSERT(store->GetInteger(L"Lease.Value") == 6);
+
+      // only expired entries on the path hide it, not ones sharing a prefix of the name
+      store->Create(L"Plain.Oth", 1);
+      store->Create(L"Plai", 1);
+      store->SetExpiry(L"Plain.Oth", chrono::system_clock::now() - chrono::seconds(1));
+      store->SetExpiry(L"Plai", chrono::system_clock::now() - chrono::seconds(1));
+
+      UNITTEST_ASSERT(store->GetString(L"Plain.Other") == L"changed");
+      UNITTEST_ASSERT(!store->Exists(L"Plain.Oth"));
+
+      store->ExpireDue();
+      store->Delete(L"Plain.Deep");
+
+      UNITTEST_ASSERT(!store->Exists(L"Plain.Deep.Path.Value"));
+      UNITTEST_ASSERT(store->Exists(L"Plain.Other"));
+
+      store->CheckDataConsistency();
+    }
+
+    // mode is kept by the store and picked up by Store objects already open on it
+    {
+      Store other(DefaultDatabaseFileName);
+
+      other.SetFullPathMode(false);
+
+      Store store(DefaultDatabaseFileName);
+
+      UNITTEST_ASSERT(!store.IsFullPathMode());
+
+      other.SetFullPathMode(true);
+      store.Create(L"Switched.On", 2);
+
+      UNITTEST_ASSERT(store.IsFullPathMode());
+      UNITTEST_ASSERT(!Configuration::UnitTest::Detail::PrivateAccess::HasMissingFullPaths(store));
+      UNITTEST_ASSERT(store.GetInteger(L"Switched.On") == 2);
+
+      store.Delete(L"Switched");
+    }
+
+    // full names follow a new delimiter
+    {
+      Store store(DefaultDatabaseFileName);
+
+      UNITTEST_ASSERT(store.IsFullPathMode());
+
+      Configuration::UnitTest::Detail::PrivateAccess::SetNewDelimiter(store, L'/');
+
+      UNITTEST_ASSERT(store.GetInteger(L"Batch/Deep/Value") == 4);
+      UNITTEST_ASSERT(!store.Exists(L"Batch.Deep.Value"));
+
+      store.Create(L"Batch/Deep/Other", 7);
+
+      UNITTEST_ASSERT(store.GetInteger(L"Batch/Deep/Other") == 7);
+
+      // entries without full name, e.g. created by an older version, are still found and get their full name on next open
+      Configuration::UnitTest::Detail::PrivateAccess::ExecuteSql(store, "UPDATE Entries SET FullPath = NULL WHERE Name = 'Deep'");
+
+      UNITTEST_ASSERT(store.GetInteger(L"Batch/Deep/Value") == 4);
+    }
+
+    {
+      Store store(DefaultDatabaseFileName, false, L'/');
+
+      UNITTEST_ASSERT(store.GetInteger(L"Batch/Deep/Value") == 4);
+      UNITTEST_ASSERT(store.GetInteger(L"Batch/Deep/Other") == 7);
+
+      store.SetFullPathMode(false);
+
+      UNITTEST_ASSERT(!store.IsFullPathMode());
+      UNITTEST_ASSERT(store.GetInteger(L"Batch/Deep/Value") == 4);
+    }
+
+    {
+      Store store(DefaultDatabaseFileName, false, L'/');
+
+      UNITTEST_ASSERT(!store.IsFullPathMode());
+      UNITTEST_ASSERT(store.GetString(L"Plain/Other") == L"changed");
+    }
+
+    // rollback of a subtree reads it by a range of full names, entries sharing a prefix of the name are not part of it
+    auto store = CreateEmptyStore(Store::InMemoryFileName, Store::DefaultNameDelimiter, Store::Options());
+
+    store->SetFullPathMode(true);
+    store->Create(L"Settings.Name", L"first");
+    store->Create(L"Settings.Deep.Size", 1);
+    store->Create(L"SettingsOther", 1);
+    store->SetHistoryRetention(3);
+
+    this_thread::sleep_for(chrono::milliseconds(20));
+
+    auto before = chrono::system_clock::now();
+
+    this_thread::sleep_for(chrono::milliseconds(20));
+
+    store->Set(L"Settings.Name", L"second");
+    store->Set(L"Settings.Deep.Size", 2);
+    store->Set(L"SettingsOther", 2);
+
+    UNITTEST_ASSERT(store->RollbackSubtree(L"Settings", before) == 2);
+    UNITTEST_ASSERT(store->GetString(L"Settings.Name") == L"first");
+    UNITTEST_ASSERT(store->GetInteger(L"Settings.Deep.Size") == 1);
+    UNITTEST_ASSERT(store->GetInteger(L"SettingsOther") == 2);
+
+    // entries without full name are not part of any range, the subtree is read entry by entry then
+    auto after = chrono::system_clock::now();
+
+    this_thread::sleep_for(chrono::milliseconds(20));
+
+    store->Set(L"Settings.Deep.Size", 3);
+    Configuration::UnitTest::Detail::PrivateAccess::ExecuteSql(*store, "UPDATE Entries SET FullPath = NULL WHERE Name = 'Size'");
+
+    UNITTEST_ASSERT(store->GetInteger(L"Settings.Deep.Size") == 3);
+    UNITTEST_ASSERT(store->RollbackSubtree(L"Settings", after) == 1);
+    UNITTEST_ASSERT(store->GetInteger(L"Settings.Deep.Size") == 1);
+  }
+
+  void TestSubtreeIndex()
+  {
+    auto sorted = [](Store::Children children) { sort(begin(children), end(children)); return children; };
+
+    auto store = CreateEmptyStore(DefaultDatabaseFileName);
+
+    store->Create(L"A.B.C1.X", 1);
+    store->Create(L"A.B.C2", 2);
+    store->Create(L"A.D", 3);
+    store->Create(L"E", 4);
+
+    // opened before the index is created, uses it from its next transaction on
+    Store plain(DefaultDatabaseFileName);
+
+    UNITTEST_ASSERT(!store->HasSubtreeIndex());
+    UNITTEST_ASSERT(store->CountDescendants(L"") == 7);
+    UNITTEST_ASSERT(store->CountDescendants(L"A") == 5);
+    UNITTEST_ASSERT(store->CountDescendants(L"E") == 0);
+    UNITTEST_ASSERT(sorted(store->GetSubtree(L"A")) == Store::Children({ L"B", L"B.C1", L"B.C1.X", L"B.C2", L"D" }));
+    UNITTEST_ASSERT(store->GetSubtree(L"A.B.C2").empty());
+    UNITTEST_ASSERT_THROWS(store->CountDescendants(L"Missing"), EntryNotFound);
+
+    store->SetSubtreeIndex(true);
+
+    UNITTEST_ASSERT(store->HasSubtreeIndex());
+    UNITTEST_ASSERT(!plain.HasSubtreeIndex());
+    UNITTEST_ASSERT(plain.CountDescendants(L"A") == 5);
+    UNITTEST_ASSERT(plain.HasSubtreeIndex());
+
+    // parents before their children
+    auto subtree = store->GetSubtree(L"");
+
+    UNITTEST_ASSERT(subtree.size() == 7);
+    UNITTEST_ASSERT(find(begin(subtree), end(subtree), L"A.B") < find(begin(subtree), end(subtree), L"A.B.C1"));
+    UNITTEST_ASSERT(find(begin(subtree), end(subtree), L"A.B.C1") < find(begin(subtree), end(subtree), L"A.B.C1.X"));
+
+    // maintained for entries created or deleted by any Store object
+    store->Create(L"A.B.C1.Y", 5);
+    plain.Create(L"A.F.G", 6);
+
+    WriteBatch batch(*store);
+
+    batch.Create(L"H.I", 7);
+    UNITTEST_ASSERT(batch.Apply());
+
+    auto compare = [&](const Store::String& name)
+    {
+      UNITTEST_ASSERT(store->CountDescendants(name) == plain.CountDescendants(name));
+      UNITTEST_ASSERT(sorted(store->GetSubtree(name)) == sorted(plain.GetSubtree(name)));
+    };
+
+    compare(L"");
+    compare(L"A");
+    compare(L"A.B.C1");
+    UNITTEST_ASSERT(store->CountDescendants(L"A") == 8);
+
+    // expired entries and their descendants are not counted
+    store->SetExpiry(L"A.B.C1", chrono::system_clock::now() - chrono::seconds(1));
+
+    compare(L"");
+    compare(L"A");
+    UNITTEST_ASSERT(store->CountDescendants(L"A") == 5);
+    UNITTEST_ASSERT(sorted(store->GetSubtree(L"A.B")) == Store::Children({ L"C2" }));
+
+    // subtrees are deleted at once
+    UNITTEST_ASSERT(!store->TryDelete(L"A.F", false));
+    UNITTEST_ASSERT(store->TryDelete(L"A.F", true));
+    UNITTEST_ASSERT(store->ExpireDue() == 1);
+
+    plain.Delete(L"A.D");
+
+    compare(L"");
+    UNITTEST_ASSERT(store->CountDescendants(L"A") == 2);
+    UNITTEST_ASSERT(!plain.Exists(L"A.B.C1.X"));
+
+    store->Create(L"A.B.C1.Z", 8);
+
+    compare(L"");
+    UNITTEST_ASSERT(store->CountDescendants(L"A.B") == 3);
+
+    store->CheckDataConsistency();
+
+    // dropped by another Store object
+    plain.SetSubtreeIndex(false);
+
+    UNITTEST_ASSERT(store->CountDescendants(L"A.B") == 3);
+    UNITTEST_ASSERT(sorted(store->GetSubtree(L"A.B")) == Store::Children({ L"C1", L"C1.Z", L"C2" }));
+    UNITTEST_ASSERT(!store->HasSubtreeIndex());
+
+    store->Delete(L"A.B.C1");
+
+    UNITTEST_ASSERT(store->CountDescendants(L"A.B") == 1);
+
+    // read-only transactions do not query the index again until another Store object has committed
+    UNITTEST_ASSERT(plain.CountDescendants(L"A") == 2);
+    UNITTEST_ASSERT(plain.CountDescendants(L"A.B") == 1);
+
+    store->SetSubtreeIndex(true);
+
+    UNITTEST_ASSERT(plain.CountDescendants(L"A") == 2);
+    UNITTEST_ASSERT(plain.HasSubtreeIndex());
+
+    store->SetSubtreeIndex(false);
+
+    UNITTEST_ASSERT(plain.CountDescendants(L"A") == 2);
+    UNITTEST_ASSERT(!plain.HasSubtreeIndex());
+
+    // copies keep the subtree index of the target
+    auto copy = CreateEmptyStore(Store::InMemoryFileName);
+
+    copy->SetSubtreeIndex(true);
+    copy->Create(L"Old.Value", 1);
+    copy->LoadFrom(DefaultDatabaseFileName);
+
+    UNITTEST_ASSERT(copy->HasSubtreeIndex());
+    UNITTEST_ASSERT(copy->CountDescendants(L"") == store->CountDescendants(L""));
+    UNITTEST_ASSERT(sorted(copy->GetSubtree(L"")) == sorted(store->GetSubtree(L"")));
+
+    copy->Delete(L"A.B");
+    copy->Create(L"A.J.K", 9);
+
+    UNITTEST_ASSERT(copy->CountDescendants(L"A") == 2);
+
+    copy->SetSubtreeIndex(false);
+
+    UNITTEST_ASSERT(!copy->HasSubtreeIndex());
+    UNITTEST_ASSERT(copy->CountDescendants(L"A") == 2);
+    UNITTEST_ASSERT(copy->GetSubtree(L"A.J") == Store::Children({ L"K" }));
+
+    // switched within a transaction that is rolled back
+    {
+      WriteableTransaction transaction(*copy);
+
+      copy->SetSubtreeIndex(true);
+
+      UNITTEST_ASSERT(copy->HasSubtreeIndex());
+    }
+
+    UNITTEST_ASSERT(copy->CountDescendants(L"A") == 2);
+    UNITTEST_ASSERT(!copy->HasSubtreeIndex());
+  }
+
+  // statistics of name computed by walking the subtree, see Store::GetStats()
+  Store::Stats ComputeStats(const Store& store, const Store::String& name)
+  {
+    Store::Stats stats;
+
+    // the root entry always keeps its default value
+    switch (name.empty() ? Store::ValueType::Integer : store.GetType(name))
+    {
+      case Store::ValueType::Integer: stats.Size = 8; break;
+      case Store::ValueType::String:  stats.Size = static_cast<Store::Integer>(WcharToUTF8(store.GetString(name)).size()); break;
+      case Store::ValueType::Binary:  stats.Size = static_cast<Store::Integer>(store.GetBinary(name).size()); break;
+    }
+
+    for (const auto& child : store.GetChildren(name))
+    {
+      auto childStats = ComputeStats(store, name.empty() ? child : (name + store.GetNameDelimiter() + child));
+
+      stats.Descendants += childStats.Descendants + 1;
+      stats.Size += childStats.Size;
+    }
+
+    return stats;
+  }
+
+  void TestStats()
+  {
+    auto check = [](const Store& store, const Store::String& name)
+    {
+      auto stats = store.GetStats(name);
+      auto expected = ComputeStats(store, name);
+
+      UNITTEST_ASSERT(stats.Descendants == expected.Descendants);
+      UNITTEST_ASSERT(stats.Size == expected.Size);
+    };
+
+    auto store = CreateEmptyStore(DefaultDatabaseFileName);
+
+    UNITTEST_ASSERT(store->GetStats(L"").Descendants == 0);
+    UNITTEST_ASSERT(store->GetStats(L"").Size == 8);
+
+    store->Create(L"A.B", 1);
+    store->Create(L"A.C", L"abc");
+    store->Create(L"A.D", Store::Binary(5, 0xAA));
+    store->Create(L"E", L"\u00E4\u00F6");
+
+    UNITTEST_ASSERT(store->GetStats(L"A").Descendants == 3);
+    UNITTEST_ASSERT(store->GetStats(L"A").Size == 8 + 8 + 3 + 5);
+    UNITTEST_ASSERT(store->GetStats(L"E").Size == 4);
+    UNITTEST_ASSERT(store->GetStats(L"").Descendants == 5);
+    UNITTEST_ASSERT_THROWS(store->GetStats(L"Missing"), EntryNotFound);
+
+    // every kind of write
+    store->Set(L"A.C", L"abcdef");
+    store->Increment(L"A.B", 5);
+    store->AppendBinary(L"A.D", Store::Binary(3, 0xBB));
+    UNITTEST_ASSERT(store->SetIf(L"E", L"x", store->GetRevision(L"E")));
+    UNITTEST_ASSERT(store->CompareAndSwap(L"A.C", L"abcdef", L"ab"));
+
+    check(*store, L"");
+    check(*store, L"A");
+    UNITTEST_ASSERT(store->GetStats(L"A").Size == 8 + 8 + 2 + 8);
+
+    store->Create(L"A.F.G.H", L"deep");
+    store->Delete(L"A.F.G");
+
+    check(*store, L"");
+    check(*store, L"A.F");
+
+    {
+      WriteBatch batch(*store);
+
+      batch.Create(L"Batch.Value", L"value");
+      batch.Set(L"A.C", L"longer value");
+      batch.Delete(L"A.D");
+      batch.Create(L"A.D", L"recreated");
+
+      UNITTEST_ASSERT(batch.Apply());
+    }
+
+    check(*store, L"");
+    check(*store, L"A");
+
+    // other Store objects maintain them as well
+    {
+      Store other(DefaultDatabaseFileName);
+
+      other.Create(L"Other.Value", L"other");
+      other.Delete(L"Batch");
+    }
+
+    check(*store, L"");
+
+    // expired entries count until they get deleted
+    store->Create(L"Lease.Value", L"lease");
+    store->SetExpiry(L"Lease", chrono::system_clock::now() - chrono::seconds(1));
+
+    UNITTEST_ASSERT(store->GetStats(L"").Descendants == ComputeStats(*store, L"").Descendants + 2);
+    UNITTEST_ASSERT(store->ExpireDue() == 1);
+    check(*store, L"");
+
+    // rebuild
+    Configuration::UnitTest::Detail::PrivateAccess::ExecuteSql(*store, "UPDATE Entries SET Descendants = 0, SubtreeSize = 0");
+
+    UNITTEST_ASSERT(store->GetStats(L"").Size == 0);
+
+    store->RebuildStats();
+
+    check(*store, L"");
+    check(*store, L"A");
+
+    // loaded stores come with their statistics
+    auto copy = CreateEmptyStore(Store::InMemoryFileName);
+
+    copy->Create(L"Old.Value", 1);
+    copy->LoadFrom(DefaultDatabaseFileName);
+    copy->Create(L"A.New", L"new");
+
+    check(*copy, L"");
+    check(*copy, L"A");
+
+    // entries of a version 1.5 database get their statistics on upgrade
+    auto stats = store->GetStats(L"");
+
+    Configuration::UnitTest::Detail::PrivateAccess::DowngradeDatabase(*store, 5);
+    store.reset();
+
+    Store upgraded(DefaultDatabaseFileName);
+
+    UNITTEST_ASSERT(Configuration::UnitTest::Detail::PrivateAccess::GetDatabaseMinorVersion(upgraded) == 6);
+    UNITTEST_ASSERT(upgraded.GetStats(L"").Descendants == stats.Descendants);
+    UNITTEST_ASSERT(upgraded.GetStats(L"").Size == stats.Size);
+    check(upgraded, L"A");
+  }
+
+  void TestGetRevisions()
+  {
+    auto store = CreateEmptyStore(Store::InMemoryFileName);
+
+    // more than fit into one query
+    vector<Store::String> names;
+
+    for (int i = 0; i < 100; i++)
+    {
+      names.push_back((boost::wformat(L"Group%1%.Value%2%") % (i % 10) % i).str());
+      store->Create(names.back(), i);
+    }
+
+    names.push_back(L"");
+    names.push_back(L"Group3");
+    names.push_back(L"Missing.Entry");
+
+    store->Create(L"Lease.Value", 1);
+    store->SetExpiry(L"Lease", chrono::system_clock::now() - chrono::seconds(1));
+
+    names.push_back(L"Lease.Value");
+
+    Store::Revision root;
+    vector<Store::Revision> revisions;
+
+    UNITTEST_ASSERT(store->GetRevisions(names, revisions, root));
+    UNITTEST_ASSERT(root == store->GetRevision(L""));
+    UNITTEST_ASSERT(revisions.size() == names.size());
+
+    for (size_t i = 0; i < 102; i++)
+    {
+      UNITTEST_ASSERT(revisions[i] == store->GetRevision(names[i]));
+    }
+
+    UNITTEST_ASSERT(revisions[102] == Store::Revision());
+    UNITTEST_ASSERT(revisions[103] == Store::Revision());
+
+    // nothing changed
+    vector<Store::Revision> unchanged;
+
+    UNITTEST_ASSERT(!store->GetRevisions(names, unchanged, root));
+    UNITTEST_ASSERT(unchanged.empty());
+
+    // polled by the revisions we got
+    auto handles = revisions;
+
+    store->Set(L"Group3.Value33", 1);
+    store->Delete(L"Group4.Value44");
+
+    UNITTEST_ASSERT(store->GetRevisions(handles, revisions, root));
+    UNITTEST_ASSERT(root == store->GetRevision(L""));
+
+    for (size_t i = 0; i < handles.size(); i++)
+    {
+      auto changed = (names[i] == L"Group3.Value33") || (names[i] == L"Group4.Value44") || (names[i] == L"Group3") || names[i].empty();
+
+      UNITTEST_ASSERT((revisions[i] != handles[i]) == changed);
+    }
+
+    UNITTEST_ASSERT(revisions[44] == Store::Revision());
+
+    UNITTEST_ASSERT(!store->GetRevisions(handles, revisions, root));
+
+    // new entry under the old name
+    store->Create(L"Group4.Value44", 2);
+
+    UNITTEST_ASSERT(store->GetRevisions(names, revisions, root));
+    UNITTEST_ASSERT(revisions[44] == store->GetRevision(L"Group4.Value44"));
+
+    // entries below an expired ancestor are gone for handles as well
+    handles = revisions;
+    store->SetExpiry(L"Group6", chrono::system_clock::now() - chrono::seconds(1));
+
+    UNITTEST_ASSERT(store->GetRevisions(handles, revisions, root));
+    UNITTEST_ASSERT(revisions[66] == Store::Revision());
+    UNITTEST_ASSERT(revisions[67] == handles[67]);
+
+    // the id of a deleted entry gets reused by the next entry created (the deleted one had the highest id)
+    store->Create(L"Reused.Old", 1);
+
+    vector<Store::Revision> reused = { store->GetRevision(L"Reused.Old") };
+
+    store->Delete(L"Reused.Old");
+    store->Create(L"Reused.New", 2);
+
+    UNITTEST_ASSERT(store->GetRevisions(reused, revisions, root));
+    UNITTEST_ASSERT(revisions[0] == Store::Revision());
+  }
+
+  void TestChangeSignal()
+  {
+    UNITTEST_ASSERT_THROWS(ChangeSignal(Store::InMemoryFileName), InvalidConfiguration);
+
+    auto store = CreateEmptyStore(DefaultDatabaseFileName);
+
+    // start from a fresh signal, previous runs may have left theirs behind
+    ChangeSignal::Remove(DefaultDatabaseFileName);
+
+    Store::Options options;
+
+    options.SignalChanges = true;
+
+    Store writer(DefaultDatabaseFileName, false, Store::DefaultNameDelimiter, options);
+    ChangeSignal signal(DefaultDatabaseFileName);
+    ChangeSignal other(L"./" + DefaultDatabaseFileName);
+
+    auto sequence = signal.GetSequence();
+
+    UNITTEST_ASSERT(other.GetSequence() == sequence);
+    UNITTEST_ASSERT(!signal.Wait(sequence, chrono::milliseconds(10)));
+
+    // not signalled by stores without SignalChanges
+    store->Create(L"Value", 1);
+
+    UNITTEST_ASSERT(!signal.Wait(sequence, chrono::milliseconds(0)));
+
+    writer.Set(L"Value", 2);
+
+    UNITTEST_ASSERT(signal.Wait(sequence, chrono::milliseconds(0)));
+    UNITTEST_ASSERT(sequence == other.GetSequence());
+    UNITTEST_ASSERT(!signal.Wait(sequence, chrono::milliseconds(0)));
+
+    // only outermost transactions are signalled
+    {
+      WriteableTransaction transaction(writer);
+
+      writer.Set(L"Value", 3);
+      writer.Create(L"Other", 1);
+
+      UNITTEST_ASSERT(!signal.Wait(sequence, chrono::milliseconds(0)));
+
+      transaction.Commit();
+    }
+
+    UNITTEST_ASSERT(signal.Wait(sequence, chrono::milliseconds(0)));
+
+    // rolled back
+    {
+      WriteableTransaction transaction(writer);
+
+      writer.Set(L"Value", 4);
+    }
+
+    UNITTEST_ASSERT(!signal.Wait(sequence, chrono::milliseconds(0)));
+
+    // watcher blocks until the change
+    auto start = chrono::steady_clock::now();
+    auto changed = false;
+
+    thread watcher([&]() { changed = other.Wait(sequence, chrono::seconds(10)); });
+
+    this_thread::sleep_for(chrono::milliseconds(50));
+
+    writer.Set(L"Value", 5);
+
+    watcher.join();
+
+    UNITTEST_ASSERT(changed);
+    UNITTEST_ASSERT((chrono::steady_clock::now() - start) < chrono::seconds(5));
+    UNITTEST_ASSERT(sequence == signal.GetSequence());
+    UNITTEST_ASSERT(store->GetInteger(L"Value") == 5);
+
+    ChangeSignal::Remove(DefaultDatabaseFileName);
+  }
+
+  void TestSnapshot()
+  {
+    UNITTEST_ASSERT_THROWS(SnapshotReader(Store::InMemoryFileName), InvalidConfiguration);
+
+    // does not signal its changes
+    auto store = CreateEmptyStore(DefaultDatabaseFileName);
+
+    ChangeSignal::Remove(DefaultDatabaseFileName);
+    SnapshotPublisher::Remove(DefaultDatabaseFileName);
+
+    Store::Options options;
+
+    options.SignalChanges = true;
+
+    Store writer(DefaultDatabaseFileName, false, Store::DefaultNameDelimiter, options);
+
+    writer.Create(L"Group.Integer", 1);
+    writer.Create(L"Group.String", L"Text \u00E4\u20AC");
+    writer.Create(L"Group.Binary", Store::Binary{1, 2, 3});
+    writer.Create(L"Group.Sub.Value", 2);
+    writer.Create(L"Other", L"");
+    writer.Create(L"Lease", 3);
+    writer.SetTimeToLive(L"Lease", chrono::milliseconds(300));
+
+    {
+      SnapshotPublisher small(*store, 64);
+
+      UNITTEST_ASSERT_THROWS(small.Publish(), ValueOutOfRange);
+    }
+
+    SnapshotPublisher::Remove(DefaultDatabaseFileName);
+
+    SnapshotPublisher publisher(*store);
+    SnapshotReader reader(DefaultDatabaseFileName);
+
+    // nothing published yet
+    UNITTEST_ASSERT(!reader.IsCurrent());
+    UNITTEST_ASSERT(reader.GetInteger(L"Group.Integer") == 1);
+
+    UNITTEST_ASSERT(publisher.Publish());
+    UNITTEST_ASSERT(!publisher.Publish());
+    UNITTEST_ASSERT(publisher.GetPublishedRevision() == store->GetRevision());
+    UNITTEST_ASSERT(reader.IsCurrent());
+
+    UNITTEST_ASSERT(reader.Exists(L"Group.Sub"));
+    UNITTEST_ASSERT(!reader.Exists(L"Group.Missing"));
+    UNITTEST_ASSERT(reader.GetType(L"Group.Integer") == Store::ValueType::Integer);
+    UNITTEST_ASSERT(reader.GetType(L"Group.String") == Store::ValueType::String);
+    UNITTEST_ASSERT(reader.GetType(L"Group.Binary") == Store::ValueType::Binary);
+    UNITTEST_ASSERT(reader.GetInteger(L"Group.Integer") == 1);
+    UNITTEST_ASSERT(reader.GetString(L"Group.String") == L"Text \u00E4\u20AC");
+    UNITTEST_ASSERT(reader.GetString(L"Other") == L"");
+    UNITTEST_ASSERT(reader.GetBinary(L"Group.Binary") == Store::Binary({1, 2, 3}));
+    UNITTEST_ASSERT(reader.GetInteger(L"Group.Sub.Value") == 2);
+    UNITTEST_ASSERT(reader.HasChild(L""));
+    UNITTEST_ASSERT(reader.HasChild(L"Group"));
+    UNITTEST_ASSERT(!reader.HasChild(L"Other"));
+    UNITTEST_ASSERT(reader.GetChildren(L"") == Store::Children({L"Group", L"Lease", L"Other"}));
+    UNITTEST_ASSERT(reader.GetChildren(L"Group") == Store::Children({L"Binary", L"Integer", L"String", L"Sub"}));
+
+    // errors are the ones of Store
+    UNITTEST_ASSERT_THROWS(reader.Exists(L""), InvalidName);
+    UNITTEST_ASSERT_THROWS(reader.GetInteger(L"Group..Integer"), InvalidName);
+    UNITTEST_ASSERT_THROWS(reader.GetType(L"Group.Missing"), EntryNotFound);
+    UNITTEST_ASSERT_THROWS(reader.GetString(L"Group.Integer"), WrongValueType);
+    UNITTEST_ASSERT_THROWS(reader.GetChildren(L"Missing"), EntryNotFound);
+
+    // served by the snapshot as long as the publisher confirms it, changes that are not signalled are only seen by the publisher
+    store->Set(L"Group.Integer", 10);
+
+    UNITTEST_ASSERT(reader.IsCurrent());
+    UNITTEST_ASSERT(reader.GetInteger(L"Group.Integer") == 1);
+
+    this_thread::sleep_for(chrono::milliseconds(2100));
+
+    UNITTEST_ASSERT(!reader.IsCurrent());
+    UNITTEST_ASSERT(reader.GetInteger(L"Group.Integer") == 10);
+
+    // and get published once waiting for the signal times out
+    UNITTEST_ASSERT(publisher.WaitAndPublish(chrono::milliseconds(0)));
+    UNITTEST_ASSERT(reader.IsCurrent());
+    UNITTEST_ASSERT(reader.GetInteger(L"Group.Integer") == 10);
+
+    // signalled changes make it stale
+    writer.Set(L"Group.Sub.Value", 20);
+
+    UNITTEST_ASSERT(!reader.IsCurrent());
+    UNITTEST_ASSERT(reader.GetInteger(L"Group.Integer") == 10);
+    UNITTEST_ASSERT(reader.GetInteger(L"Group.Sub.Value") == 20);
+
+    UNITTEST_ASSERT(publisher.WaitAndPublish(chrono::milliseconds(0)));
+    UNITTEST_ASSERT(reader.IsCurrent());
+    UNITTEST_ASSERT(reader.GetInteger(L"Group.Sub.Value") == 20);
+    UNITTEST_ASSERT(!publisher.WaitAndPublish(chrono::milliseconds(10)));
+
+    // signalled commit without any change, the snapshot is taken over
+    {
+      WriteableTransaction transaction(writer);
+
+      transaction.Commit();
+    }
+
+    UNITTEST_ASSERT(!reader.IsCurrent());
+    UNITTEST_ASSERT(!publisher.WaitAndPublish(chrono::milliseconds(0)));
+    UNITTEST_ASSERT(reader.IsCurrent());
+
+    // unchanged snapshots stay current as long as the publisher keeps confirming them
+    for (int i = 0; i < 3; i++)
+    {
+      this_thread::sleep_for(chrono::milliseconds(1000));
+
+      UNITTEST_ASSERT(!publisher.Publish());
+      UNITTEST_ASSERT(reader.IsCurrent());
+    }
+
+    // expired after the snapshot has been taken
+    this_thread::sleep_for(chrono::milliseconds(400));
+
+    UNITTEST_ASSERT(reader.IsCurrent());
+    UNITTEST_ASSERT(!reader.Exists(L"Lease"));
+    UNITTEST_ASSERT(reader.GetChildren(L"") == Store::Children({L"Group", L"Other"}));
+
+    // readers never see torn or outdated values while snapshots are published
+    writer.Create(L"Counter", 0);
+    publisher.Publish();
+
+    atomic<bool> stop(false);
+    atomic<bool> failed(false);
+    atomic<int>  snapshots(0);
+
+    thread watcher([&]()
+    {
+      SnapshotReader other(DefaultDatabaseFileName);
+      Store::Integer last = 0;
+
+      while (!stop)
+      {
+        auto current = other.IsCurrent();
+        auto value = other.GetInteger(L"Counter");
+
+        if ((value < last) || (other.GetString(L"Group.String") != L"Text \u00E4\u20AC"))
+        {
+          failed = true;
+        }
+
+        snapshots += current ? 1 : 0;
+        last = value;
+      }
+    });
+
+    for (Store::Integer i = 1; i <= 200; i++)
+    {
+      writer.Set(L"Counter", i);
+      publisher.Publish();
+    }
+
+    stop = true;
+    watcher.join();
+
+    UNITTEST_ASSERT(!failed);
+    UNITTEST_ASSERT(snapshots > 0);
+    UNITTEST_ASSERT(reader.GetInteger(L"Counter") == 200);
+
+    SnapshotPublisher::Remove(DefaultDatabaseFileName);
+    ChangeSignal::Remove(DefaultDatabaseFileName);
+  }
+
+  // validation and splitting of names as done before the vectorized scanner
+  bool ParseNameReference(const Store::String& name, Store::String::value_type delimiter, vector<Store::String>& path)
+  {
+    if (name.empty() || (name.front() == delimiter) || (name.back() == delimiter) || (name.find(Store::String(2, delimiter)) != Store::String::npos))
+    {
+      return false;
+    }
+
+    using Tok = boost::tokenizer<boost::char_separator<Store::String::value_type>, Store::String::const_iterator, Store::String>;
+
+    Store::String separator(1, delimiter);
+    Tok tok(name, boost::char_separator<Store::String::value_type>(separator.c_str(), 0));
+
+    path.assign(begin(tok), end(tok));
+
+    return true;
+  }
+
+  void TestNameScanner()
+  {
+    // ASCII and multi-byte UTF-8 delimiter
+    for (Store::String::value_type delimiter : { Store::DefaultNameDelimiter, static_cast<Store::String::value_type>(0x00DF) })
+    {
+      for (const auto& name : { L"", L".", L"a", L"a.", L".a", L"a..b", L"a.b", L"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa.b",
+                                L"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa..aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa", L"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa." })
+      {
+        Store::String text(name);
+
+        replace(begin(text), end(text), Store::DefaultNameDelimiter, delimiter);
+
+        vector<Store::String> path;
+        bool valid = ParseNameReference(text, delimiter, path);
+
+        UNITTEST_ASSERT(Configuration::Detail::ScanName(text.data(), text.size(), delimiter) == valid);
+        UNITTEST_ASSERT(Configuration::Detail::ScanNameScalar(text.data(), text.size(), delimiter) == valid);
+      }
+
+      // random names of all lengths, delimiters at random positions
+      for (size_t i = 0; i < 20000; i++)
+      {
+        Store::String name = GenerateRandomName(80, 2, delimiter);
+
+        for (size_t j = GetRandomNumber(0, 4); j > 0; j--)
+        {
+          name[GetRandomNumber(0, name.size() - 1)] = delimiter;
+        }
+
+        vector<Store::String> path;
+        bool valid = ParseNameReference(name, delimiter, path);
+
+        Configuration::Detail::DelimiterPositions delimiters;
+        Configuration::Detail::DelimiterPositions scalarDelimiters;
+        Configuration::Detail::DelimiterPositions utf8Delimiters;
+
+        auto utf8 = WcharToUTF8(name);
+
+        UNITTEST_ASSERT(Configuration::Detail::ScanName(name.data(), name.size(), delimiter, &delimiters) == valid);
+        UNITTEST_ASSERT(Configuration::Detail::ScanNameScalar(name.data(), name.size(), delimiter, &scalarDelimiters) == valid);
+        UNITTEST_ASSERT(Configuration::Detail::ScanName(utf8.data(), utf8.size(), delimiter, &utf8Delimiters) == valid);
+
+        if (valid)
+        {
+          UNITTEST_ASSERT(delimiters == scalarDelimiters);
+          UNITTEST_ASSERT(delimiters.size() + 1 == path.size());
+          UNITTEST_ASSERT(utf8Delimiters.size() + 1 == path.size());
+
+          size_t first = 0;
+
+          for (size_t k = 0; k < delimiters.size(); k++)
+          {
+            UNITTEST_ASSERT(name.substr(first, delimiters[k] - first) == path[k]);
+            first = delimiters[k] + 1;
+          }
+        }
+      }
+    }
+  }
+
+  void BenchmarkNameScanner()
+  {
+    static const size_t count = 100000;
+
+    // typical names of 20 - 200 characters
+    vector<Store::String> names;
+
+    for (size_t i = 0; i < count; i++)
+    {
+      Store::String name = GenerateRandomName(20, 4);
+
+      for (size_t length = GetRandomNumber(20, 200); name.size() < length; )
+      {
+        name += Store::DefaultNameDelimiter + GenerateRandomName(20, 4);
+      }
+
+      names.push_back(name);
+    }
+
+    size_t segments = 0;
+
+    cout << "Validating and splitting " << count << " names, previous implementation:\n";
+
+    {
+      boost::timer::auto_cpu_timer timer;
+      vector<Store::String> path;
+
+      for (const auto& name : names)
+      {
+        ParseNameReference(name, Store::DefaultNameDelimiter, path);
+        segments += path.size();
+      }
+    }
+
+    cout << "\nValidating and splitting " << count << " names, vectorized scanner:\n";
+
+    {
+      boost::timer::auto_cpu_timer timer;
+      Configuration::Detail::DelimiterPositions delimiters;
+      vector<Store::String> path;
+
+      for (const auto& name : names)
+      {
+        Configuration::Detail::ScanName(name.data(), name.size(), Store::DefaultNameDelimiter, &delimiters);
+
+        size_t first = 0;
+
+        path.clear();
+
+        for (auto pos : delimiters)
+        {
+          path.emplace_back(name, first, pos - first);
+          first = pos + 1;
+        }
+
+        path.emplace_back(name, first, Store::String::npos);
+        segments -= path.size();
+      }
+    }
+
+    UNITTEST_ASSERT(segments == 0);
+
+    cout << "\nValidating " << count << " names, previous implementation:\n";
+
+    size_t valid = 0;
+
+    {
+      boost::timer::auto_cpu_timer timer;
+
+      for (const auto& name : names)
+      {
+        valid += (!name.empty() && (name.front() != Store::DefaultNameDelimiter) && (name.back() != Store::DefaultNameDelimiter) &&
+                  (name.find(Store::String(2, Store::DefaultNameDelimiter)) == Store::String::npos)) ? 1 : 0;
+      }
+    }
+
+    cout << "\nValidating " << count << " names, vectorized scanner:\n";
+
+    {
+      boost::timer::auto_cpu_timer timer;
+
+      for (const auto& name : names)
+      {
+        valid -= Store::IsValidName(name, Store::DefaultNameDelimiter) ? 1 : 0;
+      }
+    }
+
+    UNITTEST_ASSERT(valid == 0);
+  }
+
+  void BenchmarkFullPathLookup()
+  {
+    static const size_t count = 10000;
+
+    auto store = CreateEmptyStore(DefaultDatabaseFileName);
+
+    // 1000 siblings on each level, so each probe of the walking resolver has to search
+    {
+      WriteableTransaction transaction(*store);
+      Store::String name;
+
+      for (size_t depth = 1; depth <= 32; depth++)
+      {
+        for (size_t i = 0; i < 1000; i++)
+        {
+          store->Create((name.empty() ? Store::String() : name + Store::DefaultNameDelimiter) + (boost::wformat(L"Level%1%Sibling%2%") % depth % i).str(), static_cast<Store::Integer>(i));
+        }
+
+        name += (name.empty() ? Store::String() : Store::String(1, Store::DefaultNameDelimiter)) + (boost::wformat(L"Level%1%Sibling%2%") % depth % 500).str();
+      }
+
+      transaction.Commit();
+    }
+
+    vector<Store::String> names;
+
+    for (size_t depth = 1; depth <= 32; depth++)
+    {
+      Store::String name;
+
+      for (size_t level = 1; level <= depth; level++)
+      {
+        name += (name.empty() ? Store::String() : Store::String(1, Store::DefaultNameDelimiter)) + (boost::wformat(L"Level%1%Sibling%2%") % level % ((level == depth) ? 499 : 500)).str();
+      }
+
+      names.push_back(name);
+    }
+
+    for (auto fullPaths : { false, true })
+    {
+      store->SetFullPathMode(fullPaths);
+
+      cout << (fullPaths ? "\nFull path lookup" : "\nWalking lookup") << ", " << count << " reads per depth within one transaction:\n";
+
+      for (size_t depth : { 1, 2, 4, 8, 16, 32 })
+      {
+        ReadOnlyTransaction transaction(*store);
+        const auto& name = names[depth - 1];
+        auto start = chrono::steady_clock::now();
+
+        for (size_t i = 0; i < count; i++)
+        {
+          UNITTEST_ASSERT(store->GetInteger(name) == 499);
+        }
+
+        cout << "  depth " << depth << ": " << chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count() << "us\n";
+      }
+    }
+  }
+
+  void BenchmarkSubtreeIndex()
+  {
+    static const size_t groups = 20;
+    static const size_t count = 1000;
+
+    for (auto index : { false, true })
+    {
+      auto store = CreateEmptyStore(DefaultDatabaseFileName);
+
+      store->SetSubtreeIndex(index);
+
+      cout << (index ? "\nWith subtree index" : "\nWithout subtree index") << ", creating " << (groups * count) << " entries within one transaction:\n";
+
+      {
+        boost::timer::auto_cpu_timer timer;
+        WriteableTransaction transaction(*store);
+
+        for (size_t i = 0; i < groups * count; i++)
+        {
+          store->Create((boost::wformat(L"Group%1%.Sub%2%.Deep.Value%3%") % (i % groups) % ((i / groups) % 10) % i).str(), static_cast<Store::Integer>(i));
+        }
+
+        transaction.Commit();
+      }
+
+      cout << "Counting descendants of each group 100 times:\n";
+
+      {
+        boost::timer::auto_cpu_timer timer;
+
+        for (size_t i = 0; i < 100 * groups; i++)
+        {
+          UNITTEST_ASSERT(store->CountDescendants((boost::wformat(L"Group%1%") % (i % groups)).str()) == count + 20);
+        }
+      }
+
+      cout << "Reading subtree of each group 10 times:\n";
+
+      {
+        boost::timer::auto_cpu_timer timer;
+
+        for (size_t i = 0; i < 10 * groups; i++)
+        {
+          UNITTEST_ASSERT(store->GetSubtree((boost::wformat(L"Group%1%") % (i % groups)).str()).size() == count + 20);
+        }
+      }
+
+      cout << "Deleting all groups:\n";
+
+      {
+        boost::timer::auto_cpu_timer timer;
+
+        for (size_t i = 0; i < groups; i++)
+        {
+          store->Delete((boost::wformat(L"Group%1%") % i).str());
+        }
+      }
+
+      UNITTEST_ASSERT(store->CountDescendants(L"") == 0);
+    }
+  }
+
+  void BenchmarkGetRevisions()
+  {
+    static const size_t subtrees = 500;
+    static const size_t polls = 100;
+
+    auto store = CreateEmptyStore(DefaultDatabaseFileName);
+    vector<Store::String> names;
+
+    {
+      WriteableTransaction transaction(*store);
+
+      for (size_t i = 0; i < subtrees; i++)
+      {
+        names.push_back((boost::wformat(L"Watched.Group%1%.Subtree%2%") % (i % 20) % i).str());
+        store->Create(names.back() + L".Value", static_cast<Store::Integer>(i));
+      }
+
+      transaction.Commit();
+    }
+
+    Store::Revision root;
+    vector<Store::Revision> revisions;
+    vector<Store::Revision> handles;
+
+    store->GetRevisions(names, handles, root);
+
+    cout << "Polling " << subtrees << " subtrees " << polls << " times, one change before each poll, GetRevision():\n";
+
+    {
+      boost::timer::auto_cpu_timer timer;
+
+      for (size_t i = 0; i < polls; i++)
+      {
+        store->Set(names[i % subtrees] + L".Value", 0);
+
+        for (const auto& name : names)
+        {
+          store->GetRevision(name);
+        }
+      }
+    }
+
+    cout << "\nSame by GetRevisions() with names:\n";
+
+    {
+      boost::timer::auto_cpu_timer timer;
+
+      for (size_t i = 0; i < polls; i++)
+      {
+        store->Set(names[i % subtrees] + L".Value", 1);
+        UNITTEST_ASSERT(store->GetRevisions(names, revisions, root));
+      }
+    }
+
+    cout << "\nSame by GetRevisions() with handles:\n";
+
+    {
+      boost::timer::auto_cpu_timer timer;
+
+      for (size_t i = 0; i < polls; i++)
+      {
+        store->Set(names[i % subtrees] + L".Value", 2);
+        UNITTEST_ASSERT(store->GetRevisions(handles, revisions, root));
+      }
+    }
+
+    cout << "\nPolling " << subtrees << " subtrees " << (polls * 100) << " times without changes by GetRevisions():\n";
+
+    {
+      boost::timer::auto_cpu_timer timer;
+
+      for (size_t i = 0; i < polls * 100; i++)
+      {
+        UNITTEST_ASSERT(!store->GetRevisions(handles, revisions, root));
+      }
+    }
+  }
+
+  void BenchmarkSnapshot()
+  {
+    static const size_t entries = 10000;
+    static const size_t reads = 100000;
+
+    ChangeSignal::Remove(DefaultDatabaseFileName);
+    SnapshotPublisher::Remove(DefaultDatabaseFileName);
+
+    Store::Options options;
+
+    options.SignalChanges = true;
+
+    auto store = CreateEmptyStore(DefaultDatabaseFileName, Store::DefaultNameDelimiter, options);
+    vector<Store::String> names;
+
+    {
+      WriteableTransaction transaction(*store);
+
+      for (size_t i = 0; i < entries; i++)
+      {
+        names.push_back((boost::wformat(L"Service%1%.Group%2%.Value%3%") % (i % 10) % ((i / 10) % 100) % i).str());
+        store->Create(names.back(), static_cast<Store::Integer>(i));
+      }
+
+      transaction.Commit();
+    }
+
+    boost::random::mt19937 generator;
+    boost::random::uniform_int_distribution<size_t> distribution(0, entries - 1);
+    vector<size_t> sample;
+
+    for (size_t i = 0; i < reads; i++)
+    {
+      sample.push_back(distribution(generator));
+    }
+
+    SnapshotPublisher publisher(*store);
+
+    cout << "Publishing " << entries << " entries:\n";
+
+    {
+      boost::timer::auto_cpu_timer timer;
+
+      UNITTEST_ASSERT(publisher.Publish());
+    }
+
+    cout << "\nReading " << reads << " random entries by Store:\n";
+
+    {
+      boost::timer::auto_cpu_timer timer;
+      Store reader(DefaultDatabaseFileName);
+
+      for (auto i : sample)
+      {
+        UNITTEST_ASSERT(reader.GetInteger(names[i]) == static_cast<Store::Integer>(i));
+      }
+    }
+
+    cout << "\nReading " << reads << " random entries by SnapshotReader:\n";
+
+    {
+      boost::timer::auto_cpu_timer timer;
+      SnapshotReader reader(DefaultDatabaseFileName);
+
+      for (auto i : sample)
+      {
+        UNITTEST_ASSERT(reader.GetInteger(names[i]) == static_cast<Store::Integer>(i));
+      }
+
+      UNITTEST_ASSERT(reader.IsCurrent());
+    }
+
+    SnapshotPublisher::Remove(DefaultDatabaseFileName);
+    ChangeSignal::Remove(DefaultDatabaseFileName);
+  }
+
+  void BenchmarkTimeToFirstRead()
+  {
+    static const size_t count = 10000;
+
+    {
+      auto store = CreateEmptyStore(DefaultDatabaseFileName);
+      WriteableTransaction transaction(*store);
+
+      for (size_t i = 0; i < count; i++)
+      {
+        store->Create((boost::wformat(L"Benchmark.Group%1%.Value%2%") % (i % 100) % i).str(), static_cast<Store::Integer>(i));
+      }
+
+      transaction.Commit();
+
+      store->Optimize();
+    }
+
+    for (auto prepare : {false, true})
+    {
+      Store::Options options;
+
+      options.PrepareStatements = prepare;
+
+      boost::timer::cpu_timer timer;
+
+      Store store(DefaultDatabaseFileName, false, Store::DefaultNameDelimiter, options);
+
+      auto open = timer.elapsed().wall;
+
+      store.GetInteger(L"Benchmark.Group42.Value4242");
+
+      auto firstRead = timer.elapsed().wall - open;
+
+      cout << "PrepareStatements = " << boolalpha << prepare << ": open " << (open / 1000) << "us, first read " << (firstRead / 1000)
+           << "us, time to first read " << ((open + firstRead) / 1000) << "us\n";
+    }
+  }
+
+  void Benchmark()
+  {
+    static const size_t count = 10000;
+
+    set<Store::String>     names;
+    vector<Store::String>  stringValues;
+    vector<Store::Integer> intValues;
+
+    stringValues.reserve(count);
+    intValues.resize(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+      while (!names.insert(GenerateRandomName()).second);  // names have to be unique
+      stringValues.push_back(GenerateRandomString(35, 5));
+      intValues[i] = GetRandomNumber();
+    }
+
+    cout << "Creating " << count << " entries:\n";
+
+    auto store = CreateEmptyStore();
+    WriteableTransaction transaction(*store);
+
+    {      
+      boost::timer::auto_cpu_timer timer;
+
+      assert(names.size() == count);
+      assert(names.size() == stringValues.size());
+      assert(intValues.size() == stringValues.size());
+
+      // TODO: is there a better way to iterate over multiple containers at once?
+      size_t index = 0;
+
+      for (const auto& name : names)
+      {
+        if (GetRandomNumber(0, 1) == 0)
+        {
+          store->Create(name, intValues[index]);
+        }
+        else
+        {
+          store->Create(name, stringValues[index]);
+        }
+
+        index++;
+      }
+
+      transaction.Commit();
+    }
+
+    cout << "\nTotal:\n";
+  }
+}  // anonymous namespace
+
+namespace Configuration
+{
+  namespace UnitTest
+  {
+    bool Run()
+    {
+      boost::timer::auto_cpu_timer timer;
+      bool result = true;
+      vector<pair<function<void()>, string>>     tests;
+
+#define REGISTER_UNIT_TEST(x) tests.emplace_back(make_pair(x, #x))
+
+      REGISTER_UNIT_TEST(TestIsValidName);
+      REGISTER_UNIT_TEST(TestExists);
+      REGISTER_UNIT_TEST(TestGetType);
+      REGISTER_UNIT_TEST(TestHasChild);
+      REGISTER_UNIT_TEST(TestGetRevision);
+      REGISTER_UNIT_TEST(TestCreate);
+      REGISTER_UNIT_TEST(TestSet);
+
+      REGISTER_UNIT_TEST(TestWriteableTransaction);
+
+      REGISTER_UNIT_TEST(TestInMemory);
+      REGISTER_UNIT_TEST(TestCompact);
+      REGISTER_UNIT_TEST(TestOptimize);
+      REGISTER_UNIT_TEST(TestChildrenCache);
+      REGISTER_UNIT_TEST(TestConditionalWrite);
+      REGISTER_UNIT_TEST(TestAtomicOperations);
+      REGISTER_UNIT_TEST(TestWriteBatch);
+      REGISTER_UNIT_TEST(TestWriteBack);
+      REGISTER_UNIT_TEST(TestExpiry);
+      REGISTER_UNIT_TEST(TestHistory);
+      REGISTER_UNIT_TEST(TestContentHash);
+      REGISTER_UNIT_TEST(TestApplyDiff);
+      REGISTER_UNIT_TEST(TestJson);
+      REGISTER_UNIT_TEST(TestParallelCheck);
+      REGISTER_UNIT_TEST(TestParallelJson);
+      REGISTER_UNIT_TEST(TestNameScanner);
+      REGISTER_UNIT_TEST(TestHashNameLookup);
+      REGISTER_UNIT_TEST(TestFullPaths);
+      REGISTER_UNIT_TEST(TestSubtreeIndex);
+      REGISTER_UNIT_TEST(TestStats);
+      REGISTER_UNIT_TEST(TestGetRevisions);
+      REGISTER_UNIT_TEST(TestChangeSignal);
+      REGISTER_UNIT_TEST(TestSnapshot);
 
 #ifdef NDEBUG  // running the benchmark in debug mode makes no sense
       REGISTER_UNIT_TEST(Benchmark);
+      REGISTER_UNIT_TEST(BenchmarkTimeToFirstRead);
+      REGISTER_UNIT_TEST(BenchmarkNameScanner);
+      REGISTER_UNIT_TEST(BenchmarkFullPathLookup);
+      REGISTER_UNIT_TEST(BenchmarkSubtreeIndex);
+      REGISTER_UNIT_TEST(BenchmarkGetRevisions);
+      REGISTER_UNIT_TEST(BenchmarkSnapshot);
 #endif      
 
       for (const auto& test : tests)
@@ -0,0 +1,461 @@
+// Copyright (c) 2014 by Bertolt Mildner
+// All rights reserved.
+
+// configstore: command-line tool to inspect and manipulate stores, see Usage()
+
+#include <iostream>
+#include <ostream>
+#include <typeinfo>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+
+#include "Configuration\Utils.h"
+
+CONFIGURATION_BOOST_INCL_GUARD_BEGIN
+#include <boost/filesystem/fstream.hpp>
+#include <boost/timer/timer.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+CONFIGURATION_BOOST_INCL_GUARD_END
+
+#include "Configuration\Configuration.h"
+#include "Configuration\WriteBatch.h"
+#include "Configuration\Json.h"
+#include "Configuration\ChangeSignal.h"
+#include "Configuration\Snapshot.h"
+
+using namespace std;
+using namespace Configuration;
+
+namespace
+{
+  using Arguments = vector<wstring>;
+
+  const wstring HexChars = L"0123456789abcdef";
+
+  void Usage()
+  {
+    wcout << L"usage: configstore <file> <command> [arguments]\n"
+             L"\n"
+             L"commands:\n"
+             L"  get <name>                                     prints value of an entry\n"
+             L"  set <name> <integer|string|binary> <value>     sets or creates an entry, binary values in hex\n"
+             L"  delete <name>                                  deletes an entry incl. its children\n"
+             L"  ls [<name>]                                    lists children of an entry (default: root)\n"
+             L"  tree [<name>]                                  prints an entry and all its descendants with their values\n"
+             L"  export [<name>] [<file>]                       exports as JSON (default: whole store to stdout)\n"
+             L"  import <file> [<name>]                         imports JSON (default: into root)\n"
+             L"  check [<threads>]                              checks data consistency using <threads> threads (default: 1, 0: one per core)\n"
+             L"  compact                                        returns free pages to the file system and optimizes the store\n"
+             L"  watch [<name>]                                 blocks and prints a line whenever an entry (default: root) changes\n"
+             L"                                                 (sees changes of stores opened with Options::SignalChanges only)\n"
+             L"  publish                                        publishes snapshots for SnapshotReader whenever a change is signalled\n"
+             L"                                                 (or within a second if it is not)\n"
+             L"  bench [<count>]                                runs benchmarks against an in-memory copy of the store\n";
+  }
+
+  // prints the elapsed times like boost::timer::auto_cpu_timer, but to wcout (all text output is wide)
+  class Timer
+  {
+    public:
+      ~Timer()
+      {
+        wcout << UTF8ToWchar(m_Timer.format());
+      }
+
+    private:
+      boost::timer::cpu_timer m_Timer;
+  };
+
+  wstring ToHex(const Store::Binary& value)
+  {
+    wstring text;
+
+    for (auto byte : value)
+    {
+      text += HexChars[byte >> 4];
+      text += HexChars[byte & 0x0F];
+    }
+
+    return text;
+  }
+
+  Store::Binary FromHex(const wstring& text)
+  {
+    if ((text.size() % 2) != 0)
+    {
+      throw invalid_argument("Hex value needs an even number of digits");
+    }
+
+    Store::Binary value;
+
+    for (size_t i = 0; i < text.size(); i += 2)
+    {
+      auto high = HexChars.find(towlower(text[i]));
+      auto low = HexChars.find(towlower(text[i + 1]));
+
+      if ((high == wstring::npos) || (low == wstring::npos))
+      {
+        throw invalid_argument("Invalid hex digit");
+      }
+
+      value.push_back(static_cast<uint8_t>((high << 4) | low));
+    }
+
+    return value;
+  }
+
+  wstring FormatValue(const Store& store, const wstring& name)
+  {
+    switch (store.GetType(name))
+    {
+      case Store::ValueType::Integer:
+        return to_wstring(store.GetInteger(name));
+
+      case Store::ValueType::String:
+        return L"\"" + store.GetString(name) + L"\"";
+
+      case Store::ValueType::Binary:
+        return L"0x" + ToHex(store.GetBinary(name));
+    }
+
+    return wstring();
+  }
+
+  wstring ChildName(const Store& store, const wstring& parent, const wstring& child)
+  {
+    return parent.empty() ? child : (parent + store.GetNameDelimiter() + child);
+  }
+
+  Store::Children GetSortedChildren(const Store& store, const wstring& name)
+  {
+    auto children = store.GetChildren(name);
+
+    sort(begin(children), end(children));
+
+    return children;
+  }
+
+  void PrintTree(const Store& store, const wstring& name, const wstring& indent)
+  {
+    for (const auto& child : GetSortedChildren(store, name))
+    {
+      auto childName = ChildName(store, name, child);
+
+      wcout << indent << child << L" = " << FormatValue(store, childName) << L"\n";
+
+      PrintTree(store, childName, indent + L"  ");
+    }
+  }
+
+  void CollectNames(const Store& store, const wstring& name, vector<wstring>& names)
+  {
+    for (const auto& child : store.GetChildren(name))
+    {
+      auto childName = ChildName(store, name, child);
+
+      names.push_back(childName);
+
+      CollectNames(store, childName, names);
+    }
+  }
+
+  // changes made by the tool wake up watchers, see "watch"
+  Store::Options SignallingOptions()
+  {
+    Store::Options options;
+
+    options.SignalChanges = true;
+
+    return options;
+  }
+
+  // benchmarks run against an in-memory copy, the store itself is not modified
+  void Bench(const wstring& fileName, size_t count)
+  {
+    wchar_t delimiter;
+
+    {
+      Store store(fileName);
+
+      delimiter = store.GetNameDelimiter();
+    }
+
+    Store copy(Store::InMemoryFileName, true, delimiter);
+
+    wcout << L"Loading copy of store:\n";
+
+    {
+      Timer timer;
+
+      copy.LoadFrom(fileName);
+    }
+
+    vector<wstring> names;
+
+    {
+      ReadOnlyTransaction transaction(copy);
+
+      CollectNames(copy, wstring(), names);
+    }
+
+    wcout << L"\n" << names.size() << L" entries\n";
+
+    if (names.empty())
+    {
+      return;
+    }
+
+    boost::random::mt19937 generator;
+    boost::random::uniform_int_distribution<size_t> distribution(0, names.size() - 1);
+
+    vector<wstring> sample;
+
+    for (size_t i = 0; i < count; i++)
+    {
+      sample.push_back(names[distribution(generator)]);
+    }
+
+    wcout << L"\nReading " << count << L" random entries:\n";
+
+    {
+      Timer timer;
+
+      for (const auto& name : sample)
+      {
+        copy.GetType(name);
+      }
+    }
+
+    wcout << L"\nReading " << count << L" random entries within one transaction:\n";
+
+    {
+      Timer timer;
+      ReadOnlyTransaction transaction(copy);
+
+      for (const auto& name : sample)
+      {
+        copy.GetType(name);
+      }
+    }
+
+    wcout << L"\nListing children of " << count << L" random entries:\n";
+
+    {
+      Timer timer;
+
+      for (const auto& name : sample)
+      {
+        copy.GetChildren(name);
+      }
+    }
+
+    wcout << L"\nWriting " << count << L" random integer entries within one batch:\n";
+
+    {
+      Timer timer;
+      WriteBatch batch(copy);
+
+      for (size_t i = 0; i < sample.size(); i++)
+      {
+        batch.SetOrCreate(sample[i], static_cast<Store::Integer>(i));
+      }
+
+      batch.Apply();
+    }
+
+    wcout << L"\nContent hash of whole store:\n";
+
+    {
+      Timer timer;
+
+      copy.GetContentHash(wstring());
+    }
+
+    wcout << L"\nExporting whole store as JSON:\n";
+
+    {
+      Timer timer;
+      ostream null(nullptr);  // output is discarded
+
+      ExportJson(copy, wstring(), null);
+    }
+  }
+
+  int Run(const wstring& fileName, const wstring& command, const Arguments& args)
+  {
+    auto arg = [&args](size_t index, const wstring& defaultValue) { return (index < args.size()) ? args[index] : defaultValue; };
+
+    if (command == L"get" && (args.size() == 1))
+    {
+      Store store(fileName);
+
+      wcout << FormatValue(store, args[0]) << L"\n";
+    }
+    else if (command == L"set" && (args.size() == 3))
+    {
+      Store store(fileName, false, Store::DefaultNameDelimiter, SignallingOptions());
+
+      if (args[1] == L"integer")
+      {
+        store.SetOrCreate(args[0], static_cast<Store::Integer>(stoll(args[2])));
+      }
+      else if (args[1] == L"string")
+      {
+        store.SetOrCreate(args[0], args[2]);
+      }
+      else if (args[1] == L"binary")
+      {
+        store.SetOrCreate(args[0], FromHex(args[2]));
+      }
+      else
+      {
+        Usage();
+        return 2;
+      }
+    }
+    else if (command == L"delete" && (args.size() == 1))
+    {
+      Store store(fileName, false, Store::DefaultNameDelimiter, SignallingOptions());
+
+      store.Delete(args[0]);
+    }
+    else if (command == L"ls" && (args.size() <= 1))
+    {
+      Store store(fileName);
+      ReadOnlyTransaction transaction(store);
+
+      for (const auto& child : GetSortedChildren(store, arg(0, wstring())))
+      {
+        wcout << child << L"\n";
+      }
+    }
+    else if (command == L"tree" && (args.size() <= 1))
+    {
+      Store store(fileName);
+      ReadOnlyTransaction transaction(store);
+
+      PrintTree(store, arg(0, wstring()), wstring());
+    }
+    else if (command == L"export" && (args.size() <= 2))
+    {
+      Store store(fileName);
+
+      if (args.size() == 2)
+      {
+        boost::filesystem::ofstream output(args[1], ios::out | ios::binary | ios::trunc);
+
+        ExportJson(store, args[0], output);
+      }
+      else
+      {
+        // UTF-8 as it is, the only output of the command
+        ExportJson(store, arg(0, wstring()), cout);
+        cout << "\n";
+      }
+    }
+    else if (command == L"import" && (args.size() >= 1) && (args.size() <= 2))
+    {
+      Store store(fileName, true, Store::DefaultNameDelimiter, SignallingOptions());
+      boost::filesystem::ifstream input(args[0], ios::in | ios::binary);
+
+      if (!input)
+      {
+        throw invalid_argument("Failed to open input file");
+      }
+
+      wcout << ImportJson(store, arg(1, wstring()), input) << L" values imported\n";
+    }
+    else if (command == L"check" && (args.size() <= 1))
+    {
+      Store store(fileName);
+
+      store.CheckDataConsistency(static_cast<size_t>(stoull(arg(0, L"1"))));
+
+      wcout << L"ok\n";
+    }
+    else if (command == L"compact" && args.empty())
+    {
+      Store store(fileName);
+
+      wcout << store.Compact() << L" pages freed\n";
+
+      store.Optimize();
+    }
+    else if (command == L"watch" && (args.size() <= 1))
+    {
+      Store store(fileName);
+      ChangeSignal signal(fileName);
+
+      auto sequence = signal.GetSequence();
+      auto revision = store.GetRevision(arg(0, wstring()));
+
+      for (;;)
+      {
+        // the sequence only tells that something has been committed
+        if (signal.Wait(sequence, chrono::minutes(1)) && (store.GetRevision(arg(0, wstring())) != revision))
+        {
+          revision = store.GetRevision(arg(0, wstring()));
+
+          wcout << L"changed (" << sequence << L")" << endl;
+        }
+      }
+    }
+    else if (command == L"publish" && args.empty())
+    {
+      Store store(fileName);
+      SnapshotPublisher publisher(store);
+
+      for (;;)
+      {
+        // changes that are not signalled are published after a second, unchanged snapshots are confirmed to the readers
+        if (publisher.WaitAndPublish(chrono::seconds(1)))
+        {
+          wcout << L"published" << endl;
+        }
+      }
+    }
+    else if (command == L"bench" && (args.size() <= 1))
+    {
+      Bench(fileName, static_cast<size_t>(stoull(arg(0, L"10000"))));
+    }
+    else
+    {
+      Usage();
+      return 2;
+    }
+
+    return 0;
+  }
+}
+
+int wmain(int argc, wchar_t* argv[])
+{
+  if (argc < 3)
+  {
+    Usage();
+    return 2;
+  }
+
+  try
+  {
+    return Run(argv[1], argv[2], Arguments(argv + 3, argv + argc));
+  }
+  catch (const Configuration::Exception& e)
+  {
+    wcerr << L"Exception: type (" << e.TypeName() << L") msg (" << e.What() << L")" << endl;
+  }
+  catch (const std::exception& e)
+  {
+    wcerr << L"Exception: " << typeid(e).name() << L" (" << UTF8ToWchar(e.what()) << L")" << endl;
+  }
+  catch (...)
+  {
+    wcerr << L"Unknown exception" << endl;
+  }
+
+  return 1;
+}